@@ -155,6 +155,19 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
             false, defopts.bin_dt, "time", cmd);
         TCLAP::SwitchArg bin_regular_arg(
             "","bin-regular","use 'regular' binning policy instead of 'following'", cmd, false);
+        TCLAP::SwitchArg dataflow_arg(
+            "","dataflow","schedule epochs as a task graph, without a barrier between epochs", cmd, false);
+        TCLAP::ValueArg<std::string> epoch_length_arg(
+            "", "epoch-length", "set epochs to half the minimum delay (half), the minimum delay on one rank (full), "
+            "or half the minimum delay between ranks (cross)",
+            false, defopts.epoch_length, "string", cmd);
+        TCLAP::ValueArg<unsigned> rebalance_arg(
+            "", "rebalance", "reorder the cell groups over the threads every <n> epochs",
+            false, defopts.rebalance_interval, "integer", cmd);
+        TCLAP::SwitchArg graph_partition_arg(
+            "","graph-partition","distribute cells over ranks by partitioning the connection graph", cmd, false);
+        TCLAP::SwitchArg steady_state_arg(
+            "","steady-state","start from the steady state of the cells instead of the resting potential", cmd, false);
         TCLAP::SwitchArg all_to_all_arg(
             "m","alltoall","all to all network", cmd, false);
         TCLAP::SwitchArg ring_arg(
@@ -188,6 +201,9 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
         TCLAP::ValueArg<unsigned> dry_run_ranks_arg(
             "D","dry-run-ranks","number of ranks in dry run mode",
             false, defopts.dry_run_ranks, "positive integer", cmd);
+        TCLAP::ValueArg<std::string> dry_run_loggp_arg(
+            "", "dry-run-loggp", "predict communication time in dry run mode with LogGP parameters L,o,g,G [s]",
+            false, "", "L,o,g,G", cmd);
         TCLAP::SwitchArg profile_only_zero_arg(
              "z", "profile-only-zero", "Only output profile information for rank 0", cmd, false);
         TCLAP::SwitchArg verbose_arg(
@@ -222,6 +238,11 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
                     update_option(options.dt, fopts, "dt");
                     update_option(options.bin_dt, fopts, "bin_dt");
                     update_option(options.bin_regular, fopts, "bin_regular");
+                    update_option(options.dataflow, fopts, "dataflow");
+                    update_option(options.epoch_length, fopts, "epoch_length");
+                    update_option(options.rebalance_interval, fopts, "rebalance_interval");
+                    update_option(options.graph_partition, fopts, "graph_partition");
+                    update_option(options.steady_state, fopts, "steady_state");
                     update_option(options.tfinal, fopts, "tfinal");
                     update_option(options.all_to_all, fopts, "all_to_all");
                     update_option(options.ring, fopts, "ring");
@@ -251,6 +272,9 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
                     }
 
                     update_option(options.dry_run_ranks, fopts, "dry_run_ranks");
+                    if (fopts.count("dry_run_loggp")) {
+                        options.dry_run_loggp = fopts["dry_run_loggp"].get<std::vector<double>>();
+                    }
 
                     update_option(options.profile_only_zero, fopts, "profile_only_zero");
 
@@ -273,6 +297,11 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
         update_option(options.dt, dt_arg);
         update_option(options.bin_dt, bin_dt_arg);
         update_option(options.bin_regular, bin_regular_arg);
+        update_option(options.dataflow, dataflow_arg);
+        update_option(options.epoch_length, epoch_length_arg);
+        update_option(options.rebalance_interval, rebalance_arg);
+        update_option(options.graph_partition, graph_partition_arg);
+        update_option(options.steady_state, steady_state_arg);
         update_option(options.all_to_all, all_to_all_arg);
         update_option(options.ring, ring_arg);
         update_option(options.sample_dt, sample_dt_arg);
@@ -287,6 +316,18 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
         update_option(options.spike_file_output, spike_output_arg);
         update_option(options.profile_only_zero, profile_only_zero_arg);
         update_option(options.dry_run_ranks, dry_run_ranks_arg);
+        if (dry_run_loggp_arg.isSet()) {
+            options.dry_run_loggp.clear();
+            std::istringstream in(dry_run_loggp_arg.getValue());
+            try {
+                for (std::string value; std::getline(in, value, ',');) {
+                    options.dry_run_loggp.push_back(std::stod(value));
+                }
+            }
+            catch (std::exception&) {
+                throw usage_error("LogGP parameters must be numbers: "+dry_run_loggp_arg.getValue());
+            }
+        }
 
         std::string is_file_name = ispike_arg.getValue();
         if (is_file_name != "") {
@@ -298,6 +339,14 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
             throw usage_error("trace format must be one of: csv, json");
         }
 
+        if (options.epoch_length!="half" && options.epoch_length!="full" && options.epoch_length!="cross") {
+            throw usage_error("epoch length must be one of: half, full, cross");
+        }
+
+        if (!options.dry_run_loggp.empty() && options.dry_run_loggp.size()!=4) {
+            throw usage_error("LogGP parameters must be given as L,o,g,G");
+        }
+
         if (options.all_to_all && options.ring) {
             throw usage_error("can specify at most one of --ring and --all-to-all");
         }
@@ -322,6 +371,11 @@ cl_options read_options(int argc, char** argv, bool allow_write) {
                 fopts["dt"] = options.dt;
                 fopts["bin_dt"] = options.bin_dt;
                 fopts["bin_regular"] = options.bin_regular;
+                fopts["dataflow"] = options.dataflow;
+                fopts["epoch_length"] = options.epoch_length;
+                fopts["rebalance_interval"] = options.rebalance_interval;
+                fopts["graph_partition"] = options.graph_partition;
+                fopts["steady_state"] = options.steady_state;
                 fopts["tfinal"] = options.tfinal;
                 fopts["all_to_all"] = options.all_to_all;
                 fopts["ring"] = options.ring;
@@ -375,6 +429,11 @@ std::ostream& operator<<(std::ostream& o, const cl_options& options) {
     o << "  binning dt           : " << options.bin_dt << "\n";
     o << "  binning policy       : " <<
         (options.bin_dt==0? "none": options.bin_regular? "regular": "following") << "\n";
+    o << "  epoch scheduling     : " << (options.dataflow ? "dataflow" : "barrier") << "\n";
+    o << "  epoch length         : " << options.epoch_length << "\n";
+    o << "  rebalance interval   : " << options.rebalance_interval << "\n";
+    o << "  graph partition      : " << (options.graph_partition ? "yes" : "no") << "\n";
+    o << "  steady state init    : " << (options.steady_state ? "yes" : "no") << "\n";
     o << "  all to all network   : " << (options.all_to_all ? "yes" : "no") << "\n";
     o << "  ring network         : " << (options.ring ? "yes" : "no") << "\n";
     o << "  sample dt            : " << options.sample_dt << "\n";
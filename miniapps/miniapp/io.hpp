@@ -35,6 +35,11 @@ struct cl_options {
     double dt = 0.025;
     bool bin_regular = false; // False => use 'following' instead of 'regular'.
     double bin_dt = 0.0025;   // 0 => no binning.
+    bool dataflow = false;    // False => synchronize all cell groups every epoch.
+    std::string epoch_length = "half"; // One of 'half', 'full', 'cross'.
+    unsigned rebalance_interval = 0; // 0 => never reorder the cell groups.
+    bool graph_partition = false; // False => assign contiguous ranges of gids to ranks.
+    bool steady_state = false;    // False => start from the resting potential.
 
     // Probe/sampling specification.
     double sample_dt = 0.1;
@@ -58,6 +63,9 @@ struct cl_options {
 
     // Dry run parameters (pertinent only when built with 'dryrun' distrib model).
     int dry_run_ranks = 1;
+    // LogGP parameters L, o, g, G [s] of the network on which to predict the
+    // communication time of the dry run ranks; empty for no prediction.
+    std::vector<double> dry_run_loggp;
 
     // Turn on/off profiling output for all ranks.
     bool profile_only_zero = false;
@@ -10,6 +10,7 @@
 #include <common_types.hpp>
 #include <communication/communicator.hpp>
 #include <communication/global_policy.hpp>
+#include <communication/network_model.hpp>
 #include <cell.hpp>
 #include <fvm_multicell.hpp>
 #include <hardware/gpu.hpp>
@@ -72,6 +73,17 @@ int main(int argc, char** argv) {
             }
 
             global_policy::set_sizes(options.dry_run_ranks, cells_per_rank);
+
+#ifdef ARB_HAVE_DRYRUN
+            // Predict the time taken by communication between the ranks, which
+            // is reported by the network meter.
+            if (!options.dry_run_loggp.empty()) {
+                const auto& p = options.dry_run_loggp;
+                global_policy::set_network_model(
+                    std::make_shared<communication::loggp_model>(
+                        communication::loggp_parameters{p[0], p[1], p[2], p[3]}));
+            }
+#endif
         }
 
         // Use a node description that uses the number of threads used by the
@@ -100,8 +112,15 @@ int main(int argc, char** argv) {
                     options.file_extension, options.over_write);
         };
 
-        auto decomp = partition_load_balance(*recipe, nd);
-        model m(*recipe, decomp);
+        auto decomp = options.graph_partition?
+            graph_load_balance(*recipe, nd):
+            partition_load_balance(*recipe, nd);
+        if (options.graph_partition) {
+            std::cout << make_decomposition_report(*recipe, decomp) << "\n";
+        }
+        meters.checkpoint("model-decompose");
+
+        model m(*recipe, decomp, make_global_context(), &meters);
 
         // Set up samplers for probes on local cable cells, as requested
         // by command line options.
@@ -133,6 +152,17 @@ int main(int argc, char** argv) {
 
         m.set_binning_policy(binning_policy, options.bin_dt);
 
+        m.set_epoch_scheduling(options.dataflow? epoch_scheduling::dataflow: epoch_scheduling::barrier);
+        m.set_epoch_length(
+            options.epoch_length=="full"? epoch_length::min_delay:
+            options.epoch_length=="cross"? epoch_length::cross_domain_delay:
+            epoch_length::half_min_delay);
+        m.set_rebalance_interval(options.rebalance_interval);
+
+        if (options.steady_state && !m.initialize_steady_state()) {
+            std::cerr << "warning: the initial steady state did not converge\n";
+        }
+
         // Initialize the spike exporting interface
         std::unique_ptr<file_export_type> file_exporter;
         if (options.spike_file_output) {
@@ -168,6 +168,13 @@ std::string CPrinter::emit_source() {
     text_.add_line("}");
     text_.add_line();
 
+    text_.add_line("view field_data() override {");
+    text_.increase_indentation();
+    text_.add_line("return data_(0, data_.size());");
+    text_.decrease_indentation();
+    text_.add_line("}");
+    text_.add_line();
+
     text_.add_line("std::string name() const override {");
     text_.increase_indentation();
     text_.add_line("return \"" + module_name + "\";");
@@ -393,6 +393,13 @@ CUDAPrinter::CUDAPrinter(Module &m, bool o)
     buffer().add_line("}");
     buffer().add_line();
 
+    buffer().add_line("view field_data() override {");
+    buffer().increase_indentation();
+    buffer().add_line("return data_(0, data_.size());");
+    buffer().decrease_indentation();
+    buffer().add_line("}");
+    buffer().add_line();
+
     // print the member funtion that packs up the parameters for use on the GPU
     buffer().add_line("void set_params() override {");
     buffer().increase_indentation();
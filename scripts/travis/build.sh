@@ -28,6 +28,9 @@ if [[ "${WITH_DISTRIBUTED}" = "mpi" ]]; then
     CC="mpicc"
     CXX="mpicxx"
     launch="mpiexec -n 4"
+elif [[ "${WITH_DISTRIBUTED}" = "shmem" ]]; then
+    echo "mpi        : off (shared memory)"
+    launch="env ARB_SHMEM_SIZE=4"
 else
     echo "mpi        : off"
     launch=""
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+#include <checkpoint.hpp>
+#include <memory/memory.hpp>
+
+namespace arb {
+
+// Checkpoint the contents of a back end array or view, which may be in
+// device memory.
+template <typename A>
+void checkpoint_array(checkpoint_writer& w, const A& a) {
+    auto h = memory::on_host(a);
+    w.write_sequence(h.data(), h.size());
+}
+
+// Restore the contents of a back end array or view from a checkpoint, which
+// must hold a sequence of the same size.
+template <typename A>
+void restore_array(checkpoint_reader& r, A&& a) {
+    std::vector<typename std::decay<A>::type::value_type> h(a.size());
+    r.read_sequence(h.data(), h.size());
+    memory::copy(h, a);
+}
+
+} // namespace arb
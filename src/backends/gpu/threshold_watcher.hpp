@@ -1,6 +1,7 @@
 #pragma once
 
 #include <common_types.hpp>
+#include <backends/checkpoint.hpp>
 #include <memory/memory.hpp>
 #include <util/span.hpp>
 
@@ -111,6 +112,20 @@ public:
         EXPECTS((cudaDeviceSynchronize(), !stack_.overflow()));
     }
 
+    /// Save and restore the state of each detector. Crossings are not saved:
+    /// checkpoints are taken between integration periods, after the crossings
+    /// have been cleared.
+    void checkpoint(checkpoint_writer& w) const {
+        checkpoint_array(w, prev_values_);
+        checkpoint_array(w, is_crossed_);
+    }
+
+    void restore(checkpoint_reader& r) {
+        clear_crossings();
+        restore_array(r, prev_values_);
+        restore_array(r, is_crossed_);
+    }
+
     /// the number of threashold values that are being monitored
     std::size_t size() const {
         return cv_index_.size();
@@ -2,6 +2,7 @@
 
 // Indexed collection of pop-only event queues --- multicore back-end implementation.
 
+#include <algorithm>
 #include <limits>
 #include <ostream>
 #include <utility>
@@ -49,8 +50,11 @@ public:
         util::fill(mark_, 0u);
     }
 
-    // Initialize event streams from a vector of events, sorted by time.
-    void init(std::vector<Event> staged) {
+    // Initialize event streams from a vector of events, which must be sorted
+    // by time within each stream, e.g. the events of each stream in turn.
+    // The events are partitioned by stream index with a stable counting
+    // sort, reusing the storage of the event streams.
+    void init(const std::vector<Event>& staged) {
         using ::arb::event_time;
         using ::arb::event_index;
         using ::arb::event_data;
@@ -59,31 +63,41 @@ public:
             throw std::range_error("too many events");
         }
 
-        // Sort by index (staged events should already be time-sorted).
-        EXPECTS(util::is_sorted_by(staged, [](const Event& ev) { return event_time(ev); }));
-        util::stable_sort_by(staged, [](const Event& ev) { return event_index(ev); });
-
-        std::size_t n_ev = staged.size();
-        util::assign_by(ev_data_, staged, [](const Event& ev) { return event_data(ev); });
-        util::assign_by(ev_time_, staged, [](const Event& ev) { return event_time(ev); });
-
-        // Determine divisions by `event_index` in ev list.
         EXPECTS(n_streams() == span_begin_.size());
         EXPECTS(n_streams() == span_end_.size());
         EXPECTS(n_streams() == mark_.size());
 
-        size_type ev_begin_i = 0;
-        size_type ev_i = 0;
+        // Count the events in each stream, and determine the divisions of
+        // the streams in the event list.
+        util::fill(span_end_, 0u);
+        for (const auto& ev: staged) {
+            EXPECTS(event_index(ev)<n_streams());
+            ++span_end_[event_index(ev)];
+        }
+
+        size_type n_ev = 0;
+        for (size_type s = 0; s<n_streams(); ++s) {
+            span_begin_[s] = n_ev;
+            n_ev += span_end_[s];
+        }
+
+        // Scatter the events to their streams in time order, using mark_ as
+        // the insertion point of each stream.
+        ev_data_.resize(n_ev);
+        ev_time_.resize(n_ev);
+        util::assign(mark_, span_begin_);
+        for (const auto& ev: staged) {
+            auto i = mark_[event_index(ev)]++;
+            ev_data_[i] = event_data(ev);
+            ev_time_[i] = event_time(ev);
+        }
+
+        util::assign(span_end_, mark_);
+        util::assign(mark_, span_begin_);
+
+        // Within each stream, events should be sorted by time.
         for (size_type s = 0; s<n_streams(); ++s) {
-            while (ev_i<n_ev && event_index(staged[ev_i])<s+1) ++ev_i;
-
-            // Within a subrange of events with the same index, events should
-            // be sorted by time.
-            EXPECTS(std::is_sorted(&ev_time_[ev_begin_i], &ev_time_[ev_i]));
-            mark_[s] = ev_begin_i;
-            span_begin_[s] = ev_begin_i;
-            span_end_[s] = ev_i;
-            ev_begin_i = ev_i;
+            EXPECTS(std::is_sorted(ev_time_.begin()+span_begin_[s], ev_time_.begin()+span_end_[s]));
         }
 
         remaining_ = n_ev;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <backends/checkpoint.hpp>
 #include <math.hpp>
 #include <memory/memory.hpp>
 
@@ -105,6 +106,20 @@ public:
         return is_crossed_[i];
     }
 
+    /// Save and restore the state of each detector. Crossings are not saved:
+    /// checkpoints are taken between integration periods, after the crossings
+    /// have been cleared.
+    void checkpoint(checkpoint_writer& w) const {
+        checkpoint_array(w, v_prev_);
+        checkpoint_array(w, is_crossed_);
+    }
+
+    void restore(checkpoint_reader& r) {
+        clear_crossings();
+        restore_array(r, v_prev_);
+        restore_array(r, is_crossed_);
+    }
+
     /// the number of threashold values that are being monitored
     std::size_t size() const {
         return cv_index_.size();
@@ -2,12 +2,15 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <cell.hpp>
+#include <checkpoint.hpp>
 #include <common_types.hpp>
 #include <epoch.hpp>
 #include <event_binner.hpp>
+#include <event_lanes.hpp>
 #include <event_queue.hpp>
 #include <sampling.hpp>
 #include <schedule.hpp>
@@ -22,12 +25,35 @@ public:
     virtual cell_kind get_cell_kind() const = 0;
 
     virtual void reset() = 0;
+
+    // Replace the state of the cells by the steady state they reach in the
+    // absence of events, stopping when the largest rate of change of the
+    // state is below tolerance. The iteration takes pseudo-time steps within
+    // [dt_min, dt_max]. Returns false if that took more than max_steps
+    // iterations. Cells without continuous state have nothing to do.
+    virtual bool initialize_steady_state(double tolerance, unsigned max_steps, time_type dt_min, time_type dt_max) = 0;
     virtual void set_binning_policy(binning_kind policy, time_type bin_interval) = 0;
     virtual void advance(epoch epoch, time_type dt, const event_lane_subrange& events) = 0;
 
     virtual const std::vector<spike>& spikes() const = 0;
     virtual void clear_spikes() = 0;
 
+    // Save and restore the state of the cells, between calls to advance, so
+    // that a group constructed from the same recipe and gids continues
+    // exactly as the saved group would have. The schedules of the samplers
+    // are restored into the samplers of the group with the same handles,
+    // which must have been added before the restore.
+    virtual void checkpoint(checkpoint_writer&) const = 0;
+    virtual void restore(checkpoint_reader&) = 0;
+
+    // Change the parameters of the mechanisms of the cells, between calls to
+    // advance; see model::set_mechanism_parameter. Throws
+    // std::invalid_argument if the cells have no such mechanism or parameter.
+    virtual void set_mechanism_parameter(cell_gid_type gid, segment_location loc,
+        const std::string& mech, const std::string& param, double value) = 0;
+    virtual void set_synapse_parameter(cell_member_type target, const std::string& param, double value) = 0;
+    virtual void set_mechanism_global(const std::string& mech, const std::string& param, double value) = 0;
+
     // Sampler association methods below should be thread-safe, as they might be invoked
     // from a sampler call back called from a different cell group running on a different thread.
 
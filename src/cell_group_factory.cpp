@@ -15,14 +15,14 @@ namespace arb {
 using gpu_fvm_cell = mc_cell_group<fvm::fvm_multicell<gpu::backend>>;
 using mc_fvm_cell = mc_cell_group<fvm::fvm_multicell<multicore::backend>>;
 
-cell_group_ptr cell_group_factory(const recipe& rec, const group_description& group) {
+cell_group_ptr cell_group_factory(const recipe& rec, const group_description& group, fvm::discretization_cache* cache) {
     switch (group.kind) {
     case cell_kind::cable1d_neuron:
         if (group.backend == backend_kind::gpu) {
-            return make_cell_group<gpu_fvm_cell>(group.gids, rec);
+            return make_cell_group<gpu_fvm_cell>(group.gids, rec, cache);
         }
         else {
-            return make_cell_group<mc_fvm_cell>(group.gids, rec);
+            return make_cell_group<mc_fvm_cell>(group.gids, rec, cache);
         }
 
     case cell_kind::regular_spike_source:
@@ -5,12 +5,14 @@
 #include <backends.hpp>
 #include <cell_group.hpp>
 #include <domain_decomposition.hpp>
+#include <fvm_discretization.hpp>
 #include <recipe.hpp>
 #include <util/unique_any.hpp>
 
 namespace arb {
 
-// Helper factory for building cell groups
-cell_group_ptr cell_group_factory(const recipe& rec, const group_description& group);
+// Helper factory for building cell groups. Cell groups built with the same
+// discretization cache share the discretizations of identical morphologies.
+cell_group_ptr cell_group_factory(const recipe& rec, const group_description& group, fvm::discretization_cache* cache = nullptr);
 
 } // namespace arb
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <util/meta.hpp>
+
+namespace arb {
+
+// The version of the checkpoint format. It must be incremented whenever the
+// layout of the state saved by any of the checkpoint methods changes, so that
+// checkpoints written by a different version are rejected on restore.
+constexpr std::uint32_t checkpoint_version = 1;
+
+struct checkpoint_error: std::runtime_error {
+    checkpoint_error(const std::string& what):
+        std::runtime_error("checkpoint: "+what)
+    {}
+};
+
+namespace impl {
+    template <typename T, typename = void>
+    struct is_streamable: std::false_type {};
+
+    template <typename T>
+    struct is_streamable<T, util::void_t<
+        decltype(std::declval<std::ostream&>() << std::declval<const T&>()),
+        decltype(std::declval<std::istream&>() >> std::declval<T&>())>>: std::true_type {};
+
+    // How the state of a random number engine is saved: in its text form,
+    // which all the engines of the standard library have, or else as the
+    // object representation of a trivially copyable engine.
+    template <typename Engine>
+    using engine_format = std::integral_constant<int,
+        is_streamable<Engine>::value? 0: std::is_trivially_copyable<Engine>::value? 1: 2>;
+}
+
+// Binary output for checkpoints.
+//
+// Values are written as their object representation, so a checkpoint can
+// only be restored by a build with the same value types on a system with the
+// same byte order. Sequences are written as their length followed by their
+// elements, so that the reader can check that the state it restores into has
+// the same shape.
+class checkpoint_writer {
+public:
+    explicit checkpoint_writer(std::ostream& out): out_(out) {}
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        out_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void write_sequence(const T* data, std::size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        write<std::uint64_t>(n);
+        out_.write(reinterpret_cast<const char*>(data), n*sizeof(T));
+    }
+
+    // Write a contiguous sequence, e.g. a std::vector or a host-side view of
+    // a back end array.
+    template <typename Seq>
+    void write_sequence(const Seq& seq) {
+        write_sequence(seq.data(), seq.size());
+    }
+
+    void write_string(const std::string& s) {
+        write_sequence(s.data(), s.size());
+    }
+
+    // Write the state of a random number engine.
+    template <typename Engine>
+    void write_engine(const Engine& e) {
+        write_engine(e, impl::engine_format<Engine>{});
+    }
+
+private:
+    std::ostream& out_;
+
+    template <typename Engine>
+    void write_engine(const Engine& e, std::integral_constant<int, 0>) {
+        std::ostringstream text;
+        text << e;
+        write_string(text.str());
+    }
+
+    template <typename Engine>
+    void write_engine(const Engine& e, std::integral_constant<int, 1>) {
+        write(e);
+    }
+
+    template <typename Engine>
+    void write_engine(const Engine&, std::integral_constant<int, 2>) {
+        throw checkpoint_error("random number engine can not be saved");
+    }
+};
+
+// Binary input for checkpoints written by checkpoint_writer.
+// Throws checkpoint_error if the input ends early, or if a sequence does not
+// have the expected length.
+class checkpoint_reader {
+public:
+    explicit checkpoint_reader(std::istream& in): in_(in) {}
+
+    template <typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        T value;
+        read_bytes(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        read_bytes(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    // Read a sequence of exactly n values into data.
+    template <typename T>
+    void read_sequence(T* data, std::size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        auto m = read<std::uint64_t>();
+        if (m!=n) {
+            throw checkpoint_error("expected a sequence of length "+std::to_string(n)+", found "+std::to_string(m));
+        }
+        read_bytes(reinterpret_cast<char*>(data), n*sizeof(T));
+    }
+
+    // Read a sequence of any length, replacing the contents of v.
+    template <typename T>
+    void read_sequence(std::vector<T>& v) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        v.resize(read<std::uint64_t>());
+        read_bytes(reinterpret_cast<char*>(v.data()), v.size()*sizeof(T));
+    }
+
+    std::string read_string() {
+        std::vector<char> s;
+        read_sequence(s);
+        return std::string(s.begin(), s.end());
+    }
+
+    // Read the state of a random number engine written by write_engine.
+    template <typename Engine>
+    void read_engine(Engine& e) {
+        read_engine(e, impl::engine_format<Engine>{});
+    }
+
+private:
+    std::istream& in_;
+
+    template <typename Engine>
+    void read_engine(Engine& e, std::integral_constant<int, 0>) {
+        std::istringstream text(read_string());
+        if (!(text >> e)) {
+            throw checkpoint_error("invalid random number engine state");
+        }
+    }
+
+    template <typename Engine>
+    void read_engine(Engine& e, std::integral_constant<int, 1>) {
+        read(e);
+    }
+
+    template <typename Engine>
+    void read_engine(Engine&, std::integral_constant<int, 2>) {
+        throw checkpoint_error("random number engine can not be restored");
+    }
+
+    void read_bytes(char* p, std::size_t n) {
+        if (!in_.read(p, n)) {
+            throw checkpoint_error("unexpected end of input");
+        }
+    }
+};
+
+} // namespace arb
@@ -8,15 +8,21 @@
 #include <vector>
 
 #include <algorithms.hpp>
+#include <checkpoint.hpp>
 #include <common_types.hpp>
 #include <communication/gathered_vector.hpp>
+#include <communication/source_filter.hpp>
 #include <connection.hpp>
+#include <connection_rule.hpp>
 #include <domain_decomposition.hpp>
+#include <event_lanes.hpp>
 #include <event_queue.hpp>
 #include <recipe.hpp>
 #include <spike.hpp>
+#include <threading/threading.hpp>
 #include <util/debug.hpp>
 #include <util/double_buffer.hpp>
+#include <util/optional.hpp>
 #include <util/partition.hpp>
 #include <util/rangeutil.hpp>
 
@@ -41,65 +47,109 @@ public:
 
     communicator() {}
 
-    explicit communicator(const recipe& rec, const domain_decomposition& dom_dec) {
+    explicit communicator(const recipe& rec, const domain_decomposition& dom_dec,
+                          communication_policy_type comms = communication_policy_type()):
+        comms_(std::move(comms))
+    {
         using util::make_span;
         num_domains_ = comms_.size();
         num_local_groups_ = dom_dec.groups.size();
 
-        // For caching information about each cell
-        struct gid_info {
-            using connection_list = decltype(std::declval<recipe>().connections_on(0));
-            cell_gid_type gid;              // global identifier of cell
-            cell_size_type index_on_domain; // index of cell in this domain
-            connection_list conns;          // list of connections terminating at this cell
-            gid_info(cell_gid_type g, cell_size_type di, connection_list c):
-                gid(g), index_on_domain(di), conns(std::move(c)) {}
+        // The local cells, in the order of the groups of the decomposition,
+        // are divided into blocks of contiguous cells, with a few blocks per
+        // thread for load balance. The connections of each block are
+        // gathered in parallel, then placed in parallel into connections_,
+        // partitioned by the domain of their source gid, at offsets given
+        // by a prefix sum over the blocks of the per-domain counts.
+        // Within each domain the connections are in the order of the
+        // local cells, as if they had been gathered serially.
+        std::vector<cell_gid_type> local_gids;
+        local_gids.reserve(dom_dec.num_local_cells);
+        for (const auto& group: dom_dec.groups) {
+            local_gids.insert(local_gids.end(), group.gids.begin(), group.gids.end());
+        }
+        num_local_cells_ = local_gids.size();
+
+        // For caching information about each block of cells
+        struct block_info {
+            cell_size_type first;                   // index on domain of first cell in block
+            cell_size_type last;                    // one past the index of the last cell
+            std::vector<cell_connection> conns;     // connections terminating at the cells
+            std::vector<cell_size_type> divisions;  // partition of conns by cell
+            std::vector<unsigned> src_domains;      // domain of the source of each connection
+            std::vector<cell_size_type> counts;     // number of connections from each domain
         };
 
-        // Make a list of local gid with their group index and connections
-        //   -> gid_infos
-        // Count the number of local connections (i.e. connections terminating on this domain)
-        //   -> n_cons: scalar
-        // Calculate and store domain id of the presynaptic cell on each local connection
-        //   -> src_domains: array with one entry for every local connection
-        // Also the count of presynaptic sources from each domain
-        //   -> src_counts: array with one entry for each domain
-        std::vector<gid_info> gid_infos;
-        gid_infos.reserve(dom_dec.num_local_cells);
-
-        cell_local_size_type n_cons = 0;
-        cell_local_size_type n_gid = 0;
-        std::vector<unsigned> src_domains;
-        std::vector<cell_size_type> src_counts(num_domains_);
-        for (auto g: make_span(0, num_local_groups_)) {
-            const auto& group = dom_dec.groups[g];
-            for (auto gid: group.gids) {
-                gid_info info(gid, n_gid, rec.connections_on(gid));
-                n_cons += info.conns.size();
-                for (auto con: info.conns) {
+        const cell_size_type num_blocks = std::min<cell_size_type>(
+            num_local_cells_, 4*threading::current_num_threads());
+        std::vector<block_info> blocks(num_blocks);
+        for (cell_size_type b=0; b<num_blocks; ++b) {
+            blocks[b].first = b*num_local_cells_/num_blocks;
+            blocks[b].last = (b+1)*num_local_cells_/num_blocks;
+        }
+
+        threading::parallel_for::apply(0, num_blocks,
+            [&](cell_size_type b) {
+                auto& block = blocks[b];
+                block.counts.assign(num_domains_, 0);
+                rec.connections_on_range(
+                    gid_range(local_gids.data()+block.first, local_gids.data()+block.last),
+                    block.conns, block.divisions);
+                block.src_domains.reserve(block.conns.size());
+                for (const auto& con: block.conns) {
                     const auto src = dom_dec.gid_domain(con.source.gid);
-                    src_domains.push_back(src);
-                    src_counts[src]++;
+                    block.src_domains.push_back(src);
+                    block.counts[src]++;
                 }
-                gid_infos.push_back(std::move(info));
-                ++n_gid;
-            }
-        }
+            });
 
-        num_local_cells_ = n_gid;
+        // Count the connections from each domain, and replace the per-block
+        // counts by the offset in connections_ at which each block starts
+        // to place the connections from each domain.
+        std::vector<cell_size_type> src_counts(num_domains_);
+        threading::parallel_for::apply(0, num_domains_,
+            [&](cell_size_type d) {
+                cell_size_type sum = 0;
+                for (auto& block: blocks) {
+                    auto n = block.counts[d];
+                    block.counts[d] = sum;
+                    sum += n;
+                }
+                src_counts[d] = sum;
+            });
 
-        // Construct the connections.
-        // The loop above gave the information required to construct in place
-        // the connections as partitioned by the domain of their source gid.
-        connections_.resize(n_cons);
         connection_part_ = algorithms::make_index(src_counts);
-        auto offsets = connection_part_;
-        std::size_t pos = 0;
-        for (const auto& cell: gid_infos) {
-            for (auto c: cell.conns) {
-                const auto i = offsets[src_domains[pos]]++;
-                connections_[i] = {c.source, c.dest, c.weight, c.delay, cell.index_on_domain};
-                ++pos;
+        connections_.resize(connection_part_.back());
+
+        threading::parallel_for::apply(0, num_blocks,
+            [&](cell_size_type b) {
+                auto& block = blocks[b];
+                auto& offsets = block.counts;
+                for (auto d: make_span(0, num_domains_)) {
+                    offsets[d] += connection_part_[d];
+                }
+                for (auto i: make_span(block.first, block.last)) {
+                    const auto k = i-block.first;
+                    for (auto pos: make_span(block.divisions[k], block.divisions[k+1])) {
+                        const auto& c = block.conns[pos];
+                        const auto j = offsets[block.src_domains[pos]]++;
+                        connections_[j] = {c.source, c.dest, c.weight, c.delay, i};
+                    }
+                }
+            });
+
+        // Procedural connections are generated onto the runs of consecutive
+        // local gids with consecutive indexes on the domain.
+        rule_ = rec.procedural_connections();
+        if (rule_) {
+            for (auto i: make_span(0, num_local_cells_)) {
+                auto gid = local_gids[i];
+                if (local_runs_.empty() || gid!=local_runs_.back().last) {
+                    local_runs_.push_back({gid, gid+1, i});
+                }
+                else {
+                    ++local_runs_.back().last;
+                }
             }
         }
 
@@ -116,6 +166,20 @@ public:
             [&](cell_size_type i) {
                 util::sort(util::subrange_view(connections_, cp[i], cp[i+1]));
             });
+
+        // The set of the source gids of the connections, which are sorted
+        // within each domain.
+        std::vector<cell_gid_type> sources;
+        sources.reserve(connections_.size());
+        for (const auto& con: connections_) {
+            const auto gid = con.source().gid;
+            if (sources.empty() || sources.back()!=gid) {
+                sources.push_back(gid);
+            }
+        }
+        util::sort(sources);
+        sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+        filter_ = source_filter(sources);
     }
 
     /// The range of event queues that belong to cells in group i.
@@ -130,40 +194,119 @@ public:
         for (auto& con : connections_) {
             local_min = std::min(local_min, con.delay());
         }
+        if (rule_ && !local_runs_.empty()) {
+            local_min = std::min(local_min, rule_->min_delay());
+        }
 
         return comms_.min(local_min);
     }
 
+    /// The minimum delay of the connections between cells on different
+    /// domains, over all domains, including the procedural connections,
+    /// which may cross domains.
+    time_type min_remote_delay() {
+        auto local_min = std::numeric_limits<time_type>::max();
+        const auto& cp = connection_part_;
+        for (auto dom: util::make_span(0, num_domains_)) {
+            if (dom==cell_size_type(comms_.id())) continue;
+            for (auto& con: util::subrange_view(connections_, cp[dom], cp[dom+1])) {
+                local_min = std::min(local_min, con.delay());
+            }
+        }
+        if (rule_ && !local_runs_.empty()) {
+            local_min = std::min(local_min, rule_->min_delay());
+        }
+
+        return comms_.min(local_min);
+    }
+
+    /// The minimum delay of the stored connections between cells on this
+    /// domain.
+    time_type min_local_delay() const {
+        auto local_min = std::numeric_limits<time_type>::max();
+        for (auto& con: local_connections()) {
+            local_min = std::min(local_min, con.delay());
+        }
+        return local_min;
+    }
+
     /// Perform exchange of spikes.
     ///
-    /// Takes as input the list of local_spikes that were generated on the calling domain.
-    /// Returns the full global set of vectors, along with meta data about their partition
-    gathered_vector<spike> exchange(std::vector<spike> local_spikes) {
-        // sort the spikes in ascending order of source gid
-        util::sort_by(local_spikes, [](spike s){return s.source;});
+    /// Takes as input the list of local_spikes that were generated on the calling domain,
+    /// which are sorted in place by source if they are not already sorted.
+    /// Returns the full global set of vectors, along with meta data about their partition.
+    /// The gathered vector is owned by the communicator, and its storage is reused by
+    /// the next call to exchange.
+    const gathered_vector<spike>& exchange(std::vector<spike>& local_spikes) {
+        // sort the spikes in ascending order of source gid: spikes gathered
+        // from a thread_private_spike_store are already in order.
+        auto source = [](const spike& s) {return s.source;};
+        if (!util::is_sorted_by(local_spikes, source)) {
+            util::sort_by(local_spikes, source);
+        }
 
         // global all-to-all to gather a local copy of the global spike list on each node.
-        auto global_spikes = comms_.gather_spikes(local_spikes);
-        num_spikes_ += global_spikes.size();
-        return global_spikes;
+        if (spike_quantum_) {
+            comms_.gather_compressed_spikes(local_spikes, global_spikes_, *spike_quantum_);
+        }
+        else {
+            comms_.gather_spikes(local_spikes, global_spikes_);
+        }
+        num_spikes_ += global_spikes_.size();
+        return global_spikes_;
+    }
+
+    /// Exchange spikes in the compressed wire format of spike_codec.hpp, with
+    /// spike times quantized by quantum, or exactly if quantum is zero; or
+    /// verbatim if quantum is nothing.
+    void set_spike_compression(util::optional<time_type> quantum) {
+        spike_quantum_ = quantum;
+    }
+
+    /// Leave the events of the stored connections between cells on this
+    /// domain to make_local_events, instead of making them in
+    /// make_event_queues.
+    void set_local_delivery(bool local) {
+        local_delivery_ = local;
+    }
+
+    /// Make the events of the stored connections between cells on this
+    /// domain, for spikes of cells on this domain sorted by source, and
+    /// append them to events, tagged by the index of their target cell.
+    void make_local_events(const std::vector<spike>& spikes, std::vector<event_lanes::staged_event>& events) const {
+        auto cons = local_connections();
+        auto cn = cons.begin();
+        for (const auto& spk: spikes) {
+            auto targets = std::equal_range(cn, cons.end(), spk.source);
+            for (auto c: util::make_range(targets)) {
+                events.push_back({c.index_on_domain(), c.make_event(spk)});
+            }
+            cn = targets.first;
+        }
     }
 
     /// Check each global spike in turn to see it generates local events.
     /// If so, make the events and insert them into the appropriate event list.
-    /// Return a vector that contains the event queues for each local cell group.
     ///
-    /// Returns a vector of event queues, with one queue for each local cell group. The
-    /// events in each queue are all events that must be delivered to targets in that cell
-    /// group as a result of the global spike exchange.
-    std::vector<pse_vector> make_event_queues(const gathered_vector<spike>& global_spikes) {
+    /// On return queues holds one event lane for each local cell. The events
+    /// in each lane are all events that must be delivered to targets on that
+    /// cell as a result of the global spike exchange; they are not sorted.
+    /// The storage of queues is reused, so that passing the same queues on
+    /// successive calls does not allocate once its high water mark is reached.
+    /// With local delivery, the spikes from this domain are skipped.
+    void make_event_queues(const gathered_vector<spike>& global_spikes, event_lanes& queues) {
         using util::subrange_view;
         using util::make_span;
         using util::make_range;
 
-        auto queues = std::vector<pse_vector>(num_local_cells_);
+        // Events are staged with the index of their target cell, then
+        // scattered into the flat event lanes in one pass.
+        staged_events_.clear();
         const auto& sp = global_spikes.partition();
         const auto& cp = connection_part_;
         for (auto dom: make_span(0, num_domains_)) {
+            if (local_delivery_ && dom==cell_size_type(comms_.id())) continue;
+
             auto cons = subrange_view(connections_, cp[dom], cp[dom+1]);
             auto spks = subrange_view(global_spikes.values(), sp[dom], sp[dom+1]);
 
@@ -189,7 +332,7 @@ public:
                 while (cn!=cons.end() && sp!=spks.end()) {
                     auto sources = std::equal_range(sp, spks.end(), cn->source(), spike_pred());
                     for (auto s: make_range(sources)) {
-                        queues[cn->index_on_domain()].push_back(cn->make_event(s));
+                        staged_events_.push_back({cn->index_on_domain(), cn->make_event(s)});
                     }
 
                     sp = sources.first;
@@ -200,9 +343,18 @@ public:
                 auto cn = cons.begin();
                 auto sp = spks.begin();
                 while (cn!=cons.end() && sp!=spks.end()) {
+                    // Most spikes have no local targets: reject them
+                    // without searching the connections.
+                    if (!filter_.may_contain(sp->source.gid)) {
+                        ++filter_stats_.misses;
+                        ++sp;
+                        continue;
+                    }
+                    ++filter_stats_.hits;
+
                     auto targets = std::equal_range(cn, cons.end(), sp->source);
                     for (auto c: make_range(targets)) {
-                        queues[c.index_on_domain()].push_back(c.make_event(*sp));
+                        staged_events_.push_back({c.index_on_domain(), c.make_event(*sp)});
                     }
 
                     cn = targets.first;
@@ -211,7 +363,41 @@ public:
             }
         }
 
-        return queues;
+        // Regenerate the procedural connections from each spike onto the
+        // local cells.
+        if (rule_) {
+            for (const auto& spk: global_spikes.values()) {
+                for (const auto& run: local_runs_) {
+                    generated_.clear();
+                    rule_->connections_from(spk.source, run.first, run.last, generated_);
+                    for (const auto& c: generated_) {
+                        connection con(c.source, c.dest, c.weight, c.delay, run.index+(c.dest.gid-run.first));
+                        staged_events_.push_back({con.index_on_domain(), con.make_event(spk)});
+                    }
+                }
+            }
+        }
+
+        queues.assign(num_local_cells_, staged_events_);
+    }
+
+    /// Set the weight of the stored connections from source to the local
+    /// target dest. Returns the number of connections changed, which is zero
+    /// if dest is not on this domain. Procedural connections are not stored,
+    /// and are not changed.
+    std::size_t set_connection_weight(cell_member_type source, cell_member_type dest, float weight) {
+        std::size_t n = 0;
+        const auto& cp = connection_part_;
+        for (auto dom: util::make_span(0, num_domains_)) {
+            auto cons = util::subrange_view(connections_, cp[dom], cp[dom+1]);
+            for (auto& c: util::make_range(std::equal_range(cons.begin(), cons.end(), source))) {
+                if (c.destination()==dest) {
+                    c = connection(c.source(), dest, weight, c.delay(), c.index_on_domain());
+                    ++n;
+                }
+            }
+        }
+        return n;
     }
 
     /// Returns the total number of global spikes over the duration of the simulation
@@ -225,21 +411,78 @@ public:
         return connections_;
     }
 
+    /// Whether connections are also generated by a procedural rule.
+    bool has_procedural_connections() const {
+        return bool(rule_);
+    }
+
+    /// The set of the source gids of the connections on this domain.
+    const source_filter& filter() const {
+        return filter_;
+    }
+
+    /// The number of spikes that make_event_queues tested against filter(),
+    /// of which those that passed are hits, and those rejected are misses.
+    /// Spikes matched to connections by walking the connections, and the
+    /// spikes of procedural connections, are not tested.
+    const source_filter_stats& filter_stats() const {
+        return filter_stats_;
+    }
+
     void reset() {
         num_spikes_ = 0;
+        filter_stats_ = source_filter_stats();
+    }
+
+    void checkpoint(checkpoint_writer& w) const {
+        w.write(num_spikes_);
+    }
+
+    void restore(checkpoint_reader& r) {
+        r.read(num_spikes_);
     }
 
 private:
+    // The connections from cells on this domain.
+    util::subrange_view_type<const std::vector<connection>> local_connections() const {
+        const auto& cp = connection_part_;
+        const auto dom = comms_.id();
+        return util::subrange_view(connections_, cp[dom], cp[dom+1]);
+    }
+
     cell_size_type num_local_cells_;
     cell_size_type num_local_groups_;
     cell_size_type num_domains_;
     std::vector<connection> connections_;
     std::vector<cell_size_type> connection_part_;
+    source_filter filter_;
+    source_filter_stats filter_stats_;
     std::vector<cell_size_type> index_divisions_;
     util::partition_view_type<std::vector<cell_size_type>> index_part_;
 
+    // The rule for procedural connections, if any, and the runs of local
+    // cells with gids [first, last) and indexes on the domain from index.
+    struct gid_run {
+        cell_gid_type first;
+        cell_gid_type last;
+        cell_size_type index;
+    };
+    connection_rule_ptr rule_;
+    std::vector<gid_run> local_runs_;
+
     communication_policy_type comms_;
     std::uint64_t num_spikes_ = 0u;
+    util::optional<time_type> spike_quantum_;
+    bool local_delivery_ = false;
+
+    // Buffer for the global spikes gathered by exchange.
+    gathered_vector<spike> global_spikes_;
+
+    // Scratch space for events generated by make_event_queues.
+    std::vector<event_lanes::staged_event> staged_events_;
+
+    // Scratch space for the procedural connections of a spike.
+    std::vector<cell_connection> generated_;
 };
 
 } // namespace communication
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <common_types.hpp>
+#include <communication/gathered_vector.hpp>
+#include <communication/global_policy.hpp>
+#include <communication/spike_codec.hpp>
+#include <spike.hpp>
+
+namespace arb {
+namespace communication {
+
+// A distributed_context is the communication between the domains of a model.
+// It wraps a communication policy, so that models in the same process can
+// use different policies: e.g. one model distributed over all ranks with the
+// global policy, beside models that each run on a single domain with the
+// local policy.
+//
+// Any type that provides the interface below can be wrapped; copies of a
+// distributed_context share the wrapped policy.
+class distributed_context {
+public:
+    // The global communication policy of the build.
+    distributed_context();
+
+    template <typename Impl>
+    explicit distributed_context(Impl impl):
+        impl_(std::make_shared<wrap<Impl>>(std::move(impl)))
+    {}
+
+    void gather_spikes(const std::vector<spike>& local_spikes, gathered_vector<spike>& global_spikes) const {
+        impl_->gather_spikes(local_spikes, global_spikes);
+    }
+
+    gathered_vector<spike> gather_spikes(const std::vector<spike>& local_spikes) const {
+        gathered_vector<spike> global_spikes;
+        gather_spikes(local_spikes, global_spikes);
+        return global_spikes;
+    }
+
+    void gather_compressed_spikes(const std::vector<spike>& local_spikes,
+                                  gathered_vector<spike>& global_spikes,
+                                  time_type quantum) const
+    {
+        impl_->gather_compressed_spikes(local_spikes, global_spikes, quantum);
+    }
+
+    int id() const { return impl_->id(); }
+    int size() const { return impl_->size(); }
+
+    time_type min(time_type value) const { return impl_->min(value); }
+
+    void barrier() const { impl_->barrier(); }
+
+    global_policy_kind kind() const { return impl_->kind(); }
+
+private:
+    struct interface {
+        virtual void gather_spikes(const std::vector<spike>&, gathered_vector<spike>&) = 0;
+        virtual void gather_compressed_spikes(const std::vector<spike>&, gathered_vector<spike>&, time_type) = 0;
+        virtual int id() = 0;
+        virtual int size() = 0;
+        virtual time_type min(time_type) = 0;
+        virtual void barrier() = 0;
+        virtual global_policy_kind kind() = 0;
+        virtual ~interface() {}
+    };
+
+    template <typename Impl>
+    struct wrap: interface {
+        explicit wrap(Impl impl): wrapped(std::move(impl)) {}
+
+        void gather_spikes(const std::vector<spike>& local_spikes, gathered_vector<spike>& global_spikes) override {
+            wrapped.gather_spikes(local_spikes, global_spikes);
+        }
+        void gather_compressed_spikes(const std::vector<spike>& local_spikes,
+                                      gathered_vector<spike>& global_spikes,
+                                      time_type quantum) override
+        {
+            wrapped.gather_compressed_spikes(local_spikes, global_spikes, quantum);
+        }
+        int id() override { return wrapped.id(); }
+        int size() override { return wrapped.size(); }
+        time_type min(time_type value) override { return wrapped.min(value); }
+        void barrier() override { wrapped.barrier(); }
+        global_policy_kind kind() override { return wrapped.kind(); }
+
+        Impl wrapped;
+    };
+
+    std::shared_ptr<interface> impl_;
+};
+
+// A single domain, whatever the global policy of the build.
+struct local_policy {
+    void gather_spikes(const std::vector<spike>& local_spikes, gathered_vector<spike>& global_spikes) const {
+        using count_type = gathered_vector<spike>::count_type;
+        global_spikes.values().assign(local_spikes.begin(), local_spikes.end());
+        global_spikes.partition().assign({0u, static_cast<count_type>(local_spikes.size())});
+    }
+
+    void gather_compressed_spikes(const std::vector<spike>& local_spikes,
+                                  gathered_vector<spike>& global_spikes,
+                                  time_type quantum) const
+    {
+        gather_spikes(quantize_spikes(local_spikes, quantum), global_spikes);
+    }
+
+    int id() const { return 0; }
+    int size() const { return 1; }
+    time_type min(time_type value) const { return value; }
+    void barrier() const {}
+    global_policy_kind kind() const { return global_policy_kind::serial; }
+};
+
+inline distributed_context::distributed_context():
+    distributed_context(global_policy{})
+{}
+
+inline distributed_context global_context() {
+    return distributed_context();
+}
+
+inline distributed_context local_context() {
+    return distributed_context(local_policy{});
+}
+
+} // namespace communication
+} // namespace arb
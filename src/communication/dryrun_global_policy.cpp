@@ -5,6 +5,8 @@ namespace communication {
 
 int dryrun_communicator_size=0;
 int dryrun_num_local_cells=0;
+network_model_ptr dryrun_network_model;
+double dryrun_network_time=0;
 
 } // namespace communication
 } // namespace arb
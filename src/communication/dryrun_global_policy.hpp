@@ -5,6 +5,8 @@
 #include <vector>
 
 #include <communication/gathered_vector.hpp>
+#include <communication/network_model.hpp>
+#include <communication/spike_codec.hpp>
 #include <util/span.hpp>
 #include <spike.hpp>
 
@@ -13,36 +15,41 @@ namespace communication {
 
 extern int dryrun_num_local_cells;
 extern int dryrun_communicator_size;
+extern network_model_ptr dryrun_network_model;
+extern double dryrun_network_time;
 
 struct dryrun_global_policy {
     template <typename Spike>
     static gathered_vector<Spike>
     gather_spikes(const std::vector<Spike>& local_spikes) {
-        using util::make_span;
-        using count_type = typename gathered_vector<Spike>::count_type;
+        gathered_vector<Spike> global_spikes;
+        gather_spikes(local_spikes, global_spikes);
+        return global_spikes;
+    }
 
-        // Build the global spike list by replicating the local spikes for each
-        // "dummy" domain.
-        const auto num_spikes_local  = local_spikes.size();
-        const auto num_spikes_global = size()*num_spikes_local;
-        std::vector<Spike> global_spikes(num_spikes_global);
-        std::vector<count_type> partition(size()+1);
+    template <typename Spike>
+    static void
+    gather_spikes(const std::vector<Spike>& local_spikes, gathered_vector<Spike>& gathered) {
+        // As with MPI: gather the counts, then the spikes.
+        predict_allgather(sizeof(int));
+        predict_allgather(local_spikes.size()*sizeof(Spike));
+        replicate_spikes(local_spikes, gathered);
+    }
 
-        for (auto rank: make_span(0u, size())) {
-            const auto first_cell = rank*dryrun_num_local_cells;
-            const auto first_spike = rank*num_spikes_local;
-            for (auto i: make_span(0, num_spikes_local)) {
-                // the new global spike is the same as the local spike, with
-                // its source index shifted to the dummy domain
-                auto s = local_spikes[i];
-                s.source.gid += first_cell;
-                global_spikes[first_spike+i] = s;
-            }
-            partition[rank+1] = partition[rank]+num_spikes_local;
+    // Gather spikes through the compressed wire format of spike_codec.hpp,
+    // with times quantized by quantum. The spikes are encoded only to
+    // predict the time to exchange them.
+    static void gather_compressed_spikes(const std::vector<spike>& local_spikes,
+                                         gathered_vector<spike>& global_spikes,
+                                         time_type quantum)
+    {
+        if (dryrun_network_model) {
+            thread_local static std::vector<char> encoded;
+            encode_spikes(local_spikes, quantum, encoded);
+            predict_allgather(sizeof(int));
+            predict_allgather(encoded.size());
         }
-
-        EXPECTS(partition.back()==num_spikes_global);
-        return {std::move(global_spikes), std::move(partition)};
+        replicate_spikes(quantize_spikes(local_spikes, quantum), global_spikes);
     }
 
     static int id() {
@@ -58,18 +65,33 @@ struct dryrun_global_policy {
         dryrun_num_local_cells = num_local_cells;
     }
 
+    // Set the model of the network with which to predict the time taken by
+    // the exchanges and reductions between the ranks of the dry run, or none
+    // to make no predictions.
+    static void set_network_model(network_model_ptr model) {
+        dryrun_network_model = std::move(model);
+    }
+
+    // The predicted time [s] taken by the exchanges and reductions so far.
+    static double predicted_network_time() {
+        return dryrun_network_time;
+    }
+
     template <typename T>
     static T min(T value) {
+        predict_allreduce(sizeof(T));
         return value;
     }
 
     template <typename T>
     static T max(T value) {
+        predict_allreduce(sizeof(T));
         return value;
     }
 
     template <typename T>
     static T sum(T value) {
+        predict_allreduce(sizeof(T));
         return size()*value;
     }
 
@@ -84,6 +106,49 @@ struct dryrun_global_policy {
     static void teardown() {}
 
     static global_policy_kind kind() { return global_policy_kind::dryrun; };
+
+private:
+    static void predict_allgather(std::size_t bytes) {
+        if (dryrun_network_model) {
+            dryrun_network_time += dryrun_network_model->allgather(size(), bytes);
+        }
+    }
+
+    static void predict_allreduce(std::size_t bytes) {
+        if (dryrun_network_model) {
+            dryrun_network_time += dryrun_network_model->allreduce(size(), bytes);
+        }
+    }
+
+    template <typename Spike>
+    static void
+    replicate_spikes(const std::vector<Spike>& local_spikes, gathered_vector<Spike>& gathered) {
+        using util::make_span;
+
+        // Build the global spike list by replicating the local spikes for each
+        // "dummy" domain.
+        const auto num_spikes_local  = local_spikes.size();
+        const auto num_spikes_global = size()*num_spikes_local;
+        auto& global_spikes = gathered.values();
+        auto& partition = gathered.partition();
+        global_spikes.resize(num_spikes_global);
+        partition.assign(size()+1, 0u);
+
+        for (auto rank: make_span(0u, size())) {
+            const auto first_cell = rank*dryrun_num_local_cells;
+            const auto first_spike = rank*num_spikes_local;
+            for (auto i: make_span(0, num_spikes_local)) {
+                // the new global spike is the same as the local spike, with
+                // its source index shifted to the dummy domain
+                auto s = local_spikes[i];
+                s.source.gid += first_cell;
+                global_spikes[first_spike+i] = s;
+            }
+            partition[rank+1] = partition[rank]+num_spikes_local;
+        }
+
+        EXPECTS(partition.back()==num_spikes_global);
+    }
 };
 
 using global_policy = dryrun_global_policy;
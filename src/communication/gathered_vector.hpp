@@ -14,6 +14,8 @@ public:
     using value_type = T;
     using count_type = unsigned;
 
+    gathered_vector(): partition_(1, 0u) {}
+
     gathered_vector(std::vector<value_type>&& v, std::vector<count_type>&& p) :
         values_(std::move(v)),
         partition_(std::move(p))
@@ -27,6 +29,16 @@ public:
         return partition_;
     }
 
+    /// mutable access to the partition and values, used by the communication
+    /// policies to gather into the storage of an existing gathered vector
+    std::vector<count_type>& partition() {
+        return partition_;
+    }
+
+    std::vector<value_type>& values() {
+        return values_;
+    }
+
     /// the number of entries in the gathered vector in partition i
     count_type count(std::size_t i) const {
         return partition_[i+1] - partition_[i];
@@ -3,7 +3,7 @@
 #include <string>
 
 namespace arb {  namespace communication {
-    enum class global_policy_kind {serial, mpi, dryrun};
+    enum class global_policy_kind {serial, mpi, dryrun, shmem};
 }}
 
 namespace std {
@@ -16,6 +16,9 @@ namespace std {
         if (k == global_policy_kind::dryrun) {
             return "dryrun";
         }
+        if (k == global_policy_kind::shmem) {
+            return "shmem";
+        }
         return "serial";
     }
 }
@@ -24,6 +27,8 @@ namespace std {
     #include "mpi_global_policy.hpp"
 #elif defined(ARB_HAVE_DRYRUN)
     #include "dryrun_global_policy.hpp"
+#elif defined(ARB_HAVE_SHMEM)
+    #include "shmem_global_policy.hpp"
 #else
     #include "serial_global_policy.hpp"
 #endif
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
 #include <mpi.h>
 
 #include <communication/mpi.hpp>
@@ -15,6 +20,124 @@ namespace state {
     int rank = 0;
 } // namespace state
 
+namespace {
+
+// A buffer in memory shared by the ranks of a node, allocated by the leader
+// of the node and grown as required. Reallocation is collective over the
+// node, and must be requested with the same size by all of its ranks.
+struct shared_buffer {
+    MPI_Win win = MPI_WIN_NULL;
+    char* data = nullptr;
+    std::size_t capacity = 0;
+
+    void reserve(std::size_t n, MPI_Comm comm, int node_rank) {
+        if (n<=capacity && win!=MPI_WIN_NULL) return;
+        free();
+
+        // Grow geometrically to amortize the cost of reallocation.
+        capacity = std::max<std::size_t>(n, 2*capacity);
+        char* base = nullptr;
+        MPI_Win_allocate_shared(node_rank==0? capacity: 0, 1, MPI_INFO_NULL, comm, &base, &win);
+
+        MPI_Aint size;
+        int disp;
+        MPI_Win_shared_query(win, 0, &size, &disp, &data);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    }
+
+    void sync() {
+        if (win!=MPI_WIN_NULL) MPI_Win_sync(win);
+    }
+
+    void free() {
+        if (win!=MPI_WIN_NULL) {
+            MPI_Win_unlock_all(win);
+            MPI_Win_free(&win);
+        }
+        win = MPI_WIN_NULL;
+        data = nullptr;
+    }
+};
+
+// The division of the ranks into nodes.
+struct node_state {
+    bool initialized = false;
+    int ranks_per_node = 0;     // 0: ranks that share memory
+
+    MPI_Comm node = MPI_COMM_NULL;      // the ranks of this node
+    MPI_Comm leaders = MPI_COMM_NULL;   // the first rank of each node
+    int node_rank = 0;
+    int node_size = 1;
+    int num_nodes = 1;
+    bool aggregate = false;
+
+    // On leaders: the number of ranks on, and first rank of, each node.
+    std::vector<int> node_sizes;
+    std::vector<int> node_first;
+
+    // The bytes gathered from the ranks of the node, and from all ranks.
+    shared_buffer staging;
+    shared_buffer global;
+
+    // Scratch space for counts and displacements.
+    std::vector<int> node_counts;
+    std::vector<int> node_displs;
+    std::vector<int> counts;
+    std::vector<int> node_totals;
+};
+
+node_state nodes;
+
+exchange_context global_exchange;
+
+void free_nodes() {
+    if (!nodes.initialized) return;
+    nodes.staging.free();
+    nodes.global.free();
+    if (nodes.leaders!=MPI_COMM_NULL) MPI_Comm_free(&nodes.leaders);
+    if (nodes.node!=MPI_COMM_NULL) MPI_Comm_free(&nodes.node);
+    nodes.initialized = false;
+}
+
+void setup_nodes() {
+    if (nodes.initialized) return;
+    nodes.initialized = true;
+
+    if (nodes.ranks_per_node>0) {
+        MPI_Comm_split(MPI_COMM_WORLD, state::rank/nodes.ranks_per_node, state::rank, &nodes.node);
+    }
+    else {
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, state::rank, MPI_INFO_NULL, &nodes.node);
+    }
+    MPI_Comm_rank(nodes.node, &nodes.node_rank);
+    MPI_Comm_size(nodes.node, &nodes.node_size);
+
+    MPI_Comm_split(MPI_COMM_WORLD, nodes.node_rank==0? 0: MPI_UNDEFINED, state::rank, &nodes.leaders);
+
+    // The gathered values are in rank order, so the ranks of each node must
+    // be consecutive for the leaders to exchange the values of their nodes
+    // as contiguous blocks.
+    std::vector<int> ranks(nodes.node_size);
+    MPI_Allgather(&state::rank, 1, MPI_INT, ranks.data(), 1, MPI_INT, nodes.node);
+    bool consecutive = true;
+    for (int i=0; i<nodes.node_size; ++i) {
+        consecutive = consecutive && ranks[i]==ranks[0]+i;
+    }
+
+    if (nodes.node_rank==0) {
+        MPI_Comm_size(nodes.leaders, &nodes.num_nodes);
+        nodes.node_sizes.resize(nodes.num_nodes);
+        MPI_Allgather(&nodes.node_size, 1, MPI_INT, nodes.node_sizes.data(), 1, MPI_INT, nodes.leaders);
+        nodes.node_first = algorithms::make_index(nodes.node_sizes);
+    }
+    MPI_Bcast(&nodes.num_nodes, 1, MPI_INT, 0, nodes.node);
+
+    // Aggregation only pays if some node has more than one rank.
+    nodes.aggregate = ballot(consecutive) && nodes.num_nodes<state::size;
+}
+
+} // namespace
+
 void init(int *argc, char ***argv) {
     int provided;
 
@@ -31,6 +154,9 @@ void init(int *argc, char ***argv) {
 }
 
 void finalize() {
+    free_nodes();
+    global_exchange.release();
+
     PE("MPI", "Finalize");
     MPI_Finalize();
     PL(2);
@@ -65,5 +191,197 @@ bool ballot(bool vote) {
     return result;
 }
 
+void set_ranks_per_node(int ranks_per_node) {
+    free_nodes();
+    nodes.ranks_per_node = ranks_per_node;
+}
+
+bool node_aggregation() {
+    setup_nodes();
+    return nodes.aggregate;
+}
+
+int num_nodes() {
+    setup_nodes();
+    return nodes.num_nodes;
+}
+
+const char* node_gather_all(const void* data, int nbytes, std::vector<int>& counts) {
+    setup_nodes();
+    auto& n = nodes;
+    const bool leader = n.node_rank==0;
+
+    // Gathering the counts of the node also ensures that every rank of the
+    // node has finished reading the values of the last gather before they
+    // are overwritten.
+    PE("MPI", "node-Allgather");
+    n.node_counts.resize(n.node_size);
+    MPI_Allgather(&nbytes, 1, MPI_INT, n.node_counts.data(), 1, MPI_INT, n.node);
+    PL(2);
+
+    n.node_displs = algorithms::make_index(n.node_counts);
+    const int node_total = n.node_displs.back();
+
+    n.staging.reserve(node_total, n.node, n.node_rank);
+    std::memcpy(n.staging.data+n.node_displs[n.node_rank], data, nbytes);
+
+    // The leaders gather the counts of all ranks, and share them with the
+    // ranks of their node.
+    counts.resize(state::size);
+    PE("MPI", "leader-Allgatherv");
+    if (leader) {
+        MPI_Allgatherv(n.node_counts.data(), n.node_size, MPI_INT,
+                       counts.data(), n.node_sizes.data(), n.node_first.data(), MPI_INT,
+                       n.leaders);
+    }
+    PL(2);
+    PE("MPI", "node-Bcast");
+    MPI_Bcast(counts.data(), state::size, MPI_INT, 0, n.node);
+    PL(2);
+
+    // With one node, the values of the node are all of the values.
+    if (n.num_nodes==1) {
+        n.staging.sync();
+        MPI_Barrier(n.node);
+        n.staging.sync();
+        return n.staging.data;
+    }
+
+    std::size_t total = 0;
+    for (auto c: counts) total += c;
+    n.global.reserve(total, n.node, n.node_rank);
+
+    // The leaders exchange the values of their nodes, once all ranks of the
+    // node have written their values.
+    n.staging.sync();
+    MPI_Barrier(n.node);
+    n.staging.sync();
+
+    if (leader) {
+        n.node_totals.assign(n.num_nodes, 0);
+        for (int i=0; i<n.num_nodes; ++i) {
+            for (int r=n.node_first[i]; r<n.node_first[i+1]; ++r) {
+                n.node_totals[i] += counts[r];
+            }
+        }
+        auto node_offsets = algorithms::make_index(n.node_totals);
+
+        PE("MPI", "leader-Allgatherv");
+        MPI_Allgatherv(n.staging.data, node_total, MPI_CHAR,
+                       n.global.data, n.node_totals.data(), node_offsets.data(), MPI_CHAR,
+                       n.leaders);
+        PL(2);
+    }
+
+    n.global.sync();
+    MPI_Barrier(n.node);
+    n.global.sync();
+    return n.global.data;
+}
+
+exchange_context& exchange() {
+    return global_exchange;
+}
+
+void exchange_context::release() {
+#if MPI_VERSION>=4
+    if (request_!=MPI_REQUEST_NULL) {
+        MPI_Request_free(&request_);
+    }
+#endif
+}
+
+void exchange_context::start(const void* data, int nbytes) {
+    data_ = static_cast<const char*>(data);
+    nbytes_ = nbytes;
+
+    const int n = size();
+    const int stride = sizeof(int)+slot_;
+
+    // The buffers, and with MPI 4 the persistent collective that refers to
+    // them, only change with the size of the slot.
+    if (send_.size()!=std::size_t(stride)) {
+        send_.resize(stride);
+        slots_.resize(n*stride);
+#if MPI_VERSION>=4
+        release();
+        MPI_Allgather_init(send_.data(), stride, MPI_CHAR,
+                           slots_.data(), stride, MPI_CHAR,
+                           MPI_COMM_WORLD, MPI_INFO_NULL, &request_);
+#endif
+    }
+
+    std::memcpy(send_.data(), &nbytes, sizeof(int));
+    if (slot_ && nbytes) {
+        std::memcpy(send_.data()+sizeof(int), data, std::min(nbytes, slot_));
+    }
+
+    PE("MPI", "Allgather");
+#if MPI_VERSION>=4
+    MPI_Start(&request_);
+    MPI_Wait(&request_, MPI_STATUS_IGNORE);
+#else
+    MPI_Allgather(send_.data(), stride, MPI_CHAR,
+                  slots_.data(), stride, MPI_CHAR,
+                  MPI_COMM_WORLD);
+#endif
+    PL(2);
+
+    counts_.resize(n);
+    displs_.resize(n+1);
+    displs_[0] = 0;
+    for (int i=0; i<n; ++i) {
+        std::memcpy(&counts_[i], slots_.data()+i*stride, sizeof(int));
+        displs_[i+1] = displs_[i]+counts_[i];
+    }
+}
+
+void exchange_context::finish(void* out) {
+    const int n = size();
+    const int stride = sizeof(int)+slot_;
+    char* dest = static_cast<char*>(out);
+
+    if (!slot_) {
+        PE("MPI", "Allgatherv-partition");
+        MPI_Allgatherv(const_cast<char*>(data_), nbytes_, MPI_CHAR,
+                       dest, counts_.data(), displs_.data(), MPI_CHAR,
+                       MPI_COMM_WORLD);
+        PL(2);
+    }
+    else {
+        // Gather the data that did not fit in the slots.
+        overflow_counts_.resize(n);
+        for (int i=0; i<n; ++i) {
+            overflow_counts_[i] = std::max(counts_[i]-slot_, 0);
+        }
+        overflow_displs_ = algorithms::make_index(overflow_counts_);
+        if (overflow_displs_.back()) {
+            overflow_.resize(overflow_displs_.back());
+            PE("MPI", "Allgatherv-overflow");
+            MPI_Allgatherv(const_cast<char*>(data_)+std::min(nbytes_, slot_), overflow_counts_[rank()], MPI_CHAR,
+                           overflow_.data(), overflow_counts_.data(), overflow_displs_.data(), MPI_CHAR,
+                           MPI_COMM_WORLD);
+            PL(2);
+        }
+
+        for (int i=0; i<n; ++i) {
+            const int in_slot = std::min(counts_[i], slot_);
+            std::memcpy(dest+displs_[i], slots_.data()+i*stride+sizeof(int), in_slot);
+            if (overflow_counts_[i]) {
+                std::memcpy(dest+displs_[i]+in_slot,
+                            overflow_.data()+overflow_displs_[i], overflow_counts_[i]);
+            }
+        }
+    }
+
+    // Choose the slot for the next gather. The slot is a multiple of 64
+    // bytes, so that it is stable while the amount of data changes little.
+    const int largest = *std::max_element(counts_.begin(), counts_.end());
+    const int slot = (largest+63)/64*64;
+    const bool use_slots = slot<=max_slot_bytes &&
+        std::int64_t(n)*slot <= 2*std::int64_t(displs_.back())+std::int64_t(n)*64;
+    slot_ = use_slots? slot: 0;
+}
+
 } // namespace mpi
 } // namespace arb
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <type_traits>
 #include <vector>
@@ -27,6 +28,29 @@ namespace mpi {
     void barrier();
     bool ballot(bool vote);
 
+    // Node-local aggregation for gathers to all ranks: the ranks of a node
+    // combine their values in memory shared by the node, and the first rank
+    // of each node, its leader, exchanges the values of the node with the
+    // other leaders, into shared memory from which the ranks of the node read
+    // the gathered values. This divides the number of ranks that take part
+    // in the exchange between nodes by the number of ranks per node.
+    //
+    // By default the ranks of a node are those that share memory; a fixed
+    // number of consecutive ranks per node can be set instead, e.g. for
+    // testing, as long as the ranks of each node share memory. Aggregation is
+    // used if some node has more than one rank, and the ranks of each node
+    // are consecutive. Setting one rank per node disables it.
+    // Collective: must be called by all ranks.
+    void set_ranks_per_node(int ranks_per_node);
+    bool node_aggregation();
+    int num_nodes();
+
+    // Gather nbytes bytes from each rank, in rank order, with node-local
+    // aggregation. Returns a pointer to the gathered bytes in shared memory,
+    // which is valid until the next call, and sets counts to the number of
+    // bytes from each rank.
+    const char* node_gather_all(const void* data, int nbytes, std::vector<int>& counts);
+
     // type traits for automatically setting MPI_Datatype information
     // for C++ types
     template <typename T>
@@ -188,6 +212,161 @@ namespace mpi {
         );
     }
 
+    /// Gather all of a distributed vector into the storage of an existing
+    /// gathered vector, retaining the meta data (i.e. vector partition).
+    /// The count and displacement buffers are kept between calls, so that
+    /// gathering into the same vector does not allocate once its high water
+    /// mark is reached.
+    template <typename T>
+    void gather_all_with_partition(const std::vector<T>& values, gathered_vector<T>& gathered) {
+        using traits = mpi_traits<T>;
+
+        thread_local static std::vector<int> counts;
+        thread_local static std::vector<int> displs;
+
+        counts.resize(size());
+        int count = values.size();
+        PE("MPI", "Allgather");
+        MPI_Allgather( &count,        1, mpi_traits<int>::mpi_type(), // send buffer
+                       counts.data(), 1, mpi_traits<int>::mpi_type(), // receive buffer
+                       MPI_COMM_WORLD);
+        PL(2);
+
+        displs.resize(size()+1);
+        displs[0] = 0;
+        for (auto i=0u; i<counts.size(); ++i) {
+            counts[i] *= traits::count();
+            displs[i+1] = displs[i]+counts[i];
+        }
+
+        auto& buffer = gathered.values();
+        buffer.resize(displs.back()/traits::count());
+
+        PE("MPI", "Allgatherv-partition");
+        MPI_Allgatherv(
+            // send buffer
+            // const_cast required for MPI implementations that don't use const* in their interfaces
+            const_cast<T*>(values.data()), counts[rank()], traits::mpi_type(),
+            // receive buffer
+            buffer.data(), counts.data(), displs.data(), traits::mpi_type(),
+            MPI_COMM_WORLD
+        );
+        PL(2);
+
+        auto& partition = gathered.partition();
+        partition.resize(displs.size());
+        for (auto i=0u; i<displs.size(); ++i) {
+            partition[i] = displs[i]/traits::count();
+        }
+    }
+
+    /// Gather all of a distributed vector with node-local aggregation into the
+    /// storage of an existing gathered vector, retaining the partition.
+    /// The values are copied once from the shared memory of the node into
+    /// the gathered vector, so that they are not overwritten by the next
+    /// gather while the rank is still using them.
+    template <typename T>
+    void node_gather_all_with_partition(const std::vector<T>& values, gathered_vector<T>& gathered) {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "node_gather_all_with_partition can only gather trivially copyable types");
+
+        thread_local static std::vector<int> counts;
+        const char* bytes = node_gather_all(values.data(), int(values.size()*sizeof(T)), counts);
+
+        auto& partition = gathered.partition();
+        partition.resize(counts.size()+1);
+        partition[0] = 0;
+        for (auto i=0u; i<counts.size(); ++i) {
+            partition[i+1] = partition[i]+counts[i]/sizeof(T);
+        }
+
+        auto& buffer = gathered.values();
+        buffer.resize(partition.back());
+        PE("MPI", "node-copy");
+        std::memcpy(buffer.data(), bytes, buffer.size()*sizeof(T));
+        PL(2);
+    }
+
+    /// A context for repeated gathers to all ranks of varying amounts of data,
+    /// such as the spikes of each epoch, which keeps its buffers between
+    /// gathers at their high water mark.
+    ///
+    /// When the amount of data from each rank is small, the data is carried in
+    /// a fixed size slot beside the count of each rank, so that the gather
+    /// takes one MPI_Allgather instead of an MPI_Allgather of the counts and
+    /// an MPI_Allgatherv of the data; data that does not fit in the slot of a
+    /// rank is gathered with a second MPI_Allgatherv. The size of the slot is
+    /// chosen from the counts of the last gather: slots are used while they
+    /// are no larger than max_slot_bytes, and padding each rank's data to the
+    /// largest at most doubles the amount of data gathered.
+    ///
+    /// With MPI 4, the MPI_Allgather is a persistent collective, which is
+    /// initialized again only when the size of the slot changes.
+    ///
+    /// The gathers of a context are collective, so that its slot size is the
+    /// same on all ranks. A context must be released before MPI is finalized.
+    class exchange_context {
+    public:
+        static constexpr int max_slot_bytes = 4096;
+
+        exchange_context() = default;
+        exchange_context(const exchange_context&) = delete;
+        exchange_context& operator=(const exchange_context&) = delete;
+        ~exchange_context() { release(); }
+
+        template <typename T>
+        void gather_all_with_partition(const std::vector<T>& values, gathered_vector<T>& gathered) {
+            static_assert(std::is_trivially_copyable<T>::value,
+                "exchange_context can only gather trivially copyable types");
+
+            start(values.data(), int(values.size()*sizeof(T)));
+
+            auto& buffer = gathered.values();
+            buffer.resize(displs_.back()/sizeof(T));
+            finish(buffer.data());
+
+            auto& partition = gathered.partition();
+            partition.resize(displs_.size());
+            for (auto i=0u; i<displs_.size(); ++i) {
+                partition[i] = displs_[i]/sizeof(T);
+            }
+        }
+
+        // The number of bytes of data carried beside the count of each rank
+        // in the next gather; zero if the counts are gathered on their own.
+        int slot_bytes() const { return slot_; }
+
+        // Free the persistent collective, if any.
+        void release();
+
+    private:
+        int slot_ = 0;
+        std::vector<char> send_;    // the count and slot of this rank
+        std::vector<char> slots_;   // the counts and slots of all ranks
+        std::vector<int> counts_;
+        std::vector<int> displs_;
+        std::vector<int> overflow_counts_;
+        std::vector<int> overflow_displs_;
+        std::vector<char> overflow_;
+
+        const char* data_ = nullptr;
+        int nbytes_ = 0;
+
+    #if MPI_VERSION>=4
+        MPI_Request request_ = MPI_REQUEST_NULL;
+    #endif
+
+        // Gather the counts, and the slots, of all ranks.
+        void start(const void* data, int nbytes);
+
+        // Gather the data that is not in the slots, and copy the data of all
+        // ranks to out.
+        void finish(void* out);
+    };
+
+    // The context of the gathers of the global policy.
+    exchange_context& exchange();
+
     template <typename T>
     T reduce(T value, MPI_Op op, int root) {
         using traits = mpi_traits<T>;
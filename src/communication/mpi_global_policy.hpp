@@ -13,6 +13,7 @@
 #include <common_types.hpp>
 #include <communication/gathered_vector.hpp>
 #include <communication/mpi.hpp>
+#include <communication/spike_codec.hpp>
 #include <spike.hpp>
 
 namespace arb {
@@ -25,6 +26,43 @@ struct mpi_global_policy {
         return mpi::gather_all_with_partition(local_spikes);
     }
 
+    template <typename Spike>
+    static void
+    gather_spikes(const std::vector<Spike>& local_spikes, gathered_vector<Spike>& global_spikes) {
+        gather_all(local_spikes, global_spikes);
+    }
+
+    // Gather spikes through the compressed wire format of spike_codec.hpp,
+    // with times quantized by quantum: the encoded buffers are gathered, then
+    // the buffer of each domain is decoded into its partition of the global
+    // spikes.
+    static void gather_compressed_spikes(const std::vector<spike>& local_spikes,
+                                         gathered_vector<spike>& global_spikes,
+                                         time_type quantum)
+    {
+        thread_local static std::vector<char> encoded;
+        thread_local static gathered_vector<char> gathered;
+
+        PE("MPI", "encode");
+        encode_spikes(local_spikes, quantum, encoded);
+        PL(2);
+
+        gather_all(encoded, gathered);
+
+        PE("MPI", "decode");
+        const auto& bytes = gathered.values();
+        const auto& bp = gathered.partition();
+        auto& values = global_spikes.values();
+        auto& partition = global_spikes.partition();
+        values.clear();
+        partition.assign(1, 0u);
+        for (auto i=0u; i+1<bp.size(); ++i) {
+            decode_spikes(bytes.data()+bp[i], bytes.data()+bp[i+1], values);
+            partition.push_back(values.size());
+        }
+        PL(2);
+    }
+
     static int id() { return mpi::rank(); }
 
     static int size() { return mpi::size(); }
@@ -68,6 +106,20 @@ struct mpi_global_policy {
     }
 
     static global_policy_kind kind() { return global_policy_kind::mpi; };
+
+private:
+    // Gather to all ranks, with node-local aggregation where it applies:
+    // see mpi::set_ranks_per_node, or through the persistent context of the
+    // gathers of the policy: see mpi::exchange_context.
+    template <typename T>
+    static void gather_all(const std::vector<T>& values, gathered_vector<T>& gathered) {
+        if (mpi::node_aggregation()) {
+            mpi::node_gather_all_with_partition(values, gathered);
+        }
+        else {
+            mpi::exchange().gather_all_with_partition(values, gathered);
+        }
+    }
 };
 
 using global_policy = mpi_global_policy;
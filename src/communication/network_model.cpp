@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <cstddef>
+
+#include <communication/network_model.hpp>
+
+namespace arb {
+namespace communication {
+
+namespace {
+    // The number of rounds of recursive doubling over num_ranks ranks.
+    int doubling_rounds(int num_ranks) {
+        int rounds = 0;
+        while ((1<<rounds)<num_ranks) ++rounds;
+        return rounds;
+    }
+}
+
+double loggp_model::message(std::size_t bytes) const {
+    double t = p_.L + 2*p_.o + (bytes? bytes-1: 0)*p_.G;
+    return std::max(t, p_.g);
+}
+
+double loggp_model::allgather(int num_ranks, std::size_t bytes) const {
+    if (num_ranks<2) return 0;
+
+    // In round i of recursive doubling, each rank sends the data of 2^i
+    // ranks, or of the ranks that remain in the last round.
+    double doubling = 0;
+    std::size_t ranks_held = 1;
+    for (int i=0; i<doubling_rounds(num_ranks); ++i) {
+        auto n = std::min<std::size_t>(ranks_held, num_ranks-ranks_held);
+        doubling += message(n*bytes);
+        ranks_held += n;
+    }
+
+    double ring = (num_ranks-1)*message(bytes);
+
+    return std::min(doubling, ring);
+}
+
+double loggp_model::allreduce(int num_ranks, std::size_t bytes) const {
+    if (num_ranks<2) return 0;
+    return doubling_rounds(num_ranks)*message(bytes);
+}
+
+} // namespace communication
+} // namespace arb
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace arb {
+namespace communication {
+
+// A model of the time taken by the collective operations of the spike
+// exchange on a network, with which dry runs predict the communication time
+// of runs on many ranks.
+class network_model {
+public:
+    // The time [s] for num_ranks ranks to gather bytes bytes from each rank
+    // onto every rank.
+    virtual double allgather(int num_ranks, std::size_t bytes) const = 0;
+
+    // The time [s] for num_ranks ranks to reduce a value of bytes bytes, with
+    // the result on every rank.
+    virtual double allreduce(int num_ranks, std::size_t bytes) const = 0;
+
+    virtual ~network_model() = default;
+};
+
+using network_model_ptr = std::shared_ptr<const network_model>;
+
+// The parameters of the LogGP model of a network. The default values are
+// representative of a modern HPC interconnect.
+struct loggp_parameters {
+    double L;   // latency of a message [s]
+    double o;   // overhead of sending or receiving a message [s]
+    double g;   // gap between consecutive messages from a rank [s]
+    double G;   // gap per byte of a long message [s/B]
+
+    loggp_parameters(double L=1e-6, double o=3e-7, double g=5e-7, double G=1e-10):
+        L(L), o(o), g(g), G(G)
+    {}
+};
+
+// The LogGP model: sending a message of k bytes takes L + 2o + (k-1)G, and
+// a rank can send at most one message per g.
+//
+// Collectives are modelled as the rounds of the algorithms that MPI
+// implementations use, in which each rank sends one message per round:
+//  * allgather: the faster of recursive doubling, in ceil(log2 p) rounds of
+//    doubling size, and the ring, in p-1 rounds of one rank's data;
+//  * allreduce: recursive doubling, in ceil(log2 p) rounds.
+class loggp_model: public network_model {
+public:
+    loggp_model(loggp_parameters p = loggp_parameters{}): p_(p) {}
+
+    const loggp_parameters& parameters() const { return p_; }
+
+    // The time of one round, in which each rank sends a message of bytes
+    // bytes.
+    double message(std::size_t bytes) const;
+
+    double allgather(int num_ranks, std::size_t bytes) const override;
+    double allreduce(int num_ranks, std::size_t bytes) const override;
+
+private:
+    loggp_parameters p_;
+};
+
+} // namespace communication
+} // namespace arb
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include <communication/gathered_vector.hpp>
+#include <communication/spike_codec.hpp>
 #include <spike.hpp>
 
 namespace arb {
@@ -15,11 +16,26 @@ struct serial_global_policy {
     template <typename Spike>
     static gathered_vector<Spike>
     gather_spikes(const std::vector<Spike>& local_spikes) {
+        gathered_vector<Spike> global_spikes;
+        gather_spikes(local_spikes, global_spikes);
+        return global_spikes;
+    }
+
+    template <typename Spike>
+    static void
+    gather_spikes(const std::vector<Spike>& local_spikes, gathered_vector<Spike>& global_spikes) {
         using count_type = typename gathered_vector<Spike>::count_type;
-        return gathered_vector<Spike>(
-            std::vector<Spike>(local_spikes),
-            {0u, static_cast<count_type>(local_spikes.size())}
-        );
+        global_spikes.values().assign(local_spikes.begin(), local_spikes.end());
+        global_spikes.partition().assign({0u, static_cast<count_type>(local_spikes.size())});
+    }
+
+    // Gather spikes through the compressed wire format of spike_codec.hpp,
+    // with times quantized by quantum.
+    static void gather_compressed_spikes(const std::vector<spike>& local_spikes,
+                                         gathered_vector<spike>& global_spikes,
+                                         time_type quantum)
+    {
+        gather_spikes(quantize_spikes(local_spikes, quantum), global_spikes);
     }
 
     static int id() {
@@ -0,0 +1,311 @@
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <communication/shmem.hpp>
+
+namespace arb {
+namespace shmem {
+
+namespace {
+
+using word = std::atomic<std::uint32_t>;
+static_assert(sizeof(word)==sizeof(std::uint32_t) && ATOMIC_INT_LOCK_FREE==2,
+    "futexes require lock-free 32 bit atomics");
+
+// The state of the barrier, at the start of the shared segment. A segment
+// filled with zeros, as created by ftruncate, is a barrier that no process
+// has reached.
+struct control_block {
+    word arrived;       // the number of processes at the barrier
+    word generation;    // incremented when all processes have arrived
+};
+
+constexpr std::size_t alignment = 64;
+
+std::size_t round_up(std::size_t n) {
+    return (n+alignment-1)/alignment*alignment;
+}
+
+} // namespace
+
+// global state
+namespace state {
+    int size = 1;
+    int rank = 0;
+
+    char* segment = nullptr;
+    std::size_t segment_size = 0;
+
+    control_block* control = nullptr;
+    std::uint64_t* counts = nullptr;    // two arrays of one count per rank
+    char* buffers = nullptr;            // two buffers of capacity bytes
+    std::size_t capacity = 0;
+
+    // The number of gathers so far, of which the parity selects the buffer.
+    std::uint64_t round = 0;
+
+    // The processes forked by rank 0.
+    std::vector<pid_t> children;
+} // namespace state
+
+namespace {
+
+// Read a non-negative integer from an environment variable.
+// Throws std::runtime_error if the variable is set to an invalid value.
+std::size_t env_size(const char* name, std::size_t default_value) {
+    const char* str = std::getenv(name);
+    if (!str) {
+        return default_value;
+    }
+
+    errno = 0;
+    auto value = std::strtoull(str, nullptr, 10);
+    if (errno==ERANGE || !std::regex_match(str, std::regex("\\s*\\d+\\s*"))) {
+        throw std::runtime_error(std::string(name)+"=\""+str+"\" is not a valid value");
+    }
+    return value;
+}
+
+void system_error(const std::string& what) {
+    throw std::runtime_error("shmem: "+what+": "+std::strerror(errno));
+}
+
+long futex(word* addr, int op, std::uint32_t value, const timespec* timeout=nullptr) {
+    return syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(addr), op, value, timeout, nullptr, 0);
+}
+
+// Called by a process that has waited long at a barrier: rank 0 aborts,
+// killing the processes that it forked, if one of them has exited without
+// arriving at the barrier.
+void check_children(std::uint32_t generation) {
+    if (state::children.empty()) return;
+
+    siginfo_t info;
+    info.si_pid = 0;
+    if (waitid(P_ALL, 0, &info, WEXITED|WNOHANG|WNOWAIT)==0 && info.si_pid!=0) {
+        // A process may exit once it has passed the last barrier.
+        if (state::control->generation.load(std::memory_order_acquire)==generation) {
+            std::cerr << "shmem: process " << info.si_pid
+                      << " exited during a collective operation\n";
+            std::abort();
+        }
+    }
+}
+
+// Map the shared segment of the processes from the shared memory object fd.
+void map_segment(int fd, std::size_t capacity) {
+    const auto n = state::size;
+    auto counts_offset = round_up(sizeof(control_block));
+    auto buffers_offset = counts_offset + round_up(2*n*sizeof(std::uint64_t));
+    auto size = buffers_offset + 2*capacity;
+
+    if (ftruncate(fd, size)) {
+        system_error("unable to size shared memory");
+    }
+    void* p = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p==MAP_FAILED) {
+        system_error("unable to map shared memory");
+    }
+    close(fd);
+
+    state::segment = static_cast<char*>(p);
+    state::segment_size = size;
+    state::control = reinterpret_cast<control_block*>(state::segment);
+    state::counts = reinterpret_cast<std::uint64_t*>(state::segment+counts_offset);
+    state::buffers = state::segment+buffers_offset;
+    state::capacity = capacity;
+}
+
+} // namespace
+
+void init() {
+    const auto n = env_size("ARB_SHMEM_SIZE", 1);
+    const auto capacity = round_up(env_size("ARB_SHMEM_BUFFER_SIZE", std::size_t(64)<<20));
+    if (n<1 || n>INT_MAX) {
+        throw std::runtime_error("ARB_SHMEM_SIZE must be a positive number of processes");
+    }
+    if (n==1) {
+        return;
+    }
+    state::size = n;
+
+    const char* name = std::getenv("ARB_SHMEM_NAME");
+    const bool launched = std::getenv("ARB_SHMEM_RANK")!=nullptr;
+
+    if (launched) {
+        if (!name) {
+            throw std::runtime_error("ARB_SHMEM_NAME must be set with ARB_SHMEM_RANK");
+        }
+        auto rank = env_size("ARB_SHMEM_RANK", 0);
+        if (rank>=n) {
+            throw std::runtime_error("ARB_SHMEM_RANK must be less than ARB_SHMEM_SIZE");
+        }
+        state::rank = rank;
+
+        int fd = shm_open(name, O_CREAT|O_RDWR, 0600);
+        if (fd<0) {
+            system_error(std::string("unable to open ")+name);
+        }
+        map_segment(fd, capacity);
+    }
+    else {
+        // The object is removed as soon as it is open: the mapping outlives
+        // it, and is inherited by the forked processes.
+        auto private_name = "/arbor-shmem-"+std::to_string(getpid());
+        int fd = shm_open(private_name.c_str(), O_CREAT|O_EXCL|O_RDWR, 0600);
+        if (fd<0) {
+            system_error("unable to create "+private_name);
+        }
+        shm_unlink(private_name.c_str());
+        map_segment(fd, capacity);
+
+        // Flush buffered output, so that it is not written by each process.
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+
+        const auto parent = getpid();
+        for (int r=1; r<state::size; ++r) {
+            pid_t pid = fork();
+            if (pid<0) {
+                system_error("unable to fork");
+            }
+            if (pid==0) {
+                state::rank = r;
+                state::children.clear();
+                prctl(PR_SET_PDEATHSIG, SIGKILL);
+                if (getppid()!=parent) {
+                    std::_Exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            state::children.push_back(pid);
+        }
+    }
+
+    barrier();
+
+    // Once all processes have opened the object, it can be removed.
+    if (launched && state::rank==0) {
+        shm_unlink(name);
+    }
+}
+
+void finalize() {
+    if (!state::segment) return;
+
+    // Wait until all processes have finished with the segment.
+    barrier();
+    munmap(state::segment, state::segment_size);
+    state::segment = nullptr;
+
+    for (auto pid: state::children) {
+        waitpid(pid, nullptr, 0);
+    }
+    state::children.clear();
+}
+
+bool is_root() {
+    return state::rank == 0;
+}
+
+int rank() {
+    return state::rank;
+}
+
+int size() {
+    return state::size;
+}
+
+void barrier() {
+    if (!state::segment) return;
+
+    auto& c = *state::control;
+    const auto generation = c.generation.load(std::memory_order_acquire);
+
+    // The last process to arrive resets the count for the next barrier, and
+    // releases the others.
+    if (c.arrived.fetch_add(1, std::memory_order_acq_rel)+1==std::uint32_t(state::size)) {
+        c.arrived.store(0, std::memory_order_relaxed);
+        c.generation.fetch_add(1, std::memory_order_release);
+        futex(&c.generation, FUTEX_WAKE, INT_MAX);
+        return;
+    }
+
+    // Spin for a short while before sleeping on the futex.
+    for (int i=0; i<4096; ++i) {
+        if (c.generation.load(std::memory_order_acquire)!=generation) {
+            return;
+        }
+    }
+
+    const timespec timeout = {0, 100000000};
+    while (c.generation.load(std::memory_order_acquire)==generation) {
+        if (futex(&c.generation, FUTEX_WAIT, generation, &timeout) && errno==ETIMEDOUT) {
+            check_children(generation);
+        }
+    }
+}
+
+// Each gather uses one of two buffers, and the arrays of counts, in turn.
+// A process can only write to a buffer once all processes have passed the
+// second barrier of the previous gather, which they only reach once they
+// have finished with the values of the gather before it, in the same buffer.
+const char* gather_all(const void* data, std::size_t nbytes, std::vector<std::size_t>& counts) {
+    if (!state::segment) {
+        counts.assign(1, nbytes);
+        return static_cast<const char*>(data);
+    }
+
+    const auto n = state::size;
+    const auto parity = state::round++%2;
+    auto shared_counts = state::counts + parity*n;
+
+    shared_counts[state::rank] = nbytes;
+    barrier();
+
+    counts.assign(shared_counts, shared_counts+n);
+    std::size_t offset = 0, total = 0;
+    for (int i=0; i<n; ++i) {
+        if (i==state::rank) offset = total;
+        total += counts[i];
+    }
+    if (total>state::capacity) {
+        throw std::runtime_error(
+            "shmem: gather of "+std::to_string(total)+" bytes exceeds ARB_SHMEM_BUFFER_SIZE="
+            +std::to_string(state::capacity));
+    }
+
+    char* buffer = state::buffers + parity*state::capacity;
+    if (nbytes) {
+        std::memcpy(buffer+offset, data, nbytes);
+    }
+    barrier();
+
+    return buffer;
+}
+
+} // namespace shmem
+} // namespace arb
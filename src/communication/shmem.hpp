@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <communication/gathered_vector.hpp>
+#include <profiling/profiler.hpp>
+
+// Communication between the processes of one host through POSIX shared
+// memory, for multi-process runs on a single node without MPI.
+//
+// The processes map one shared segment, which holds the state of a barrier
+// and two buffers into which the processes gather their values in turn.
+// Every collective is a gather to all processes: the processes write their
+// values into the current buffer, wait at the barrier, and read the values
+// of all processes from the buffer.
+//
+// The processes are started in one of two ways, configured by environment
+// variables:
+//
+//   * Forked by init: with ARB_SHMEM_SIZE=n, the process that calls init
+//     becomes rank 0, and forks n-1 copies of itself, ranks 1 to n-1, which
+//     return from init to continue from the same point. init must then be
+//     called before the process starts other threads, as the forked
+//     processes have only the thread that called fork.
+//
+//   * Launched: with ARB_SHMEM_SIZE=n, ARB_SHMEM_RANK=r and ARB_SHMEM_NAME
+//     set to the name of a shared memory object, e.g. "/arbor-run", the n
+//     processes launched with ranks 0 to n-1 open the same object. The object
+//     must not exist when the processes are launched; rank 0 removes it once
+//     all processes have opened it.
+//
+// Each of the two buffers holds ARB_SHMEM_BUFFER_SIZE bytes, 64 MiB by
+// default: a gather of more bytes throws std::runtime_error on all ranks.
+//
+// As with MPI, if a process fails, the others wait for it indefinitely;
+// processes forked by init are killed if rank 0 dies, and rank 0 aborts if a
+// forked process dies.
+
+namespace arb {
+namespace shmem {
+
+    // prototypes
+    void init();
+    void finalize();
+    bool is_root();
+    int rank();
+    int size();
+    void barrier();
+
+    // Gather nbytes bytes from each rank, in rank order. Returns a pointer to
+    // the gathered bytes in shared memory, which is valid until the next
+    // collective, and sets counts to the number of bytes from each rank.
+    const char* gather_all(const void* data, std::size_t nbytes, std::vector<std::size_t>& counts);
+
+    // Gather individual values of type T from each rank into a std::vector on
+    // the every rank.
+    // T must be trivially copyable
+    template <typename T>
+    std::vector<T> gather_all(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "gather_all can only gather trivially copyable types");
+
+        thread_local static std::vector<std::size_t> counts;
+        std::vector<T> buffer(size());
+
+        PE("shmem", "Allgather");
+        auto bytes = gather_all(&value, sizeof(T), counts);
+        std::memcpy(buffer.data(), bytes, size()*sizeof(T));
+        PL(2);
+
+        return buffer;
+    }
+
+    // Gather individual values of type T from each rank into a std::vector on
+    // the root rank.
+    // T must be trivially copyable
+    template <typename T>
+    std::vector<T> gather(T value, int root) {
+        auto buffer = gather_all(value);
+        if (rank()!=root) {
+            buffer.clear();
+        }
+        return buffer;
+    }
+
+    // Specialize gather for std::string.
+    inline std::vector<std::string> gather(std::string str, int root) {
+        thread_local static std::vector<std::size_t> counts;
+
+        PE("shmem", "Gather");
+        auto bytes = gather_all(str.data(), str.size(), counts);
+
+        // Unpack the raw string data into a vector of strings.
+        std::vector<std::string> result;
+        if (rank()==root) {
+            result.reserve(size());
+            for (auto c: counts) {
+                result.push_back(std::string(bytes, c));
+                bytes += c;
+            }
+        }
+        PL(2);
+
+        return result;
+    }
+
+    /// Gather all of a distributed vector into the storage of an existing
+    /// gathered vector, retaining the partition.
+    /// T must be trivially copyable
+    template <typename T>
+    void gather_all_with_partition(const std::vector<T>& values, gathered_vector<T>& gathered) {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "gather_all_with_partition can only gather trivially copyable types");
+
+        thread_local static std::vector<std::size_t> counts;
+
+        PE("shmem", "Allgatherv");
+        auto bytes = gather_all(values.data(), values.size()*sizeof(T), counts);
+
+        auto& partition = gathered.partition();
+        partition.resize(counts.size()+1);
+        partition[0] = 0;
+        for (auto i=0u; i<counts.size(); ++i) {
+            partition[i+1] = partition[i]+counts[i]/sizeof(T);
+        }
+
+        auto& buffer = gathered.values();
+        buffer.resize(partition.back());
+        if (!buffer.empty()) {
+            std::memcpy(buffer.data(), bytes, buffer.size()*sizeof(T));
+        }
+        PL(2);
+    }
+
+    template <typename T>
+    gathered_vector<T> gather_all_with_partition(const std::vector<T>& values) {
+        gathered_vector<T> gathered;
+        gather_all_with_partition(values, gathered);
+        return gathered;
+    }
+
+    // Reduce the values of all ranks with the binary operation op, on every
+    // rank. The values are combined in rank order, so that all ranks get
+    // the same result.
+    template <typename T, typename Op>
+    T reduce(T value, Op op) {
+        auto values = gather_all(value);
+        T result = values[0];
+        for (auto i=1u; i<values.size(); ++i) {
+            result = op(result, values[i]);
+        }
+        return result;
+    }
+
+} // namespace shmem
+} // namespace arb
@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef ARB_HAVE_SHMEM
+#error "shmem_global_policy.hpp should only be compiled in a ARB_HAVE_SHMEM build"
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <common_types.hpp>
+#include <communication/gathered_vector.hpp>
+#include <communication/shmem.hpp>
+#include <communication/spike_codec.hpp>
+#include <spike.hpp>
+
+namespace arb {
+namespace communication {
+
+// Communication between processes on one host through shared memory: see
+// shmem.hpp for how the processes are started.
+struct shmem_global_policy {
+    template <typename Spike>
+    static gathered_vector<Spike>
+    gather_spikes(const std::vector<Spike>& local_spikes) {
+        return shmem::gather_all_with_partition(local_spikes);
+    }
+
+    template <typename Spike>
+    static void
+    gather_spikes(const std::vector<Spike>& local_spikes, gathered_vector<Spike>& global_spikes) {
+        shmem::gather_all_with_partition(local_spikes, global_spikes);
+    }
+
+    // The spikes are not encoded, as they are not sent over a network: the
+    // times are quantized as they would be by the compressed wire format.
+    static void gather_compressed_spikes(const std::vector<spike>& local_spikes,
+                                         gathered_vector<spike>& global_spikes,
+                                         time_type quantum)
+    {
+        gather_spikes(quantize_spikes(local_spikes, quantum), global_spikes);
+    }
+
+    static int id() { return shmem::rank(); }
+
+    static int size() { return shmem::size(); }
+
+    static void set_sizes(int comm_size, int num_local_cells) {
+        throw std::runtime_error(
+            "Attempt to set comm size for shared memory global communication "
+            "policy, this is only permitted for dry run mode");
+    }
+
+    template <typename T>
+    static T min(T value) {
+        return shmem::reduce(value, [](const T& a, const T& b) { return std::min(a, b); });
+    }
+
+    template <typename T>
+    static T max(T value) {
+        return shmem::reduce(value, [](const T& a, const T& b) { return std::max(a, b); });
+    }
+
+    template <typename T>
+    static T sum(T value) {
+        return shmem::reduce(value, [](const T& a, const T& b) { return a+b; });
+    }
+
+    template <typename T>
+    static std::vector<T> gather(T value, int root) {
+        return shmem::gather(value, root);
+    }
+
+    static void barrier() {
+        shmem::barrier();
+    }
+
+    static void setup(int& argc, char**& argv) {
+        shmem::init();
+    }
+
+    static void teardown() {
+        shmem::finalize();
+    }
+
+    static global_policy_kind kind() { return global_policy_kind::shmem; };
+};
+
+using global_policy = shmem_global_policy;
+
+} // namespace communication
+} // namespace arb
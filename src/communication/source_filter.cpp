@@ -0,0 +1,42 @@
+#include <cstdint>
+#include <vector>
+
+#include <common_types.hpp>
+#include <communication/source_filter.hpp>
+#include <util/counter_rng.hpp>
+
+namespace arb {
+namespace communication {
+
+source_filter::source_filter(const std::vector<cell_gid_type>& gids) {
+    if (gids.empty()) {
+        return;
+    }
+
+    // Use a bitset if it is no larger than the Bloom filter would be.
+    first_ = gids.front();
+    range_ = std::uint64_t(gids.back())-first_+1;
+    if (range_<=std::uint64_t(bits_per_gid)*gids.size()) {
+        bits_.assign((range_+63)/64, 0);
+        for (auto gid: gids) {
+            auto i = gid-first_;
+            bits_[i/64] |= std::uint64_t(1)<<(i%64);
+        }
+        return;
+    }
+
+    bloom_ = true;
+    num_blocks_ = (gids.size()*bits_per_gid+block_bits-1)/block_bits;
+    bits_.assign(num_blocks_*block_words, 0);
+    for (auto gid: gids) {
+        const auto h = util::mix64(gid);
+        auto words = const_cast<std::uint64_t*>(block(h));
+        for (unsigned i=0; i<num_probes; ++i) {
+            const auto bit = probe(h, i);
+            words[bit/64] |= std::uint64_t(1)<<(bit%64);
+        }
+    }
+}
+
+} // namespace communication
+} // namespace arb
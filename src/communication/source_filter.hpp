@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <common_types.hpp>
+#include <util/counter_rng.hpp>
+
+namespace arb {
+namespace communication {
+
+// A compact set of the source gids of the connections onto a domain, with
+// which spikes from sources that have no targets on the domain are rejected
+// with one probe into memory, before they are looked up in the connections.
+//
+// The set is a bitset over the range of the gids if the gids are dense
+// enough, which answers exactly; otherwise a blocked Bloom filter, in which
+// the bits of a gid are all in one cache line, which has no false negatives,
+// and false positives for about one in five hundred gids not in the set.
+class source_filter {
+public:
+    source_filter() = default;
+
+    // The set of the sorted, unique gids.
+    explicit source_filter(const std::vector<cell_gid_type>& gids);
+
+    bool may_contain(cell_gid_type gid) const {
+        if (bloom_) {
+            const auto h = util::mix64(gid);
+            const auto words = block(h);
+            for (unsigned i=0; i<num_probes; ++i) {
+                const auto bit = probe(h, i);
+                if (!(words[bit/64]>>(bit%64)&1)) return false;
+            }
+            return true;
+        }
+        const auto i = std::uint64_t(gid)-first_;
+        return i<range_ && (bits_[i/64]>>(i%64)&1);
+    }
+
+    bool is_bloom() const { return bloom_; }
+
+    // The number of bytes of the set.
+    std::size_t memory() const { return bits_.size()*sizeof(std::uint64_t); }
+
+    // Bloom filter parameters: 512 bit blocks, of one cache line, with
+    // 16 bits per gid and 5 probes per gid.
+    static constexpr unsigned block_bits = 512;
+    static constexpr unsigned block_words = block_bits/64;
+    static constexpr unsigned bits_per_gid = 16;
+    static constexpr unsigned num_probes = 5;
+
+private:
+    bool bloom_ = false;
+    std::uint64_t first_ = 0;       // bitset: the first gid of the range
+    std::uint64_t range_ = 0;       // bitset: the number of gids in the range
+    std::uint64_t num_blocks_ = 0;  // bloom filter: the number of blocks
+    std::vector<std::uint64_t> bits_;
+
+    // The block of the hash h of a gid is chosen by its high 32 bits, and
+    // the bits in the block by consecutive 9 bit fields of its low bits.
+    const std::uint64_t* block(std::uint64_t h) const {
+        return bits_.data()+((h>>32)*num_blocks_>>32)*block_words;
+    }
+
+    static unsigned probe(std::uint64_t h, unsigned i) {
+        return (h>>(9*i))&(block_bits-1);
+    }
+};
+
+// Counts of the spikes tested against a source_filter.
+struct source_filter_stats {
+    std::uint64_t hits = 0;     // spikes that may have targets
+    std::uint64_t misses = 0;   // spikes rejected by the filter
+};
+
+} // namespace communication
+} // namespace arb
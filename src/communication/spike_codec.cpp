@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <common_types.hpp>
+#include <communication/spike_codec.hpp>
+#include <spike.hpp>
+
+namespace arb {
+namespace communication {
+
+namespace {
+
+// The encoding of the time of each spike: quantized with 16 or 32 bits, or
+// exactly as a time_type.
+enum : unsigned char {
+    time_exact = 0,
+    time_quantized_16 = 1,
+    time_quantized_32 = 2
+};
+
+void put_varint(std::uint64_t x, std::vector<char>& out) {
+    while (x>=0x80) {
+        out.push_back(char(x|0x80));
+        x >>= 7;
+    }
+    out.push_back(char(x));
+}
+
+// Map signed deltas onto unsigned integers, with small magnitudes first.
+std::uint64_t zigzag(std::int64_t x) {
+    return (std::uint64_t(x)<<1) ^ std::uint64_t(x>>63);
+}
+
+std::int64_t unzigzag(std::uint64_t x) {
+    return std::int64_t(x>>1) ^ -std::int64_t(x&1);
+}
+
+template <typename T>
+void put_bytes(T x, std::vector<char>& out) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &x, sizeof(T));
+    out.insert(out.end(), bytes, bytes+sizeof(T));
+}
+
+struct reader {
+    const char* pos;
+    const char* end;
+
+    void check(std::size_t n) const {
+        if (std::size_t(end-pos)<n) {
+            throw std::runtime_error("truncated spike buffer");
+        }
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t x = 0;
+        for (unsigned shift = 0; ; shift += 7) {
+            check(1);
+            auto byte = static_cast<unsigned char>(*pos++);
+            x |= std::uint64_t(byte&0x7f)<<shift;
+            if (!(byte&0x80)) return x;
+        }
+    }
+
+    template <typename T>
+    T bytes() {
+        check(sizeof(T));
+        T x;
+        std::memcpy(&x, pos, sizeof(T));
+        pos += sizeof(T);
+        return x;
+    }
+};
+
+} // namespace
+
+void encode_spikes(const std::vector<spike>& spikes, time_type quantum, std::vector<char>& buffer) {
+    buffer.clear();
+    put_varint(spikes.size(), buffer);
+    if (spikes.empty()) return;
+
+    // Choose the width of the times from the latest spike.
+    time_type t0 = spikes.front().time;
+    time_type t1 = t0;
+    for (const auto& s: spikes) {
+        t0 = std::min(t0, s.time);
+        t1 = std::max(t1, s.time);
+    }
+
+    // 32 bit quantized times are only used if they are smaller than exact
+    // times.
+    unsigned char encoding = time_exact;
+    if (quantum>0) {
+        auto max_ticks = std::round((t1-t0)/quantum);
+        encoding = max_ticks<=0xffff? time_quantized_16:
+                   max_ticks<=0xffffffff && sizeof(time_type)>4? time_quantized_32:
+                   time_exact;
+    }
+
+    buffer.push_back(char(encoding));
+    if (encoding!=time_exact) {
+        put_bytes(t0, buffer);
+        put_bytes(quantum, buffer);
+    }
+
+    std::int64_t gid = 0;
+    for (const auto& s: spikes) {
+        put_varint(zigzag(std::int64_t(s.source.gid)-gid), buffer);
+        put_varint(s.source.index, buffer);
+        gid = s.source.gid;
+
+        switch (encoding) {
+        case time_quantized_16:
+            put_bytes(std::uint16_t(std::round((s.time-t0)/quantum)), buffer);
+            break;
+        case time_quantized_32:
+            put_bytes(std::uint32_t(std::round((s.time-t0)/quantum)), buffer);
+            break;
+        default:
+            put_bytes(s.time, buffer);
+        }
+    }
+}
+
+void decode_spikes(const char* first, const char* last, std::vector<spike>& spikes) {
+    reader in{first, last};
+
+    auto n = in.varint();
+    if (!n) return;
+
+    auto encoding = in.bytes<unsigned char>();
+    time_type t0 = 0, quantum = 0;
+    if (encoding!=time_exact) {
+        t0 = in.bytes<time_type>();
+        quantum = in.bytes<time_type>();
+    }
+
+    spikes.reserve(spikes.size()+n);
+    std::int64_t gid = 0;
+    for (std::uint64_t i = 0; i<n; ++i) {
+        gid += unzigzag(in.varint());
+        auto index = in.varint();
+
+        time_type t;
+        switch (encoding) {
+        case time_quantized_16:
+            t = t0+in.bytes<std::uint16_t>()*quantum;
+            break;
+        case time_quantized_32:
+            t = t0+in.bytes<std::uint32_t>()*quantum;
+            break;
+        case time_exact:
+            t = in.bytes<time_type>();
+            break;
+        default:
+            throw std::runtime_error("invalid spike buffer");
+        }
+
+        spikes.push_back(spike({cell_gid_type(gid), cell_lid_type(index)}, t));
+    }
+}
+
+std::vector<spike> quantize_spikes(const std::vector<spike>& spikes, time_type quantum) {
+    std::vector<char> buffer;
+    encode_spikes(spikes, quantum, buffer);
+
+    std::vector<spike> decoded;
+    decode_spikes(buffer.data(), buffer.data()+buffer.size(), decoded);
+    return decoded;
+}
+
+} // namespace communication
+} // namespace arb
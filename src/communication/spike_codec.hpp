@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include <common_types.hpp>
+#include <spike.hpp>
+
+namespace arb {
+namespace communication {
+
+// A compact wire format for the spikes that a domain contributes to the
+// global spike exchange, used instead of sending spikes verbatim.
+//
+// Source gids are delta encoded in order, and gids, deltas and source indexes
+// are written as variable length integers. Times are relative to the earliest
+// spike of the buffer, as integer multiples of a quantum written with 16 or 32
+// bits, whichever is enough for the latest spike, or exactly if neither is or
+// if time_type is no wider than 32 bits. Decoded times are within quantum/2 of
+// the original times, up to the rounding of time_type, and are no earlier than
+// the earliest spike. With a quantum of zero, times are written exactly, so
+// that decoding gives the original spikes.
+//
+// Buffers are self-describing: the quantum is written with the spikes.
+
+// Encode spikes into buffer, replacing its contents. The encoding is most
+// compact for spikes sorted by source.
+void encode_spikes(const std::vector<spike>& spikes, time_type quantum, std::vector<char>& buffer);
+
+// Decode the spikes of the buffer [first, last), appending them to spikes.
+// Throws std::runtime_error if the buffer is truncated.
+void decode_spikes(const char* first, const char* last, std::vector<spike>& spikes);
+
+// The spikes as they are received after encoding with quantum: used by the
+// communication policies of a single domain, so that compression gives the
+// same spikes whatever the policy.
+std::vector<spike> quantize_spikes(const std::vector<spike>& spikes, time_type quantum);
+
+} // namespace communication
+} // namespace arb
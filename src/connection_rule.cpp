@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <common_types.hpp>
+#include <connection_rule.hpp>
+#include <recipe.hpp>
+#include <util/counter_rng.hpp>
+
+namespace arb {
+
+constexpr cell_gid_type random_connection_rule::block_size;
+
+random_connection_rule::random_connection_rule(
+        std::uint64_t seed, cell_size_type num_cells, double p,
+        cell_lid_type target, float weight, float delay):
+    seed_(seed), num_cells_(num_cells), p_(p),
+    target_(target), weight_(weight), delay_(delay)
+{}
+
+void random_connection_rule::connections_from(
+    cell_member_type source,
+    cell_gid_type first, cell_gid_type last,
+    std::vector<cell_connection>& conns) const
+{
+    last = std::min<cell_gid_type>(last, num_cells_);
+    if (source.index!=0 || source.gid>=num_cells_ || first>=last || p_<=0) {
+        return;
+    }
+
+    // The targets in each block are found by skipping over the gids of the
+    // block with geometrically distributed gaps: the gap to the next target
+    // is floor(log(u)/log(1-p)) for u uniform on (0, 1].
+    const double scale = p_<1? 1/std::log1p(-p_): 0;
+    const auto key = util::counter_key(seed_, source.gid);
+
+    for (std::uint64_t block = first/block_size; block*block_size<last; ++block) {
+        const auto block_end = std::min<std::uint64_t>((block+1)*block_size, last);
+        const auto stream = util::counter_key(key, block);
+
+        // The first candidate gid for the next target.
+        std::uint64_t next = block*block_size;
+        for (std::uint64_t counter = 0; ; ++counter) {
+            auto u = util::counter_uniform(util::counter_random(stream, counter));
+            auto gap = std::floor(std::log(u)*scale);
+            if (gap>=double(block_size)) break;
+
+            auto gid = next+std::uint64_t(gap);
+            if (gid>=block_end) break;
+            if (gid>=first && gid!=source.gid) {
+                conns.push_back({source, {cell_gid_type(gid), target_}, weight_, delay_});
+            }
+            next = gid+1;
+        }
+    }
+}
+
+} // namespace arb
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <common_types.hpp>
+#include <recipe.hpp>
+
+namespace arb {
+
+// A procedural description of connections: instead of listing the incoming
+// connections of each cell, a rule generates the outgoing connections of a
+// source on demand, so that the communicator regenerates the fan-out of each
+// spike on arrival rather than storing the connections of its cells.
+//
+// Rules must be deterministic: the connections generated from a source onto
+// a range of gids must not depend on the order of calls, the domain or the
+// thread that makes them. Rules are used concurrently by the models that
+// share them.
+class connection_rule {
+public:
+    // Append to conns the connections from source onto the cells with
+    // gids in [first, last), in ascending order of destination gid.
+    virtual void connections_from(cell_member_type source,
+        cell_gid_type first, cell_gid_type last,
+        std::vector<cell_connection>& conns) const = 0;
+
+    // A lower bound on the delays of the connections.
+    virtual time_type min_delay() const = 0;
+
+    virtual ~connection_rule() = default;
+};
+
+// A random network over the cells with gids in [0, num_cells): each cell is
+// the target of a connection from the first source (index 0) of each other
+// cell with probability p, independently. The connections onto a target
+// have the same target index, weight and delay.
+//
+// The network is generated from a counter-based random number generator,
+// keyed by the seed, the source gid and the block of gids of the target, so
+// the connections from a source onto a range of gids are generated in time
+// proportional to their number and the number of blocks that the range
+// overlaps.
+class random_connection_rule: public connection_rule {
+public:
+    random_connection_rule(std::uint64_t seed, cell_size_type num_cells, double p,
+                           cell_lid_type target, float weight, float delay);
+
+    void connections_from(cell_member_type source,
+        cell_gid_type first, cell_gid_type last,
+        std::vector<cell_connection>& conns) const override;
+
+    time_type min_delay() const override { return delay_; }
+
+    // The number of gids in a block.
+    static constexpr cell_gid_type block_size = 1024;
+
+private:
+    std::uint64_t seed_;
+    cell_size_type num_cells_;
+    double p_;
+    cell_lid_type target_;
+    float weight_;
+    float delay_;
+};
+
+} // namespace arb
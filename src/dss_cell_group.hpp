@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 #include <cell_group.hpp>
 #include <dss_cell_description.hpp>
 #include <recipe.hpp>
@@ -42,6 +47,10 @@ public:
         clear_spikes();
     }
 
+    bool initialize_steady_state(double, unsigned, time_type, time_type) override {
+        return true;
+    }
+
     void set_binning_policy(binning_kind policy, time_type bin_interval) override {}
 
     void advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) override {
@@ -70,6 +79,41 @@ public:
         spikes_.clear();
     }
 
+    // The state of each cell is the index of its next spike time.
+    void checkpoint(checkpoint_writer& w) const override {
+        std::vector<std::uint64_t> next(gids_.size());
+        for (auto i: util::make_span(0, gids_.size())) {
+            next[i] = not_emit_it_[i]-spike_times_[i].begin();
+        }
+        w.write_sequence(next);
+    }
+
+    void restore(checkpoint_reader& r) override {
+        clear_spikes();
+        std::vector<std::uint64_t> next(gids_.size());
+        r.read_sequence(next.data(), next.size());
+        for (auto i: util::make_span(0, gids_.size())) {
+            if (next[i]>spike_times_[i].size()) {
+                throw checkpoint_error("spike time index out of range");
+            }
+            not_emit_it_[i] = spike_times_[i].begin()+next[i];
+        }
+    }
+
+    void set_mechanism_parameter(cell_gid_type, segment_location,
+        const std::string& mech, const std::string&, double) override
+    {
+        throw std::invalid_argument("dss_cell has no mechanism "+mech);
+    }
+
+    void set_synapse_parameter(cell_member_type, const std::string&, double) override {
+        throw std::invalid_argument("dss_cell has no synapses");
+    }
+
+    void set_mechanism_global(const std::string& mech, const std::string&, double) override {
+        throw std::invalid_argument("dss_cell has no mechanism "+mech);
+    }
+
     void add_sampler(sampler_association_handle h, cell_member_predicate probe_ids, schedule sched, sampler_function fn, sampling_policy policy) override {
         std::logic_error("The dss_cells do not support sampling of internal state!");
     }
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <unordered_map>
 
+#include <checkpoint.hpp>
 #include <common_types.hpp>
 #include <event_binner.hpp>
 #include <spike.hpp>
@@ -15,6 +16,22 @@ void event_binner::reset() {
     last_event_time_ = util::nothing;
 }
 
+void event_binner::checkpoint(checkpoint_writer& w) const {
+    w.write<bool>(bool(last_event_time_));
+    w.write<time_type>(last_event_time_? *last_event_time_: 0);
+}
+
+void event_binner::restore(checkpoint_reader& r) {
+    bool has_last = r.read<bool>();
+    time_type t = r.read<time_type>();
+    if (has_last) {
+        last_event_time_ = t;
+    }
+    else {
+        last_event_time_ = util::nothing;
+    }
+}
+
 time_type event_binner::bin(time_type t, time_type t_min) {
     time_type t_binned = t;
 
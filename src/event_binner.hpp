@@ -3,6 +3,7 @@
 #include <limits>
 #include <unordered_map>
 
+#include <checkpoint.hpp>
 #include <common_types.hpp>
 #include <spike.hpp>
 #include <util/optional.hpp>
@@ -25,6 +26,10 @@ public:
 
     void reset();
 
+    // Save and restore the time of the last binned event.
+    void checkpoint(checkpoint_writer& w) const;
+    void restore(checkpoint_reader& r);
+
     // Determine binned time for an event based on policy.
     // If `t_min` is specified, the binned time will be no lower than `t_min`.
     // Otherwise the returned binned time will be less than or equal to the parameter `t`,
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <memory>
 #include <random>
 
+#include <checkpoint.hpp>
 #include <common_types.hpp>
 #include <event_queue.hpp>
 #include <util/range.hpp>
@@ -32,6 +35,36 @@ struct event_generator {
     // the first event with delivery time >= t.
     virtual void advance(time_type t) = 0;
 
+    // Append all events with delivery time in [t0, t1) to out, in ascending
+    // order, leaving the generator in a state where next() returns the first
+    // event with delivery time >= t1.
+    // Intervals are expected to be requested in ascending order: events that
+    // have already been drawn from the generator are not generated again.
+    //
+    // The default implementation draws the events one at a time; generators
+    // override it to fill the buffer without per-event virtual calls.
+    virtual void events(time_type t0, time_type t1, pse_vector& out) {
+        while (next().time<t0) {
+            pop();
+        }
+        for (auto e = next(); e.time<t1; e = next()) {
+            out.push_back(e);
+            pop();
+        }
+    }
+
+    // Save and restore the position of the generator in its sequence, so
+    // that a generator constructed with the same arguments continues with
+    // the same events. Generators that do not override these can not be
+    // checkpointed.
+    virtual void checkpoint(checkpoint_writer&) const {
+        throw checkpoint_error("event generator does not support checkpoints");
+    }
+
+    virtual void restore(checkpoint_reader&) {
+        throw checkpoint_error("event generator does not support checkpoints");
+    }
+
     virtual ~event_generator() {};
 };
 
@@ -71,6 +104,21 @@ struct vector_backed_generator: public event_generator {
         it_ = std::lower_bound(events_.begin(), events_.end(), t, event_time_less());
     }
 
+    void events(time_type t0, time_type t1, pse_vector& out) override {
+        it_ = std::lower_bound(it_, events_.cend(), t0, event_time_less());
+        auto end = std::lower_bound(it_, events_.cend(), t1, event_time_less());
+        out.insert(out.end(), it_, end);
+        it_ = end;
+    }
+
+    void checkpoint(checkpoint_writer& w) const override {
+        w.write<std::uint64_t>(std::distance(events_.begin(), it_));
+    }
+
+    void restore(checkpoint_reader& r) override {
+        it_ = std::next(events_.begin(), r.read<std::uint64_t>());
+    }
+
 private:
     std::vector<postsynaptic_spike_event> events_;
     std::vector<postsynaptic_spike_event>::const_iterator it_;
@@ -108,6 +156,21 @@ struct seq_generator: public event_generator {
         it_ = std::lower_bound(events_.begin(), events_.end(), t, event_time_less());
     }
 
+    void events(time_type t0, time_type t1, pse_vector& out) override {
+        it_ = std::lower_bound(it_, events_.end(), t0, event_time_less());
+        auto end = std::lower_bound(it_, events_.end(), t1, event_time_less());
+        out.insert(out.end(), it_, end);
+        it_ = end;
+    }
+
+    void checkpoint(checkpoint_writer& w) const override {
+        w.write<std::uint64_t>(std::distance(std::begin(events_), it_));
+    }
+
+    void restore(checkpoint_reader& r) override {
+        it_ = std::next(std::begin(events_), r.read<std::uint64_t>());
+    }
+
 private:
 
     const Seq& events_;
@@ -159,10 +222,29 @@ struct regular_generator: public event_generator {
         }
     }
 
+    void events(time_type t0, time_type t1, pse_vector& out) override {
+        if (time()<t0) {
+            advance(t0);
+        }
+        t1 = std::min(t1, t_stop_);
+        for (auto t = time(); t<t1; t = time()) {
+            out.push_back({target_, t, weight_});
+            ++step_;
+        }
+    }
+
     void reset() override {
         step_ = 0;
     }
 
+    void checkpoint(checkpoint_writer& w) const override {
+        w.write<std::uint64_t>(step_);
+    }
+
+    void restore(checkpoint_reader& r) override {
+        step_ = r.read<std::uint64_t>();
+    }
+
 private:
     time_type time() const {
         return t_start_ + step_*dt_;
@@ -214,12 +296,33 @@ struct poisson_generator: public event_generator {
         }
     }
 
+    void events(time_type t0, time_type t1, pse_vector& out) override {
+        while (next_<t0) {
+            next_ += exp_(rng_);
+        }
+        t1 = std::min(t1, t_stop_);
+        while (next_<t1) {
+            out.push_back({target_, next_, weight_});
+            next_ += exp_(rng_);
+        }
+    }
+
     void reset() override {
         rng_ = reset_state_;
         next_ = t_start_;
         pop();
     }
 
+    void checkpoint(checkpoint_writer& w) const override {
+        w.write_engine(rng_);
+        w.write(next_);
+    }
+
+    void restore(checkpoint_reader& r) override {
+        r.read_engine(rng_);
+        r.read(next_);
+    }
+
 private:
     std::exponential_distribution<time_type> exp_;
     RandomNumberEngine rng_;
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <checkpoint.hpp>
+#include <common_types.hpp>
+#include <event_queue.hpp>
+#include <util/debug.hpp>
+#include <util/range.hpp>
+
+namespace arb {
+
+// Views of the events in a single event lane.
+using event_lane = util::range<postsynaptic_spike_event*>;
+using const_event_lane = util::range<const postsynaptic_spike_event*>;
+
+inline event_lane lane_view(pse_vector& v) {
+    return {v.data(), v.data()+v.size()};
+}
+
+inline const_event_lane lane_view(const pse_vector& v) {
+    return {v.data(), v.data()+v.size()};
+}
+
+// A read only view of the lanes of a contiguous range of local cells in an
+// event_lanes buffer, as passed to cell_group::advance. Lane i holds the
+// events for the ith cell in the range.
+class event_lane_subrange {
+public:
+    event_lane_subrange() = default;
+
+    event_lane_subrange(const postsynaptic_spike_event* events, const std::size_t* divs, std::size_t n):
+        events_(events), divs_(divs), size_(n)
+    {}
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_==0; }
+
+    const_event_lane operator[](std::size_t i) const {
+        EXPECTS(i<size_);
+        return {events_+divs_[i], events_+divs_[i+1]};
+    }
+
+private:
+    const postsynaptic_spike_event* events_ = nullptr;
+    const std::size_t* divs_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// Flat storage for one event lane per local cell, in compressed sparse row
+// form: the events of all lanes are stored in a single contiguous array,
+// partitioned by local cell index.
+//
+// The buffers act as a reusable arena: clearing or rebuilding the lanes
+// retains their capacity, so that once the high water mark has been reached
+// no further allocation takes place from epoch to epoch.
+class event_lanes {
+public:
+    using value_type = postsynaptic_spike_event;
+
+    // An event tagged with the index of the lane to which it belongs.
+    using staged_event = std::pair<cell_size_type, value_type>;
+
+    event_lanes() = default;
+
+    explicit event_lanes(cell_size_type num_lanes) {
+        clear(num_lanes);
+    }
+
+    // The number of lanes.
+    cell_size_type size() const {
+        return divisions_.empty()? 0: divisions_.size()-1;
+    }
+
+    // The total number of events over all lanes.
+    std::size_t num_events() const {
+        return events_.size();
+    }
+
+    event_lane operator[](cell_size_type i) {
+        EXPECTS(i<size());
+        return {events_.data()+divisions_[i], events_.data()+divisions_[i+1]};
+    }
+
+    const_event_lane operator[](cell_size_type i) const {
+        EXPECTS(i<size());
+        return {events_.data()+divisions_[i], events_.data()+divisions_[i+1]};
+    }
+
+    // View of the lanes [r.first, r.second).
+    event_lane_subrange subrange(std::pair<cell_size_type, cell_size_type> r) const {
+        EXPECTS(r.first<=r.second && r.second<=size());
+        return {events_.data(), divisions_.data()+r.first, r.second-r.first};
+    }
+
+    const std::vector<value_type>& events() const { return events_; }
+    const std::vector<std::size_t>& divisions() const { return divisions_; }
+
+    // Remove all events, leaving num_lanes empty lanes.
+    void clear(cell_size_type num_lanes) {
+        events_.clear();
+        divisions_.assign(num_lanes+1, 0);
+    }
+
+    void clear() {
+        clear(size());
+    }
+
+    // Set the size of each lane i to counts[i]. The contents of the lanes are
+    // unspecified until they are written by the caller.
+    template <typename Counts>
+    void resize_lanes(const Counts& counts) {
+        divisions_.resize(1);
+        divisions_[0] = 0;
+        std::size_t n = 0;
+        for (auto c: counts) {
+            n += c;
+            divisions_.push_back(n);
+        }
+        events_.resize(n);
+    }
+
+    // Rebuild num_lanes lanes from a sequence of events tagged by lane index.
+    // Events keep their relative order within each lane.
+    void assign(cell_size_type num_lanes, const std::vector<staged_event>& staged) {
+        divisions_.assign(num_lanes+1, 0);
+        for (const auto& s: staged) {
+            EXPECTS(s.first<num_lanes);
+            ++divisions_[s.first+1];
+        }
+        for (auto i=1u; i<=num_lanes; ++i) {
+            divisions_[i] += divisions_[i-1];
+        }
+
+        events_.resize(staged.size());
+        cursor_.assign(divisions_.begin(), divisions_.end()-1);
+        for (const auto& s: staged) {
+            events_[cursor_[s.first]++] = s.second;
+        }
+    }
+
+    void checkpoint(checkpoint_writer& w) const {
+        w.write_sequence(divisions_);
+        w.write_sequence(events_);
+    }
+
+    // Restore the lanes saved by checkpoint, which must have num_lanes lanes.
+    void restore(checkpoint_reader& r, cell_size_type num_lanes) {
+        r.read_sequence(divisions_);
+        r.read_sequence(events_);
+        if (divisions_.size()!=num_lanes+1 || divisions_.front()!=0 || divisions_.back()!=events_.size()) {
+            throw checkpoint_error("event lanes do not match");
+        }
+    }
+
+    void swap(event_lanes& other) {
+        std::swap(events_, other.events_);
+        std::swap(divisions_, other.divisions_);
+        std::swap(cursor_, other.cursor_);
+    }
+
+private:
+    std::vector<value_type> events_;
+    std::vector<std::size_t> divisions_;
+
+    // Scratch space used by assign().
+    std::vector<std::size_t> cursor_;
+};
+
+} // namespace arb
@@ -44,7 +44,6 @@ struct postsynaptic_spike_event {
 };
 
 using pse_vector = std::vector<postsynaptic_spike_event>;
-using event_lane_subrange = util::subrange_view_type<std::vector<pse_vector>>;
 
 template <typename Event>
 class event_queue {
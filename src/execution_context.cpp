@@ -0,0 +1,34 @@
+#include <cstddef>
+#include <memory>
+
+#include <communication/distributed_context.hpp>
+#include <execution_context.hpp>
+#include <profiling/profiler.hpp>
+#include <threading/threading.hpp>
+#include <util/debug.hpp>
+
+namespace arb {
+
+execution_context make_global_context() {
+    // The process-wide pool and profilers are never destroyed.
+    auto no_delete = [](const void*) {};
+    return {
+        std::shared_ptr<threading::task_pool>(&threading::task_pool::get_global_task_pool(), no_delete),
+        std::shared_ptr<util::profiler_context>(&util::profiler_context::global(), no_delete),
+        communication::global_context()
+    };
+}
+
+execution_context make_local_context(std::size_t num_threads) {
+    EXPECTS(num_threads>0);
+
+    // The worker threads of the pool make the profilers current when they
+    // start, and keep them alive until they end.
+    auto profiler = std::make_shared<util::profiler_context>(num_threads);
+    auto pool = std::make_shared<threading::task_pool>(num_threads,
+        [profiler] { util::profiler_context::set_current(*profiler); });
+
+    return {std::move(pool), std::move(profiler), communication::local_context()};
+}
+
+} // namespace arb
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include <communication/distributed_context.hpp>
+#include <profiling/profiler.hpp>
+#include <threading/threading.hpp>
+
+namespace arb {
+
+// The resources with which a model runs: the pool of threads over which it
+// divides its work, the profilers of the threads of the pool, and the
+// communication between the domains of the model.
+//
+// Models constructed with the same execution context share its resources:
+// they must not be run concurrently. Models that are run concurrently, e.g.
+// from different threads of a parameter sweep, need separate contexts.
+struct execution_context {
+    std::shared_ptr<threading::task_pool> thread_pool;
+    std::shared_ptr<util::profiler_context> profiler;
+    communication::distributed_context distributed;
+};
+
+// The process-wide task pool and profilers, and the global communication
+// policy of the build.
+execution_context make_global_context();
+
+// A task pool with num_threads threads and its own profilers, for a model
+// on a single domain. The thread that runs the model is one of the threads.
+execution_context make_local_context(std::size_t num_threads);
+
+// Make the task pool and profilers of a context current on the calling
+// thread for the lifetime of the execution_scope.
+class execution_scope {
+public:
+    explicit execution_scope(const execution_context& ctx):
+        pool_(*ctx.thread_pool),
+        profiler_(*ctx.profiler)
+    {}
+
+private:
+    threading::pool_scope pool_;
+    util::profiler_scope profiler_;
+};
+
+} // namespace arb
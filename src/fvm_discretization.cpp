@@ -0,0 +1,233 @@
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <algorithms.hpp>
+#include <backends/fvm_types.hpp>
+#include <cell.hpp>
+#include <compartment.hpp>
+#include <fvm_discretization.hpp>
+#include <math.hpp>
+#include <segment.hpp>
+#include <util/span.hpp>
+
+namespace arb {
+namespace fvm {
+
+namespace {
+
+using size_type = fvm_size_type;
+using value_type = fvm_value_type;
+
+// Perform the area, capacitance and face conductance calculation for the
+// CVs of a segment.
+segment_cv_range compute_cv_area_capacitance(
+    std::pair<size_type, size_type> comp_ival,
+    const segment* seg,
+    const std::vector<size_type>& parent,
+    std::vector<value_type>& face_conductance,
+    std::vector<value_type>& tmp_cv_areas,
+    std::vector<value_type>& cv_capacitance)
+{
+    // precondition: group_parent_index[j] holds the correct value for
+    // j in [base_comp, base_comp+segment.num_compartments()].
+
+    auto ncomp = comp_ival.second-comp_ival.first;
+
+    segment_cv_range cv_range;
+
+    auto cm = seg->cm;
+    auto rL = seg->rL;
+
+    if (auto soma = seg->as_soma()) {
+        // confirm assumption that there is one compartment in soma
+        if (ncomp!=1) {
+            throw std::logic_error("soma allocated more than one compartment");
+        }
+        auto i = comp_ival.first;
+        auto area = math::area_sphere(soma->radius());
+
+        tmp_cv_areas[i] += area;
+        cv_capacitance[i] += area*cm;
+
+        cv_range.segment_cvs = {comp_ival.first, comp_ival.first+1};
+        cv_range.areas = {0.0, area};
+        cv_range.parent_cv = segment_cv_range::npos();
+    }
+    else if (auto cable = seg->as_cable()) {
+        // Loop over each compartment in the cable
+        //
+        // Each compartment i straddles the ith control volume on the right
+        // and the jth control volume on the left, where j is the parent index
+        // of i.
+        //
+        // Dividing the comparment into two halves, the centre face C
+        // corresponds to the shared face between the two control volumes,
+        // the surface areas in each half contribute to the surface area of
+        // the respective control volumes, and the volumes and lengths of
+        // each half are used to calculate the flux coefficients that
+        // for the connection between the two control volumes and which
+        // is stored in `face_conductance[i]`.
+        //
+        //
+        //  +------- cv j --------+------- cv i -------+
+        //  |                     |                    |
+        //  v                     v                    v
+        //  ____________________________________________
+        //  | ........ | ........ |          |         |
+        //  | ........ L ........ C          R         |
+        //  |__________|__________|__________|_________|
+        //             ^                     ^
+        //             |                     |
+        //             +--- compartment i ---+
+        //
+        // The first control volume of any cell corresponds to the soma
+        // and the first half of the first cable compartment of that cell.
+
+        auto divs = div_compartments<div_compartment_integrator>(cable, ncomp);
+
+        // assume that this segment has a parent, which is the case so long
+        // as the soma is the root of all cell trees.
+        cv_range.parent_cv = parent[comp_ival.first];
+        cv_range.segment_cvs = comp_ival;
+        cv_range.areas = {divs(0).left.area, divs(ncomp-1).right.area};
+
+        for (auto i: util::make_span(comp_ival)) {
+            const auto& div = divs(i-comp_ival.first);
+            auto j = parent[i];
+
+            // Conductance approximated by weighted harmonic mean of mean
+            // conductances in each half.
+            //
+            // Mean conductances:
+            // g₁ = 1/h₁ ∫₁ A(x)/R dx
+            // g₂ = 1/h₂ ∫₂ A(x)/R dx
+            //
+            // where A(x) is the cross-sectional area, R is the bulk
+            // resistivity, h is the length of the interval and the
+            // integrals are taken over the intervals respectively.
+            // Equivalently, in terms of the semi-compartment volumes
+            // V₁ and V₂:
+            //
+            // g₁ = 1/R·V₁/h₁
+            // g₂ = 1/R·V₂/h₂
+            //
+            // Weighted harmonic mean, with h = h₁+h₂:
+            //
+            // g = (h₁/h·g₁¯¹+h₂/h·g₂¯¹)¯¹
+            //   = 1/R · hV₁V₂/(h₂²V₁+h₁²V₂)
+            //
+            // the following units are used
+            //  lengths : μm
+            //  areas   : μm^2
+            //  volumes : μm^3
+
+            auto h1 = div.left.length;
+            auto V1 = div.left.volume;
+            auto h2 = div.right.length;
+            auto V2 = div.right.volume;
+            auto h = h1+h2;
+
+            auto conductance = 1/rL*h*V1*V2/(h2*h2*V1+h1*h1*V2);
+            // the scaling factor of 10^2 is to convert the quantity
+            // to micro Siemens [μS]
+            face_conductance[i] =  1e2 * conductance / h;
+
+            auto al = div.left.area;
+            auto ar = div.right.area;
+
+            tmp_cv_areas[j] += al;
+            tmp_cv_areas[i] += ar;
+            cv_capacitance[j] += al * cm;
+            cv_capacitance[i] += ar * cm;
+        }
+    }
+    else {
+        throw std::domain_error("FVM lowering encountered unsuported segment type");
+    }
+
+    return cv_range;
+}
+
+} // namespace
+
+cell_discretization discretize(const cell& c) {
+    cell_discretization d;
+
+    auto graph = c.model();
+    d.parent_index.assign(graph.parent_index.begin(), graph.parent_index.end());
+    d.segment_index.assign(graph.segment_index.begin(), graph.segment_index.end());
+
+    auto ncomp = d.parent_index.size();
+    d.face_conductance.assign(ncomp, 0);
+    d.cv_area.assign(ncomp, 0);
+    d.cv_capacitance.assign(ncomp, 0);
+
+    auto nseg = c.num_segments();
+    d.segments.reserve(nseg);
+    for (size_type j = 0; j<nseg; ++j) {
+        d.segments.push_back(compute_cv_area_capacitance(
+            {d.segment_index[j], d.segment_index[j+1]}, c.segment(j), d.parent_index,
+            d.face_conductance, d.cv_area, d.cv_capacitance));
+    }
+
+    return d;
+}
+
+discretization_cache::discretization_ptr discretization_cache::get(const cell& c) {
+    // The segment tree, and the geometry, compartments and electrical
+    // properties of each segment.
+    key_type key;
+    key.push_back(c.num_segments());
+    for (auto i: util::make_span(0, c.num_segments())) {
+        const auto seg = c.segment(i);
+        key.push_back(int(seg->kind()));
+        key.push_back(c.segment_parents()[i]);
+        key.push_back(seg->num_compartments());
+        key.push_back(seg->rL);
+        key.push_back(seg->cm);
+        if (auto soma = seg->as_soma()) {
+            key.push_back(soma->radius());
+        }
+        else if (auto cable = seg->as_cable()) {
+            key.push_back(cable->radii().size());
+            key.insert(key.end(), cable->radii().begin(), cable->radii().end());
+            key.insert(key.end(), cable->lengths().begin(), cable->lengths().end());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(key);
+        if (it!=cache_.end()) {
+            return it->second;
+        }
+    }
+
+    // Discretize outside the lock, so that threads can discretize different
+    // morphologies concurrently; the first to finish is kept.
+    auto d = std::make_shared<const cell_discretization>(discretize(c));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.emplace(std::move(key), std::move(d)).first->second;
+}
+
+std::size_t discretization_cache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.size();
+}
+
+std::size_t discretization_cache::key_hash::operator()(const key_type& k) const {
+    std::size_t h = k.size();
+    for (auto x: k) {
+        h ^= std::hash<double>()(x) + 0x9e3779b9 + (h<<6) + (h>>2);
+    }
+    return h;
+}
+
+} // namespace fvm
+} // namespace arb
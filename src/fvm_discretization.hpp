@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <backends/fvm_types.hpp>
+#include <cell.hpp>
+#include <segment.hpp>
+
+namespace arb {
+namespace fvm {
+
+/// Compact representation of the control volumes into which a segment is
+/// decomposed. Used to reconstruct the weights used to convert current
+/// densities to currents for density channels.
+struct segment_cv_range {
+    using size_type = fvm_size_type;
+    using value_type = fvm_value_type;
+
+    // the contribution to the surface area of the CVs that
+    // are at the beginning and end of the segment
+    std::pair<value_type, value_type> areas;
+
+    // the range of CVs in the segment, excluding the parent CV
+    std::pair<size_type, size_type> segment_cvs;
+
+    // The last CV in the parent segment, which corresponds to the
+    // first CV in this segment.
+    // Set to npos() if there is no parent (i.e. if soma)
+    size_type parent_cv;
+
+    static constexpr size_type npos() {
+        return std::numeric_limits<size_type>::max();
+    }
+
+    // the number of CVs (including the parent)
+    std::size_t size() const {
+        return segment_cvs.second-segment_cvs.first + (parent_cv==npos() ? 0 : 1);
+    }
+
+    bool has_parent() const {
+        return parent_cv != npos();
+    }
+
+    // The same range for a cell whose CVs start at CV offset.
+    segment_cv_range shifted(size_type offset) const {
+        segment_cv_range r = *this;
+        r.segment_cvs.first += offset;
+        r.segment_cvs.second += offset;
+        if (has_parent()) {
+            r.parent_cv += offset;
+        }
+        return r;
+    }
+};
+
+/// The discretization of the morphology of a cell into control volumes
+/// (CVs), numbered from zero, which depends only on the geometry, the number
+/// of compartments and the electrical properties of the segments.
+struct cell_discretization {
+    using size_type = fvm_size_type;
+    using value_type = fvm_value_type;
+
+    // The parent CV of each CV.
+    std::vector<size_type> parent_index;
+
+    // The CVs of each segment: segment i has CVs
+    // [segment_index[i], segment_index[i+1]).
+    std::vector<size_type> segment_index;
+
+    // The CV range of each segment.
+    std::vector<segment_cv_range> segments;
+
+    // The conductance between each CV and its parent CV [µS].
+    std::vector<value_type> face_conductance;
+
+    // The membrane area [µm²] and capacitance [pF] of each CV.
+    std::vector<value_type> cv_area;
+    std::vector<value_type> cv_capacitance;
+
+    size_type size() const { return parent_index.size(); }
+};
+
+cell_discretization discretize(const cell& c);
+
+/// The CV of a cell that holds loc.
+inline int find_cv_index(const segment_location& loc, const cell_discretization& d) {
+    const auto& si = d.segment_index;
+    const auto seg = loc.segment;
+
+    auto first = si[seg];
+    auto n = si[seg+1] - first;
+
+    int index = static_cast<int>(n*loc.position+0.5);
+    index = index==0? d.parent_index[first]: first+(index-1);
+
+    return index;
+}
+
+/// A cache of the discretizations of cells, so that cells with the same
+/// morphology are discretized once. Cells share a discretization if they
+/// have the same segment tree, and their segments have the same geometry,
+/// number of compartments and electrical properties; the mechanisms and
+/// other contents of the cells are not part of the discretization.
+///
+/// The cache can be used concurrently by the threads that initialize cell
+/// groups.
+class discretization_cache {
+public:
+    using discretization_ptr = std::shared_ptr<const cell_discretization>;
+
+    discretization_ptr get(const cell& c);
+
+    // The number of distinct discretizations in the cache.
+    std::size_t size() const;
+
+private:
+    // The description of the morphology of a cell on which its
+    // discretization depends, compared exactly.
+    using key_type = std::vector<double>;
+
+    struct key_hash {
+        std::size_t operator()(const key_type& k) const;
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<key_type, discretization_ptr, key_hash> cache_;
+};
+
+} // namespace fvm
+} // namespace arb
@@ -1,22 +1,27 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <map>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include <algorithms.hpp>
+#include <backends/checkpoint.hpp>
 #include <backends/event.hpp>
 #include <backends/fvm_types.hpp>
 #include <cell.hpp>
 #include <compartment.hpp>
 #include <constants.hpp>
 #include <event_queue.hpp>
+#include <fvm_discretization.hpp>
 #include <ion.hpp>
 #include <math.hpp>
 #include <matrix.hpp>
+#include <mechanism.hpp>
 #include <memory/memory.hpp>
 #include <profiling/profiler.hpp>
 #include <recipe.hpp>
@@ -31,19 +36,6 @@
 namespace arb {
 namespace fvm {
 
-inline int find_cv_index(const segment_location& loc, const compartment_model& graph) {
-    const auto& si = graph.segment_index;
-    const auto seg = loc.segment;
-
-    auto first = si[seg];
-    auto n = si[seg+1] - first;
-
-    int index = static_cast<int>(n*loc.position+0.5);
-    index = index==0? graph.parent_index[first]: first+(index-1);
-
-    return index;
-};
-
 template<class Backend>
 class fvm_multicell {
 public:
@@ -85,14 +77,51 @@ public:
     //
     // Lowered-cell specific handles for targets and probes are stored in the
     // caller-provided vector `target_handles` and map `probe_map`.
+    //
+    // Discretizations of the cell morphologies are taken from `cache` if
+    // provided, so that they can be shared with other cell groups.
     void initialize(
         const std::vector<cell_gid_type>& gids,
         const recipe& rec,
         std::vector<target_handle>& target_handles,
-        probe_association_map<probe_handle>& probe_map);
+        probe_association_map<probe_handle>& probe_map,
+        discretization_cache* cache = nullptr);
 
     void reset();
 
+    // Replace the state of the cells by their steady state at the current
+    // time in the absence of events. The steady state is found by implicit
+    // steps that do not advance time, with a step size that grows while the
+    // voltage converges and shrinks if it does not (pseudo-transient
+    // continuation), within [`dt_min`, `dt_max`] [ms]. Returns true if the
+    // largest rate of change of voltage fell below `tolerance` [mV/ms]
+    // within `max_steps` steps.
+    bool initialize_steady_state(value_type tolerance, unsigned max_steps,
+                                 value_type dt_min, value_type dt_max);
+
+    // Save and restore the state of the cells between integration periods:
+    // the time of each cell, the voltage and current of each CV, and the
+    // state of the ion species, mechanisms and spike detectors.
+    void checkpoint(checkpoint_writer& w) const;
+    void restore(checkpoint_reader& r);
+
+    // Change the parameters of the mechanisms after initialization, e.g.
+    // between the runs of a parameter sweep. Parameters are not part of the
+    // state that reset() restores, so new values are kept by reset().
+    // Throws std::invalid_argument if there is no such mechanism or parameter.
+
+    // Set a range parameter of the density mechanism mech in the CV that
+    // holds loc on cell cell_idx. The value replaces the area weighted mean
+    // over the segments that meet in the CV.
+    void set_density_parameter(size_type cell_idx, segment_location loc,
+        const std::string& mech, const std::string& param, value_type value);
+
+    // Set a range parameter of the point mechanism instance of a target.
+    void set_point_parameter(target_handle h, const std::string& param, value_type value);
+
+    // Set a global parameter of mech, which is shared by all the cells.
+    void set_global_parameter(const std::string& mech, const std::string& param, value_type value);
+
     // fvm_multicell::deliver_event is used only for testing.
     void deliver_event(target_handle h, value_type weight) {
         mechanisms_[h.mech_id]->net_receive(h.mech_index, weight);
@@ -270,10 +299,12 @@ public:
     using crossing_list     = typename backend::threshold_watcher::crossing_list;
 
     /// Forward the list of threshold crossings from the back end.
-    /// The list is passed by value, because we don't want the calling code
-    /// to depend on references to internal state of the solver, and because
-    /// for some backends the results might have to be collated before returning.
-    crossing_list get_spikes() const {
+    /// The list is returned as the back end provides it: by const reference
+    /// for back ends that keep the crossings in host memory, so that no copy
+    /// is made each integration interval, or by value for back ends where the
+    /// results have to be collated before returning. A returned reference is
+    /// invalidated by clear_spikes().
+    auto get_spikes() const -> decltype(std::declval<const threshold_watcher&>().crossings()) {
        return threshold_watcher_.crossings();
     }
 
@@ -313,6 +344,20 @@ private:
         }
     }
 
+    // Update the reversal potentials of the ions from their concentrations.
+    void update_reversal_potentials();
+
+    // Parts of an integration step shared by step_integration and the
+    // steady state iteration: the currents of the mechanisms, with delivery
+    // of the marked events, the solution of the voltage from the currents,
+    // and the update of the mechanism and ion state over dt_comp_.
+    void compute_currents();
+    void integrate_voltage();
+    void integrate_state();
+
+    // An implicit step of size dt that does not advance time.
+    void relax(value_type dt);
+
     /// event queue for integration period
     using deliverable_event_stream = typename backend::deliverable_event_stream;
     deliverable_event_stream events_;
@@ -380,48 +425,41 @@ private:
     /// the set of mechanisms present in the cell
     std::vector<mechanism_ptr> mechanisms_;
 
-    /// the ion species
-    std::map<ionKind, ion_type> ions_;
-
-    /// Compact representation of the control volumes into which a segment is
-    /// decomposed. Used to reconstruct the weights used to convert current
-    /// densities to currents for density channels.
-    struct segment_cv_range {
-        // the contribution to the surface area of the CVs that
-        // are at the beginning and end of the segment
-        std::pair<value_type, value_type> areas;
-
-        // the range of CVs in the segment, excluding the parent CV
-        std::pair<size_type, size_type> segment_cvs;
-
-        // The last CV in the parent segment, which corresponds to the
-        // first CV in this segment.
-        // Set to npos() if there is no parent (i.e. if soma)
-        size_type parent_cv;
-
-        static constexpr size_type npos() {
-            return std::numeric_limits<size_type>::max();
-        }
-
-        // the number of CVs (including the parent)
-        std::size_t size() const {
-            return segment_cvs.second-segment_cvs.first + (parent_cv==npos() ? 0 : 1);
-        }
+    /// The CVs of each segment of the cells, for finding the CV of a location
+    /// after initialization: the first CV and number of CVs of the segment,
+    /// excluding the CV shared with its parent, which is parent. The segments
+    /// of cell i are those in segment_part_[i].
+    struct segment_cvs {
+        size_type first;
+        size_type size;
+        size_type parent;
+    };
+    std::vector<segment_cvs> segment_cvs_;
+    std::vector<size_type> segment_divisions_;
+    util::partition_view_type<std::vector<size_type>> segment_part_;
+
+    /// The CV that holds loc on cell cell_idx: the same as find_cv_index.
+    size_type location_cv(size_type cell_idx, segment_location loc) const {
+        auto segs = segment_part_[cell_idx];
+        EXPECTS(loc.segment<segs.second-segs.first);
+
+        const auto& seg = segment_cvs_[segs.first+loc.segment];
+        int index = static_cast<int>(seg.size*loc.position+0.5);
+        return index==0? seg.parent: seg.first+(index-1);
+    }
 
-        bool has_parent() const {
-            return parent_cv != npos();
+    /// The density mechanism with alias name.
+    mechanism& find_density_mechanism(const std::string& name) {
+        auto it = std::find_if(mechanisms_.begin(), mechanisms_.end(),
+            [&](const mechanism_ptr& m) { return m->alias()==name && m->kind()==mechanismKind::density; });
+        if (it==mechanisms_.end()) {
+            throw std::invalid_argument("no mechanism "+name);
         }
-    };
+        return **it;
+    }
 
-    // perform area and capacitance calculation on initialization
-    segment_cv_range compute_cv_area_capacitance(
-        std::pair<size_type, size_type> comp_ival,
-        const segment* seg,
-        const std::vector<size_type>& parent,
-        std::vector<value_type>& face_conductance,
-        std::vector<value_type>& tmp_cv_areas,
-        std::vector<value_type>& cv_capacitance
-    );
+    /// the ion species
+    std::map<ionKind, ion_type> ions_;
 
     // TODO: This process should be simpler when we can deal with mechanism prototypes and have
     // separate initialization.
@@ -473,142 +511,13 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////// Implementation ////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-template <typename Backend>
-typename fvm_multicell<Backend>::segment_cv_range
-fvm_multicell<Backend>::compute_cv_area_capacitance(
-    std::pair<size_type, size_type> comp_ival,
-    const segment* seg,
-    const std::vector<size_type>& parent,
-    std::vector<value_type>& face_conductance,
-    std::vector<value_type>& tmp_cv_areas,
-    std::vector<value_type>& cv_capacitance)
-{
-    // precondition: group_parent_index[j] holds the correct value for
-    // j in [base_comp, base_comp+segment.num_compartments()].
-
-    auto ncomp = comp_ival.second-comp_ival.first;
-
-    segment_cv_range cv_range;
-
-    auto cm = seg->cm;
-    auto rL = seg->rL;
-
-    if (auto soma = seg->as_soma()) {
-        // confirm assumption that there is one compartment in soma
-        if (ncomp!=1) {
-            throw std::logic_error("soma allocated more than one compartment");
-        }
-        auto i = comp_ival.first;
-        auto area = math::area_sphere(soma->radius());
-
-        tmp_cv_areas[i] += area;
-        cv_capacitance[i] += area*cm;
-
-        cv_range.segment_cvs = {comp_ival.first, comp_ival.first+1};
-        cv_range.areas = {0.0, area};
-        cv_range.parent_cv = segment_cv_range::npos();
-    }
-    else if (auto cable = seg->as_cable()) {
-        // Loop over each compartment in the cable
-        //
-        // Each compartment i straddles the ith control volume on the right
-        // and the jth control volume on the left, where j is the parent index
-        // of i.
-        //
-        // Dividing the comparment into two halves, the centre face C
-        // corresponds to the shared face between the two control volumes,
-        // the surface areas in each half contribute to the surface area of
-        // the respective control volumes, and the volumes and lengths of
-        // each half are used to calculate the flux coefficients that
-        // for the connection between the two control volumes and which
-        // is stored in `face_conductance[i]`.
-        //
-        //
-        //  +------- cv j --------+------- cv i -------+
-        //  |                     |                    |
-        //  v                     v                    v
-        //  ____________________________________________
-        //  | ........ | ........ |          |         |
-        //  | ........ L ........ C          R         |
-        //  |__________|__________|__________|_________|
-        //             ^                     ^
-        //             |                     |
-        //             +--- compartment i ---+
-        //
-        // The first control volume of any cell corresponds to the soma
-        // and the first half of the first cable compartment of that cell.
-
-        auto divs = div_compartments<div_compartment_integrator>(cable, ncomp);
-
-        // assume that this segment has a parent, which is the case so long
-        // as the soma is the root of all cell trees.
-        cv_range.parent_cv = parent[comp_ival.first];
-        cv_range.segment_cvs = comp_ival;
-        cv_range.areas = {divs(0).left.area, divs(ncomp-1).right.area};
-
-        for (auto i: util::make_span(comp_ival)) {
-            const auto& div = divs(i-comp_ival.first);
-            auto j = parent[i];
-
-            // Conductance approximated by weighted harmonic mean of mean
-            // conductances in each half.
-            //
-            // Mean conductances:
-            // g₁ = 1/h₁ ∫₁ A(x)/R dx
-            // g₂ = 1/h₂ ∫₂ A(x)/R dx
-            //
-            // where A(x) is the cross-sectional area, R is the bulk
-            // resistivity, h is the length of the interval and the
-            // integrals are taken over the intervals respectively.
-            // Equivalently, in terms of the semi-compartment volumes
-            // V₁ and V₂:
-            //
-            // g₁ = 1/R·V₁/h₁
-            // g₂ = 1/R·V₂/h₂
-            //
-            // Weighted harmonic mean, with h = h₁+h₂:
-            //
-            // g = (h₁/h·g₁¯¹+h₂/h·g₂¯¹)¯¹
-            //   = 1/R · hV₁V₂/(h₂²V₁+h₁²V₂)
-            //
-            // the following units are used
-            //  lengths : μm
-            //  areas   : μm^2
-            //  volumes : μm^3
-
-            auto h1 = div.left.length;
-            auto V1 = div.left.volume;
-            auto h2 = div.right.length;
-            auto V2 = div.right.volume;
-            auto h = h1+h2;
-
-            auto conductance = 1/rL*h*V1*V2/(h2*h2*V1+h1*h1*V2);
-            // the scaling factor of 10^2 is to convert the quantity
-            // to micro Siemens [μS]
-            face_conductance[i] =  1e2 * conductance / h;
-
-            auto al = div.left.area;
-            auto ar = div.right.area;
-
-            tmp_cv_areas[j] += al;
-            tmp_cv_areas[i] += ar;
-            cv_capacitance[j] += al * cm;
-            cv_capacitance[i] += ar * cm;
-        }
-    }
-    else {
-        throw std::domain_error("FVM lowering encountered unsuported segment type");
-    }
-
-    return cv_range;
-}
-
 template <typename Backend>
 void fvm_multicell<Backend>::initialize(
     const std::vector<cell_gid_type>& gids,
     const recipe& rec,
     std::vector<target_handle>& target_handles,
-    probe_association_map<probe_handle>& probe_map)
+    probe_association_map<probe_handle>& probe_map,
+    discretization_cache* cache)
 {
     using memory::make_const_view;
     using util::any_cast;
@@ -641,6 +550,11 @@ void fvm_multicell<Backend>::initialize(
         cells.push_back(any_cast<cell>(rec.get_cell_description(gid)));
     }
 
+    discretization_cache local_cache;
+    if (!cache) {
+        cache = &local_cache;
+    }
+
     auto cell_num_compartments =
         transform_view(cells, [](const cell& c) { return c.num_compartments(); });
 
@@ -702,6 +616,10 @@ void fvm_multicell<Backend>::initialize(
 
     // setup per-cell event stores.
     events_ = deliverable_event_stream(ncell_);
+
+    segment_cvs_.clear();
+    segment_part_ = make_partition(segment_divisions_,
+        transform_view(cells, [](const cell& c) { return c.num_segments(); }));
     sample_events_ = sample_event_stream(ncell_);
 
     // Create each cell:
@@ -734,28 +652,27 @@ void fvm_multicell<Backend>::initialize(
         auto gid = gids[i];
         auto comp_ival = cell_comp_part[i];
 
-        auto graph = c.model();
+        // Cells with the same morphology share a discretization, which is
+        // stamped into the fused cell group at the offset of the cell's CVs.
+        auto disc = cache->get(c);
+        const auto o = comp_ival.first;
 
-        for (auto k: make_span(comp_ival)) {
-            group_parent_index[k] = graph.parent_index[k-comp_ival.first]+comp_ival.first;
+        for (auto k: make_span(0, disc->size())) {
+            group_parent_index[o+k] = disc->parent_index[k]+o;
+            face_conductance[o+k] = disc->face_conductance[k];
+            tmp_cv_areas[o+k] = disc->cv_area[k];
+            cv_capacitance[o+k] = disc->cv_capacitance[k];
         }
 
-        auto seg_num_compartments =
-            transform_view(c.segments(), [](const segment_ptr& s) { return s->num_compartments(); });
-        const auto nseg = seg_num_compartments.size();
-
-        std::vector<cell_lid_type> seg_comp_bounds;
-        auto seg_comp_part =
-            make_partition(seg_comp_bounds, seg_num_compartments, comp_ival.first);
-
+        const auto nseg = c.num_segments();
         for (size_type j = 0; j<nseg; ++j) {
             const auto& seg = c.segment(j);
-            const auto& seg_comp_ival = seg_comp_part[j];
+            auto first = o+disc->segment_index[j];
+            auto last = o+disc->segment_index[j+1];
 
-            auto cv_range = compute_cv_area_capacitance(
-                seg_comp_ival, seg, group_parent_index,
-                face_conductance, tmp_cv_areas, cv_capacitance);
+            segment_cvs_.push_back({first, last-first, group_parent_index[first]});
 
+            auto cv_range = disc->segments[j].shifted(o);
             for (const auto& mech: seg->mechanisms()) {
                 mech_map[mech.name()].push_back({cv_range, mech.values()});
             }
@@ -764,7 +681,7 @@ void fvm_multicell<Backend>::initialize(
         for (const auto& syn: c.synapses()) {
             const auto& name = syn.mechanism.name();
 
-            cell_lid_type syn_cv = comp_ival.first + find_cv_index(syn.location, graph);
+            cell_lid_type syn_cv = o + find_cv_index(syn.location, *disc);
             cell_lid_type target_index = targets_count++;
 
             syn_mech_map[name].push_back({syn_cv, target_index, syn.mechanism.values()});
@@ -782,7 +699,7 @@ void fvm_multicell<Backend>::initialize(
         std::vector<value_type> stim_amplitudes;
         std::vector<value_type> stim_weights;
         for (const auto& stim: c.stimuli()) {
-            auto idx = comp_ival.first+find_cv_index(stim.location, graph);
+            auto idx = o+find_cv_index(stim.location, *disc);
             stim_index.push_back(idx);
             stim_durations.push_back(stim.clamp.duration());
             stim_delays.push_back(stim.clamp.delay());
@@ -808,7 +725,7 @@ void fvm_multicell<Backend>::initialize(
 
         // calculate spike detector handles are their corresponding compartment indices
         for (const auto& detector: c.detectors()) {
-            auto comp = comp_ival.first+find_cv_index(detector.location, graph);
+            auto comp = o+find_cv_index(detector.location, *disc);
             spike_detector_index.push_back(comp);
             thresholds.push_back(detector.threshold);
         }
@@ -818,7 +735,7 @@ void fvm_multicell<Backend>::initialize(
             probe_info pi = rec.get_probe({gid, j});
             auto where = any_cast<cell_probe_address>(pi.address);
 
-            auto comp = comp_ival.first+find_cv_index(where.location, graph);
+            auto comp = o+find_cv_index(where.location, *disc);
             probe_handle handle;
 
             switch (where.kind) {
@@ -1139,9 +1056,7 @@ void fvm_multicell<Backend>::reset() {
 
     // Update reversal potential to account for changes to concentrations made
     // by calls to nrn_init() in mechansisms.
-    for (auto& i: ions_) {
-        i.second.nernst_reversal_potential(constant::hh_squid_temp); // TODO: use temperature specfied in model
-    }
+    update_reversal_potentials();
 
     // Reset state of the threshold watcher.
     // NOTE: this has to come after the voltage_ values have been reinitialized,
@@ -1160,21 +1075,118 @@ void fvm_multicell<Backend>::reset() {
 }
 
 template <typename Backend>
-void fvm_multicell<Backend>::step_integration() {
-    EXPECTS(!integration_complete());
+void fvm_multicell<Backend>::checkpoint(checkpoint_writer& w) const {
+    EXPECTS(integration_complete());
+    EXPECTS(!has_pending_events());
 
-    // mark pending events for delivery
-    events_.mark_until_after(time_);
+    checkpoint_array(w, time_);
+    checkpoint_array(w, voltage_);
+    checkpoint_array(w, current_);
 
-    PE("current");
+    for (const auto& i: ions_) {
+        w.write<int>(int(i.first));
+        i.second.checkpoint(w);
+    }
+
+    for (const auto& m: mechanisms_) {
+        w.write_string(m->alias());
+        checkpoint_array(w, m->field_data());
+    }
+
+    threshold_watcher_.checkpoint(w);
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::restore(checkpoint_reader& r) {
+    restore_array(r, time_);
+    memory::copy(time_, time_to_);
+    invalidate_time_cache();
+    restore_array(r, voltage_);
+    restore_array(r, current_);
+
+    for (auto& i: ions_) {
+        if (r.read<int>()!=int(i.first)) {
+            throw checkpoint_error("ion species do not match");
+        }
+        i.second.restore(r);
+    }
+
+    for (auto& m: mechanisms_) {
+        if (r.read_string()!=m->alias()) {
+            throw checkpoint_error("mechanism "+m->alias()+" does not match");
+        }
+        restore_array(r, m->field_data());
+    }
+
+    threshold_watcher_.restore(r);
+
+    tfinal_ = 0;
+    dt_max_ = 0;
+    min_remaining_steps_ = 0;
+    events_.clear();
+    sample_events_.clear();
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::set_density_parameter(
+    size_type cell_idx, segment_location loc,
+    const std::string& mech, const std::string& param, value_type value)
+{
+    EXPECTS(cell_idx<ncell_);
+
+    auto& m = find_density_mechanism(mech);
+    auto cv = location_cv(cell_idx, loc);
+
+    // The node index of a density mechanism is sorted.
+    auto node_index = memory::on_host(m.node_index());
+    auto it = algorithms::binary_find(node_index, cv);
+    if (it==node_index.end()) {
+        throw std::invalid_argument("mechanism "+mech+" is not present at the location");
+    }
+    auto i = it-node_index.begin();
+
+    memory::fill(mech_field(m, param)(i, i+1), value);
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::set_point_parameter(target_handle h, const std::string& param, value_type value) {
+    EXPECTS(h.mech_id<mechanisms_.size());
+
+    auto& m = *mechanisms_[h.mech_id];
+    memory::fill(mech_field(m, param)(h.mech_index, h.mech_index+1), value);
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::set_global_parameter(const std::string& mech, const std::string& param, value_type value) {
+    auto it = std::find_if(mechanisms_.begin(), mechanisms_.end(),
+        [&](const mechanism_ptr& m) { return m->alias()==mech; });
+    if (it==mechanisms_.end()) {
+        throw std::invalid_argument("no mechanism "+mech);
+    }
+
+    auto field = (*it)->field_value_ptr(param);
+    if (!field) {
+        throw std::invalid_argument("no scalar parameter "+param+" in mechanism "+mech);
+    }
+    (*it).get()->*field = value;
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::update_reversal_potentials() {
+    for (auto& i: ions_) {
+        i.second.nernst_reversal_potential(constant::hh_squid_temp); // TODO: use temperature specfied in model
+    }
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::compute_currents() {
     memory::fill(current_, 0.);
 
     // clear currents and recalculate reversal potentials for all ion channels
     for (auto& i: ions_) {
-        auto& ion = i.second;
-        memory::fill(ion.current(), 0.);
-        ion.nernst_reversal_potential(constant::hh_squid_temp); // TODO: use temperature specfied in model
+        memory::fill(i.second.current(), 0.);
     }
+    update_reversal_potentials();
 
     // deliver pending events and update current contributions from mechanisms
     for (auto& m: mechanisms_) {
@@ -1183,24 +1195,10 @@ void fvm_multicell<Backend>::step_integration() {
         m->nrn_current();
         PL();
     }
+}
 
-    // remove delivered events from queue and set time_to_
-    events_.drop_marked_events();
-
-    backend::update_time_to(time_to_, time_, dt_max_, tfinal_);
-    invalidate_time_cache();
-    events_.event_time_if_before(time_to_);
-    PL();
-
-    // set per-cell and per-compartment dt (constant within a cell)
-    backend::set_dt(dt_cell_, dt_comp_, time_to_, time_, cv_to_cell_);
-
-    // take samples if they lie within the integration step; they will be provided
-    // with the values (post-event delivery) at the beginning of the interval.
-    sample_events_.mark_until(time_to_);
-    backend::take_samples(sample_events_.marked_events(), time_, sample_time_, sample_value_);
-    sample_events_.drop_marked_events();
-
+template <typename Backend>
+void fvm_multicell<Backend>::integrate_voltage() {
     // solve the linear system
     PE("matrix", "setup");
     matrix_.assemble(dt_cell_, voltage_, current_);
@@ -1210,7 +1208,10 @@ void fvm_multicell<Backend>::step_integration() {
     PL();
     memory::copy(matrix_.solution(), voltage_);
     PL();
+}
 
+template <typename Backend>
+void fvm_multicell<Backend>::integrate_state() {
     // integrate state of gating variables etc.
     PE("state");
     for(auto& m: mechanisms_) {
@@ -1228,6 +1229,100 @@ void fvm_multicell<Backend>::step_integration() {
         m->write_back();
     }
     PL();
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::relax(value_type dt) {
+    // No events are marked for delivery in the steady state iteration.
+    PE("current");
+    compute_currents();
+    PL();
+
+    memory::fill(dt_cell_, dt);
+    memory::fill(dt_comp_, dt);
+
+    integrate_voltage();
+    integrate_state();
+}
+
+template <typename Backend>
+bool fvm_multicell<Backend>::initialize_steady_state(value_type tolerance, unsigned max_steps,
+                                                     value_type dt_min, value_type dt_max) {
+    EXPECTS(integration_complete());
+    EXPECTS(!has_pending_events());
+    EXPECTS(dt_min>0 && dt_min<=dt_max);
+
+    // The explicit treatment of the membrane currents limits the step size
+    // for which the iteration is stable to the order of the membrane time
+    // constants: the step size is adapted to the observed convergence
+    // (switched evolution relaxation) within [dt_min, dt_max].
+
+    std::vector<value_type> v_prev(voltage_.size());
+    auto rate = [&]() {
+        auto v = memory::on_host(voltage_);
+        value_type r = 0;
+        for (auto i: util::make_span(0, v_prev.size())) {
+            r = std::max(r, std::abs(v[i]-v_prev[i]));
+            v_prev[i] = v[i];
+        }
+        return r;
+    };
+
+    bool converged = v_prev.empty();
+    rate();
+
+    value_type dt = dt_min;
+    value_type last_rate = 0;
+    for (unsigned step=0; step<max_steps && !converged; ++step) {
+        relax(dt);
+        auto r = rate()/dt;
+        converged = r<tolerance;
+        if (step) {
+            auto factor = std::min<value_type>(2, std::max<value_type>(0.5, last_rate/r));
+            dt = std::min(dt_max, std::max(dt_min, dt*factor));
+        }
+        last_rate = r;
+    }
+
+    update_reversal_potentials();
+    memory::fill(dt_cell_, 0);
+    memory::fill(dt_comp_, 0);
+
+    // The watchers take their initial state from the new voltage.
+    threshold_watcher_.reset();
+
+    return converged;
+}
+
+template <typename Backend>
+void fvm_multicell<Backend>::step_integration() {
+    EXPECTS(!integration_complete());
+
+    // mark pending events for delivery
+    events_.mark_until_after(time_);
+
+    PE("current");
+    compute_currents();
+
+    // remove delivered events from queue and set time_to_
+    events_.drop_marked_events();
+
+    backend::update_time_to(time_to_, time_, dt_max_, tfinal_);
+    invalidate_time_cache();
+    events_.event_time_if_before(time_to_);
+    PL();
+
+    // set per-cell and per-compartment dt (constant within a cell)
+    backend::set_dt(dt_cell_, dt_comp_, time_to_, time_, cv_to_cell_);
+
+    // take samples if they lie within the integration step; they will be provided
+    // with the values (post-event delivery) at the beginning of the interval.
+    sample_events_.mark_until(time_to_);
+    backend::take_samples(sample_events_.marked_events(), time_, sample_time_, sample_value_);
+    sample_events_.drop_marked_events();
+
+    integrate_voltage();
+    integrate_state();
 
     memory::copy(time_to_, time_);
     invalidate_time_cache();
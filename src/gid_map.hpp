@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+#include <common_types.hpp>
+#include <util/debug.hpp>
+
+namespace arb {
+
+// A map from the gids of a set of cells to values, built once from the gids
+// in any order, and stored in arrays sorted by gid. If the gids are a
+// contiguous range, the value of a gid is found at its offset from the first
+// gid; otherwise by a binary search over the sorted gids.
+template <typename Value>
+class gid_map {
+public:
+    gid_map() = default;
+
+    // Map gids[i] to values[i]. The gids must be unique.
+    gid_map(const std::vector<cell_gid_type>& gids, const std::vector<Value>& values) {
+        EXPECTS(gids.size()==values.size());
+        const auto n = gids.size();
+
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        if (!std::is_sorted(gids.begin(), gids.end())) {
+            std::sort(order.begin(), order.end(),
+                [&](std::size_t a, std::size_t b) { return gids[a]<gids[b]; });
+        }
+
+        values_.reserve(n);
+        for (auto i: order) {
+            values_.push_back(values[i]);
+        }
+
+        if (n) {
+            first_ = gids[order.front()];
+            dense_ = gids[order.back()]-first_+1==n;
+        }
+        if (!dense_) {
+            gids_.reserve(n);
+            for (auto i: order) {
+                gids_.push_back(gids[i]);
+            }
+        }
+    }
+
+    // The value of gid, or nullptr if gid is not in the map.
+    const Value* find(cell_gid_type gid) const {
+        if (dense_) {
+            const auto i = std::size_t(gid-first_);
+            return gid>=first_ && i<values_.size()? &values_[i]: nullptr;
+        }
+        auto it = std::lower_bound(gids_.begin(), gids_.end(), gid);
+        return it!=gids_.end() && *it==gid? &values_[it-gids_.begin()]: nullptr;
+    }
+
+    std::size_t size() const { return values_.size(); }
+
+    // Whether the gids are a contiguous range, looked up by offset.
+    bool dense() const { return dense_; }
+
+private:
+    bool dense_ = true;
+    cell_gid_type first_ = 0;
+    std::vector<cell_gid_type> gids_;   // sorted gids, if not dense
+    std::vector<Value> values_;         // values in order of gid
+};
+
+} // namespace arb
@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <graph_partition.hpp>
+#include <util/debug.hpp>
+
+namespace arb {
+
+namespace {
+
+constexpr unsigned no_vertex = unsigned(-1);
+
+// Contract a heavy edge matching of g: each vertex is matched with the
+// unmatched neighbour to which it has the heaviest edge, provided that the
+// combined vertex weight does not exceed max_weight. Vertices are visited in
+// order of increasing degree, so that vertices with few neighbours are
+// likely to find a match.
+// On return cmap holds the index of the coarse vertex of each vertex of g.
+weighted_graph coarsen(const weighted_graph& g, double max_weight, std::vector<unsigned>& cmap) {
+    const unsigned n = g.size();
+
+    std::vector<unsigned> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(),
+        [&](unsigned a, unsigned b) {
+            return g.offsets[a+1]-g.offsets[a] < g.offsets[b+1]-g.offsets[b];
+        });
+
+    std::vector<unsigned> match(n, no_vertex);
+    for (auto v: order) {
+        if (match[v]!=no_vertex) continue;
+
+        unsigned best = v;
+        double best_weight = 0;
+        for (auto j=g.offsets[v]; j<g.offsets[v+1]; ++j) {
+            auto u = g.adjacency[j];
+            auto w = g.edge_weights[j];
+            if (match[u]==no_vertex && g.vertex_weights[u]+g.vertex_weights[v]<=max_weight) {
+                if (best==v || w>best_weight || (w==best_weight && u<best)) {
+                    best = u;
+                    best_weight = w;
+                }
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    // Number the coarse vertices in order of their first fine vertex.
+    cmap.assign(n, no_vertex);
+    std::vector<std::pair<unsigned, unsigned>> members;
+    members.reserve(n);
+    for (unsigned v=0; v<n; ++v) {
+        if (cmap[v]!=no_vertex) continue;
+        cmap[v] = members.size();
+        cmap[match[v]] = members.size();
+        members.push_back({v, match[v]});
+    }
+
+    const unsigned nc = members.size();
+    weighted_graph c;
+    c.vertex_weights.resize(nc);
+    c.offsets.reserve(nc+1);
+
+    // mark[cu] is the last coarse vertex that has an edge to cu, at
+    // position pos[cu] in the adjacency.
+    std::vector<unsigned> mark(nc, no_vertex);
+    std::vector<std::size_t> pos(nc);
+    for (unsigned cv=0; cv<nc; ++cv) {
+        auto m = members[cv];
+        c.vertex_weights[cv] = g.vertex_weights[m.first];
+        if (m.second!=m.first) {
+            c.vertex_weights[cv] += g.vertex_weights[m.second];
+        }
+
+        for (auto v: {m.first, m.second}) {
+            for (auto j=g.offsets[v]; j<g.offsets[v+1]; ++j) {
+                auto cu = cmap[g.adjacency[j]];
+                if (cu==cv) continue;
+                if (mark[cu]!=cv) {
+                    mark[cu] = cv;
+                    pos[cu] = c.adjacency.size();
+                    c.adjacency.push_back(cu);
+                    c.edge_weights.push_back(g.edge_weights[j]);
+                }
+                else {
+                    c.edge_weights[pos[cu]] += g.edge_weights[j];
+                }
+            }
+            if (m.second==m.first) break;
+        }
+        c.offsets.push_back(c.adjacency.size());
+    }
+
+    return c;
+}
+
+// Scratch space for recursive bisection: marks with a stamp, so that sets of
+// vertices can be marked without clearing the marks of earlier sets.
+struct bisection_scratch {
+    std::vector<unsigned> member;  // stamp of the set being bisected
+    std::vector<unsigned> seen;    // stamp of the current search
+    std::vector<double> conn;      // edge weight into the grown side
+    std::vector<double> degree;    // edge weight into the set
+    std::vector<unsigned> queue;
+    unsigned stamp = 0;
+
+    explicit bisection_scratch(unsigned n):
+        member(n, 0), seen(n, 0), conn(n, 0.), degree(n, 0.)
+    {}
+};
+
+// A vertex at the end of a long shortest path in the set of vertices marked
+// set in s.member, found by two breadth first searches: the first from v, and
+// the second from the last vertex reached by the first.
+unsigned pseudo_peripheral_vertex(const weighted_graph& g, unsigned v, unsigned set, bisection_scratch& s) {
+    for (int i=0; i<2; ++i) {
+        const auto stamp = ++s.stamp;
+        s.queue.assign(1, v);
+        s.seen[v] = stamp;
+        for (std::size_t q=0; q<s.queue.size(); ++q) {
+            auto u = s.queue[q];
+            for (auto j=g.offsets[u]; j<g.offsets[u+1]; ++j) {
+                auto w = g.adjacency[j];
+                if (s.member[w]==set && s.seen[w]!=stamp) {
+                    s.seen[w] = stamp;
+                    s.queue.push_back(w);
+                }
+            }
+        }
+        v = s.queue.back();
+    }
+    return v;
+}
+
+// Grow one side of a bisection of the set of vertices verts, marked set in
+// s.member, from seed. The vertex added at each step is the one that most
+// reduces the cut between the side and the rest of the set, until the side
+// has the target weight; if the side runs out of neighbours, growth
+// continues from the next vertex of the set not yet added.
+// Returns the vertices of the side, and the weight of the cut.
+double grow_bisection(
+    const weighted_graph& g, const std::vector<unsigned>& verts, unsigned set,
+    double target, unsigned seed, bisection_scratch& s, std::vector<unsigned>& side)
+{
+    const auto grown = ++s.stamp;
+    side.clear();
+
+    // Candidates ordered by gain, then by lowest index. Entries are not
+    // removed when their gain changes, so stale entries are skipped when
+    // they are popped.
+    auto gain = [&](unsigned v) { return 2*s.conn[v]-s.degree[v]; };
+    std::priority_queue<std::pair<double, long>> candidates;
+    candidates.push({gain(seed), -long(seed)});
+
+    double weight = 0;
+    double cut = 0;
+    std::size_t next_seed = 0;
+    std::vector<unsigned> touched;
+    while (weight<target) {
+        if (candidates.empty()) {
+            while (next_seed<verts.size() && s.member[verts[next_seed]]==grown) ++next_seed;
+            if (next_seed==verts.size()) break;
+            candidates.push({gain(verts[next_seed]), -long(verts[next_seed])});
+        }
+
+        auto top = candidates.top();
+        candidates.pop();
+        unsigned v = -top.second;
+        if (s.member[v]!=set || top.first!=gain(v)) continue;
+
+        // Stop short if adding v overshoots the target by more than leaving
+        // it out undershoots.
+        const double w = g.vertex_weights[v];
+        if (weight>0 && weight+w-target>target-weight) break;
+
+        s.member[v] = grown;
+        side.push_back(v);
+        weight += w;
+        cut -= gain(v);
+        for (auto j=g.offsets[v]; j<g.offsets[v+1]; ++j) {
+            auto u = g.adjacency[j];
+            if (s.member[u]==set) {
+                if (s.conn[u]==0.) touched.push_back(u);
+                s.conn[u] += g.edge_weights[j];
+                candidates.push({gain(u), -long(u)});
+            }
+        }
+    }
+
+    // Restore the set for the next trial.
+    for (auto u: touched) s.conn[u] = 0.;
+    for (auto v: side) s.member[v] = set;
+
+    return cut;
+}
+
+// Assign the vertices in verts to num_parts parts, starting at first, by
+// recursive bisection. Each bisection is grown from a few seeds, of which
+// the one that gives the smallest cut is kept.
+void recursive_bisection(
+    const weighted_graph& g, const std::vector<unsigned>& verts,
+    unsigned first, unsigned num_parts,
+    std::vector<unsigned>& part, bisection_scratch& s)
+{
+    if (num_parts==1 || verts.size()<=1) {
+        for (auto v: verts) part[v] = first;
+        return;
+    }
+
+    const unsigned left_parts = num_parts/2;
+    double total = 0;
+    for (auto v: verts) total += g.vertex_weights[v];
+    const double target = total*left_parts/num_parts;
+
+    const auto set = ++s.stamp;
+    for (auto v: verts) s.member[v] = set;
+    for (auto v: verts) {
+        s.degree[v] = 0;
+        for (auto j=g.offsets[v]; j<g.offsets[v+1]; ++j) {
+            if (s.member[g.adjacency[j]]==set) {
+                s.degree[v] += g.edge_weights[j];
+            }
+        }
+    }
+
+    const unsigned num_trials = 4;
+    std::vector<unsigned> side, best_side;
+    double best_cut = 0;
+    for (unsigned trial=0; trial<num_trials; ++trial) {
+        unsigned seed = verts[trial*verts.size()/num_trials];
+        if (trial%2==0) {
+            seed = pseudo_peripheral_vertex(g, seed, set, s);
+        }
+        double cut = grow_bisection(g, verts, set, target, seed, s, side);
+        if (trial==0 || cut<best_cut) {
+            best_cut = cut;
+            std::swap(side, best_side);
+        }
+    }
+
+    const auto left = ++s.stamp;
+    for (auto v: best_side) s.member[v] = left;
+
+    std::vector<unsigned> lverts, rverts;
+    for (auto v: verts) {
+        (s.member[v]==left? lverts: rverts).push_back(v);
+    }
+
+    recursive_bisection(g, lverts, first, left_parts, part, s);
+    recursive_bisection(g, rverts, first+left_parts, num_parts-left_parts, part, s);
+}
+
+std::vector<unsigned> initial_partition(const weighted_graph& g, unsigned num_parts) {
+    std::vector<unsigned> verts(g.size());
+    std::iota(verts.begin(), verts.end(), 0u);
+
+    std::vector<unsigned> part(g.size(), 0u);
+    bisection_scratch scratch(g.size());
+    recursive_bisection(g, verts, 0, num_parts, part, scratch);
+    return part;
+}
+
+// Greedy refinement of a partition of g: boundary vertices are moved to the
+// neighbouring part that most reduces the edge cut, provided the part stays
+// within max_weight. Vertices in parts heavier than max_weight may also move
+// to lighter parts at the cost of a larger cut. No part is left empty.
+void refine(const weighted_graph& g, std::vector<unsigned>& part, unsigned num_parts, double max_weight) {
+    constexpr unsigned max_passes = 8;
+    const unsigned n = g.size();
+
+    std::vector<double> part_weight(num_parts, 0.);
+    std::vector<unsigned> part_size(num_parts, 0u);
+    for (unsigned v=0; v<n; ++v) {
+        part_weight[part[v]] += g.vertex_weights[v];
+        ++part_size[part[v]];
+    }
+
+    std::vector<double> conn(num_parts, 0.);
+    std::vector<unsigned> touched;
+
+    for (unsigned pass=0; pass<max_passes; ++pass) {
+        unsigned moves = 0;
+        for (unsigned v=0; v<n; ++v) {
+            const auto own = part[v];
+            const double w = g.vertex_weights[v];
+
+            for (auto j=g.offsets[v]; j<g.offsets[v+1]; ++j) {
+                auto p = part[g.adjacency[j]];
+                if (conn[p]==0.) touched.push_back(p);
+                conn[p] += g.edge_weights[j];
+            }
+
+            const bool over = part_weight[own]>max_weight;
+            unsigned best = own;
+            double best_gain = 0;
+            if (part_size[own]>1) {
+                for (auto p: touched) {
+                    if (p==own) continue;
+                    const double gain = conn[p]-conn[own];
+                    const double wp = part_weight[p]+w;
+                    const bool valid = over?
+                        wp<part_weight[own]:
+                        wp<=max_weight && (gain>0 || (gain==0 && wp<part_weight[own]));
+                    if (!valid) continue;
+                    if (best==own || gain>best_gain || (gain==best_gain && part_weight[p]<part_weight[best])) {
+                        best = p;
+                        best_gain = gain;
+                    }
+                }
+            }
+
+            for (auto p: touched) conn[p] = 0.;
+            touched.clear();
+
+            if (best!=own) {
+                part[v] = best;
+                part_weight[own] -= w;
+                part_weight[best] += w;
+                --part_size[own];
+                ++part_size[best];
+                ++moves;
+            }
+        }
+        if (!moves) break;
+    }
+}
+
+} // namespace
+
+weighted_graph make_weighted_graph(
+    std::vector<double> vertex_weights,
+    const std::vector<std::pair<unsigned, unsigned>>& edges)
+{
+    const unsigned n = vertex_weights.size();
+
+    // Store each edge at both of its end points, then merge the duplicates
+    // in each row.
+    std::vector<std::size_t> offsets(n+1, 0);
+    for (auto& e: edges) {
+        EXPECTS(e.first<n && e.second<n);
+        if (e.first==e.second) continue;
+        ++offsets[e.first+1];
+        ++offsets[e.second+1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<unsigned> neighbours(offsets.back());
+    auto cursor = offsets;
+    for (auto& e: edges) {
+        if (e.first==e.second) continue;
+        neighbours[cursor[e.first]++] = e.second;
+        neighbours[cursor[e.second]++] = e.first;
+    }
+
+    weighted_graph g;
+    g.vertex_weights = std::move(vertex_weights);
+    g.offsets.reserve(n+1);
+    for (unsigned v=0; v<n; ++v) {
+        auto b = neighbours.begin()+offsets[v];
+        auto e = neighbours.begin()+offsets[v+1];
+        std::sort(b, e);
+        for (auto i=b; i!=e; ) {
+            auto j = std::find_if(i, e, [&](unsigned u) { return u!=*i; });
+            g.adjacency.push_back(*i);
+            g.edge_weights.push_back(j-i);
+            i = j;
+        }
+        g.offsets.push_back(g.adjacency.size());
+    }
+
+    return g;
+}
+
+std::vector<unsigned> partition_graph(const weighted_graph& g, unsigned num_parts, double imbalance) {
+    EXPECTS(num_parts>0);
+
+    const unsigned n = g.size();
+    if (num_parts==1 || n==0) {
+        return std::vector<unsigned>(n, 0u);
+    }
+
+    const double total_weight = std::accumulate(g.vertex_weights.begin(), g.vertex_weights.end(), 0.);
+    const double max_vertex_weight = *std::max_element(g.vertex_weights.begin(), g.vertex_weights.end());
+    const double max_part_weight = (1+imbalance)*total_weight/num_parts;
+
+    // Coarsen until the graph is small enough to partition directly, or
+    // until matching no longer reduces its size appreciably.
+    const unsigned coarse_size = std::max(16*num_parts, 64u);
+    const double max_coarse_weight = std::max(1.5*total_weight/coarse_size, max_vertex_weight);
+
+    std::vector<weighted_graph> levels;
+    std::vector<std::vector<unsigned>> cmaps;
+    const weighted_graph* current = &g;
+    while (current->size()>coarse_size) {
+        std::vector<unsigned> cmap;
+        weighted_graph c = coarsen(*current, max_coarse_weight, cmap);
+        if (c.size()>0.95*current->size()) break;
+
+        cmaps.push_back(std::move(cmap));
+        levels.push_back(std::move(c));
+        current = &levels.back();
+    }
+
+    auto part = initial_partition(*current, num_parts);
+    refine(*current, part, num_parts, max_part_weight);
+
+    // Project the partition back to the finer levels, refining it at each.
+    for (auto l=levels.size(); l>0; --l) {
+        const auto& fine = l>1? levels[l-2]: g;
+        const auto& cmap = cmaps[l-1];
+
+        std::vector<unsigned> fine_part(fine.size());
+        for (unsigned v=0; v<fine.size(); ++v) {
+            fine_part[v] = part[cmap[v]];
+        }
+        part = std::move(fine_part);
+        refine(fine, part, num_parts, max_part_weight);
+    }
+
+    return part;
+}
+
+double edge_cut(const weighted_graph& g, const std::vector<unsigned>& part) {
+    EXPECTS(part.size()==g.size());
+
+    double cut = 0;
+    for (unsigned v=0; v<g.size(); ++v) {
+        for (auto j=g.offsets[v]; j<g.offsets[v+1]; ++j) {
+            if (part[g.adjacency[j]]!=part[v]) {
+                cut += g.edge_weights[j];
+            }
+        }
+    }
+    return cut/2;
+}
+
+} // namespace arb
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace arb {
+
+// An undirected graph with weighted vertices and edges, in compressed sparse
+// row form: the neighbours of vertex i are adjacency[offsets[i]] to
+// adjacency[offsets[i+1]-1], with the corresponding edge_weights. Each edge
+// is stored once for each of its end points.
+struct weighted_graph {
+    std::vector<std::size_t> offsets = {0};
+    std::vector<unsigned> adjacency;
+    std::vector<double> edge_weights;
+    std::vector<double> vertex_weights;
+
+    unsigned size() const {
+        return vertex_weights.size();
+    }
+};
+
+// Build a weighted_graph with the given vertex weights from a list of
+// directed edges (first, second). Each pair of distinct vertices that are
+// connected by one or more edges, in either direction, is joined by a single
+// undirected edge weighted by the number of directed edges; self-edges are
+// ignored.
+weighted_graph make_weighted_graph(
+    std::vector<double> vertex_weights,
+    const std::vector<std::pair<unsigned, unsigned>>& edges);
+
+// Partition the vertices of g into num_parts parts of similar total vertex
+// weight, such that the total weight of the edges between parts is small.
+//
+// The graph is coarsened by repeatedly contracting a heavy edge matching,
+// the coarsest graph is partitioned by recursive bisection, with each side
+// grown greedily from a few seeds to minimise the cut, and the partition is
+// projected back through the levels, with greedy boundary
+// refinement at each level. The weight of each part is kept below
+// (1+imbalance) times the mean part weight where the refinement permits it.
+//
+// Returns the part of each vertex. The result depends only on the graph, so
+// that every domain computes the same partition.
+std::vector<unsigned> partition_graph(const weighted_graph& g, unsigned num_parts, double imbalance=0.03);
+
+// The total weight of the edges of g between vertices in different parts.
+double edge_cut(const weighted_graph& g, const std::vector<unsigned>& part);
+
+} // namespace arb
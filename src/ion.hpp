@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <backends/checkpoint.hpp>
 #include <constants.hpp>
 #include <memory/memory.hpp>
 #include <util/indirect.hpp>
@@ -132,6 +133,21 @@ public :
         return node_index_;
     }
 
+    // Save and restore the current, reversal potential and concentrations.
+    void checkpoint(checkpoint_writer& w) const {
+        checkpoint_array(w, iX_);
+        checkpoint_array(w, eX_);
+        checkpoint_array(w, Xi_);
+        checkpoint_array(w, Xo_);
+    }
+
+    void restore(checkpoint_reader& r) {
+        restore_array(r, iX_);
+        restore_array(r, eX_);
+        restore_array(r, Xi_);
+        restore_array(r, Xo_);
+    }
+
     std::size_t size() const {
         return node_index_.size();
     }
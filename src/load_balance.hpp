@@ -1,10 +1,76 @@
-#include <communication/global_policy.hpp>
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include <cell.hpp>
+#include <communication/distributed_context.hpp>
 #include <domain_decomposition.hpp>
 #include <hardware/node_info.hpp>
 #include <recipe.hpp>
 
 namespace arb {
 
-domain_decomposition partition_load_balance(const recipe& rec, hw::node_info nd);
+// The load balancers divide the cells over the domains of the distributed
+// context ctx, and return the decomposition for the calling domain.
+
+// Divide the cells evenly by number over the domains.
+domain_decomposition partition_load_balance(const recipe& rec, hw::node_info nd,
+    const communication::distributed_context& ctx = communication::global_context());
+
+// Divide the cells over the domains in contiguous ranges of gids, such that
+// each domain has a similar share of the total estimated cost of the cells.
+// Cell groups on the cpu are ordered by decreasing cost, so that the most
+// expensive are scheduled first over the threads.
+domain_decomposition cost_load_balance(const recipe& rec, hw::node_info nd,
+    const communication::distributed_context& ctx = communication::global_context());
+
+// Divide the cells over the domains by partitioning the graph of their
+// connections, such that each domain has a similar share of the total
+// estimated cost of the cells, and few connections cross domains.
+// The cells of a domain need not have contiguous gids; gid_domain looks up
+// the domain of each gid in a table.
+//
+// Every domain queries the connections of all cells, and builds and
+// partitions the whole graph, which takes time and memory proportional to
+// the number of global cells and connections on each domain, however many
+// domains there are. It suits networks whose graph fits in the memory of a
+// single node: at the peak, of the order of 40 bytes for each connection
+// and for each cell, plus the coarser levels of the partitioner.
+domain_decomposition graph_load_balance(const recipe& rec, hw::node_info nd,
+    const communication::distributed_context& ctx = communication::global_context());
+
+// Statistics of the connections that cross domains in a decomposition.
+struct decomposition_report {
+    // The total number of connections, and the number between cells on
+    // different domains.
+    std::size_t num_connections = 0;
+    std::size_t cut_connections = 0;
+
+    // For each domain, the number of cells on the domain, and the total over
+    // its cells of the number of other domains with a target of the cell,
+    // i.e. the number of domains to which each spike must be sent.
+    std::vector<std::size_t> domain_cells;
+    std::vector<std::size_t> domain_fan_out;
+};
+
+decomposition_report make_decomposition_report(const recipe& rec, const domain_decomposition& d);
+
+// Print the edge cut and the mean spike fan-out of the cells of each domain.
+std::ostream& operator<<(std::ostream& o, const decomposition_report& r);
+
+// The estimated relative cost of integrating cell gid.
+// This is recipe::cell_cost(gid) if the recipe provides it. Otherwise it
+// depends only on the kind of the cell: 10 for a cable cell, and 1 for any
+// other cell.
+double estimate_cell_cost(const recipe& rec, cell_gid_type gid);
+
+// The estimated relative cost of integrating a cable cell: the sum over
+// segments of the number of compartments times one plus the number of
+// density mechanisms, plus the number of point processes. A recipe can
+// return it from recipe::cell_cost, if it has the description of the cell
+// at hand, or a cheaper way to count its compartments.
+double estimate_cell_cost(const cell& c);
 
 } // namespace arb
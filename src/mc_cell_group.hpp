@@ -3,7 +3,6 @@
 #include <cstdint>
 #include <functional>
 #include <iterator>
-#include <unordered_map>
 #include <vector>
 
 #include <algorithms.hpp>
@@ -13,6 +12,8 @@
 #include <common_types.hpp>
 #include <event_binner.hpp>
 #include <event_queue.hpp>
+#include <fvm_discretization.hpp>
+#include <gid_map.hpp>
 #include <recipe.hpp>
 #include <sampler_map.hpp>
 #include <sampling.hpp>
@@ -22,6 +23,8 @@
 #include <util/filter.hpp>
 #include <util/partition.hpp>
 #include <util/range.hpp>
+#include <util/rangeutil.hpp>
+#include <util/span.hpp>
 #include <util/unique_any.hpp>
 
 #include <profiling/profiler.hpp>
@@ -37,33 +40,35 @@ public:
 
     mc_cell_group() = default;
 
-    mc_cell_group(std::vector<cell_gid_type> gids, const recipe& rec):
+    mc_cell_group(std::vector<cell_gid_type> gids, const recipe& rec, fvm::discretization_cache* cache = nullptr):
         gids_(std::move(gids))
     {
         // Default to no binning of events
         set_binning_policy(binning_kind::none, 0);
 
         // Build lookup table for gid to local index.
-        for (auto i: util::make_span(0, gids_.size())) {
-            gid_index_map_[gids_[i]] = i;
-        }
+        gid_index_map_ = gid_map<cell_size_type>(gids_,
+            util::assign_from(util::make_span(0, gids_.size())));
 
         // Create lookup structure for target ids.
         build_target_handle_partition(rec);
         std::size_t n_targets = target_handle_divisions_.back();
 
         // Pre-allocate space to store handles, probe map.
-        auto n_probes = util::sum_by(gids_, [&rec](cell_gid_type i) { return rec.num_probes(i); });
+        std::vector<cell_size_type> counts;
+        rec.num_probes_range(make_gid_range(gids_), counts);
+        auto n_probes = algorithms::sum(counts);
         probe_map_.reserve(n_probes);
         target_handles_.reserve(n_targets);
 
         // Construct cell implementation, retrieving handles and maps. 
-        lowered_.initialize(gids_, rec, target_handles_, probe_map_);
+        lowered_.initialize(gids_, rec, target_handles_, probe_map_, cache);
 
         // Create a list of the global identifiers for the spike sources
-        for (auto source_gid: gids_) {
-            for (cell_lid_type lid = 0; lid<rec.num_sources(source_gid); ++lid) {
-                spike_sources_.push_back({source_gid, lid});
+        rec.num_sources_range(make_gid_range(gids_), counts);
+        for (auto i: util::make_span(0, gids_.size())) {
+            for (cell_lid_type lid = 0; lid<counts[i]; ++lid) {
+                spike_sources_.push_back({gids_[i], lid});
             }
         }
         spike_sources_.shrink_to_fit();
@@ -82,6 +87,10 @@ public:
         lowered_.reset();
     }
 
+    bool initialize_steady_state(double tolerance, unsigned max_steps, time_type dt_min, time_type dt_max) override {
+        return lowered_.initialize_steady_state(tolerance, max_steps, dt_min, dt_max);
+    }
+
     void set_binning_policy(binning_kind policy, time_type bin_interval) override {
         binners_.clear();
         binners_.resize(gids_.size(), event_binner(policy, bin_interval));
@@ -97,7 +106,7 @@ public:
         // skip event binning if empty lanes are passed
         if (event_lanes.size()) {
             for (auto lid: util::make_span(0, gids_.size())) {
-                auto& lane = event_lanes[lid];
+                auto lane = event_lanes[lid];
                 for (auto e: lane) {
                     if (e.time>=ep.tfinal) break;
                     e.time = binners_[lid].bin(e.time, tstart);
@@ -119,54 +128,46 @@ public:
         // Each event is associated with an offset into the sample data and
         // time buffers; these are assigned contiguously such that one call to
         // a sampler callback can be represented by a `sampler_call_info`
-        // value as defined below, grouping together all the samples of the
-        // same probe for this callback in this association.
-
-        struct sampler_call_info {
-            sampler_function sampler;
-            cell_member_type probe_id;
-            probe_tag tag;
-
-            // Offsets are into lowered cell sample time and event arrays.
-            sample_size_type begin_offset;
-            sample_size_type end_offset;
-        };
+        // value, grouping together all the samples of the same probe for this
+        // callback in this association.
+        //
+        // The call information, sample events and sample records are built
+        // in buffers that are kept between calls to advance.
 
         PE("sample-event-setup");
-        std::vector<sampler_call_info> call_info;
+        call_info_.clear();
+        sample_events_.clear();
 
-        std::vector<sample_event> sample_events;
         sample_size_type n_samples = 0;
-        sample_size_type max_samples_per_call = 0;
 
         for (auto& sa: sampler_map_) {
-            auto sample_times = sa.sched.events(tstart, ep.tfinal);
-            if (sample_times.empty()) {
+            sample_times_.clear();
+            sa.sched.events(tstart, ep.tfinal, sample_times_);
+            if (sample_times_.empty()) {
                 continue;
             }
 
-            sample_size_type n_times = sample_times.size();
-            max_samples_per_call = std::max(max_samples_per_call, n_times);
+            sample_size_type n_times = sample_times_.size();
 
             for (cell_member_type pid: sa.probe_ids) {
                 auto cell_index = gid_to_index(pid.gid);
-                auto p = probe_map_[pid];
+                const auto& p = probe_map_.at(pid);
 
-                call_info.push_back({sa.sampler, pid, p.tag, n_samples, n_samples+n_times});
+                call_info_.push_back({&sa.sampler, pid, p.tag, n_samples, n_samples+n_times});
 
-                for (auto t: sample_times) {
+                for (auto t: sample_times_) {
                     sample_event ev{t, cell_index, {p.handle, n_samples++}};
-                    sample_events.push_back(ev);
+                    sample_events_.push_back(ev);
                 }
             }
         }
 
         // Sample events must be ordered by time for the lowered cell.
-        util::sort_by(sample_events, [](const sample_event& ev) { return event_time(ev); });
+        util::sort_by(sample_events_, [](const sample_event& ev) { return event_time(ev); });
         PL();
 
         // Run integration.
-        lowered_.setup_integration(ep.tfinal, dt, staged_events_, std::move(sample_events));
+        lowered_.setup_integration(ep.tfinal, dt, staged_events_, sample_events_);
         PE("integrator-steps");
 
         while (!lowered_.integration_complete()) {
@@ -184,19 +185,16 @@ public:
         // and then call the callback.
 
         PE("sample-deliver");
-        std::vector<sample_record> sample_records;
-        sample_records.reserve(max_samples_per_call);
-
         auto sample_time = lowered_.sample_time();
         auto sample_value = lowered_.sample_value();
 
-        for (auto& sc: call_info) {
-            sample_records.clear();
+        for (auto& sc: call_info_) {
+            sample_records_.clear();
             for (auto i = sc.begin_offset; i!=sc.end_offset; ++i) {
-                sample_records.push_back(sample_record{time_type(sample_time[i]), &sample_value[i]});
+                sample_records_.push_back(sample_record{time_type(sample_time[i]), &sample_value[i]});
             }
 
-            sc.sampler(sc.probe_id, sc.tag, sc.end_offset-sc.begin_offset, sample_records.data());
+            (*sc.sampler)(sc.probe_id, sc.tag, sc.end_offset-sc.begin_offset, sample_records_.data());
         }
         PL();
 
@@ -227,6 +225,41 @@ public:
         spikes_.clear();
     }
 
+    void checkpoint(checkpoint_writer& w) const override {
+        w.write<std::uint64_t>(binners_.size());
+        for (const auto& b: binners_) {
+            b.checkpoint(w);
+        }
+        sampler_map_.checkpoint(w);
+        lowered_.checkpoint(w);
+    }
+
+    void restore(checkpoint_reader& r) override {
+        spikes_.clear();
+        if (r.read<std::uint64_t>()!=binners_.size()) {
+            throw checkpoint_error("number of cells does not match");
+        }
+        for (auto& b: binners_) {
+            b.restore(r);
+        }
+        sampler_map_.restore(r);
+        lowered_.restore(r);
+    }
+
+    void set_mechanism_parameter(cell_gid_type gid, segment_location loc,
+        const std::string& mech, const std::string& param, double value) override
+    {
+        lowered_.set_density_parameter(gid_to_index(gid), loc, mech, param, value);
+    }
+
+    void set_synapse_parameter(cell_member_type target, const std::string& param, double value) override {
+        lowered_.set_point_parameter(get_target_handle(target), param, value);
+    }
+
+    void set_mechanism_global(const std::string& mech, const std::string& param, double value) override {
+        lowered_.set_global_parameter(mech, param, value);
+    }
+
     const std::vector<cell_member_type>& spike_sources() const {
         return spike_sources_;
     }
@@ -254,8 +287,8 @@ private:
     // List of the gids of the cells in the group.
     std::vector<cell_gid_type> gids_;
 
-    // Hash table for converting gid to local index
-    std::unordered_map<cell_gid_type, cell_gid_type> gid_index_map_;
+    // Table for converting gid to local index
+    gid_map<cell_size_type> gid_index_map_;
 
     // The lowered cell state (e.g. FVM) of the cell.
     lowered_cell_type lowered_;
@@ -272,8 +305,25 @@ private:
     // List of events to deliver
     std::vector<deliverable_event> staged_events_;
 
-    // Pending samples to be taken.
-    event_queue<sample_event> sample_events_;
+    // Samples to be taken in the current integration interval.
+    std::vector<sample_event> sample_events_;
+
+    // Information about the sampler callbacks to be made at the end of the
+    // current integration interval.
+    struct sampler_call_info {
+        const sampler_function* sampler;
+        cell_member_type probe_id;
+        probe_tag tag;
+
+        // Offsets are into lowered cell sample time and event arrays.
+        sample_size_type begin_offset;
+        sample_size_type end_offset;
+    };
+    std::vector<sampler_call_info> call_info_;
+
+    // Scratch space for sample times and the records passed to samplers.
+    std::vector<time_type> sample_times_;
+    std::vector<sample_record> sample_records_;
 
     // Handles for accessing lowered cell.
     using target_handle = typename lowered_cell_type::target_handle;
@@ -291,8 +341,9 @@ private:
 
     // Build handle index lookup tables.
     void build_target_handle_partition(const recipe& rec) {
-        util::make_partition(target_handle_divisions_,
-            util::transform_view(gids_, [&rec](cell_gid_type i) { return rec.num_targets(i); }));
+        std::vector<cell_size_type> counts;
+        rec.num_targets_range(make_gid_range(gids_), counts);
+        util::make_partition(target_handle_divisions_, counts);
     }
 
     // Get target handle from target id.
@@ -309,9 +360,9 @@ private:
     }
 
     cell_gid_type gid_to_index(cell_gid_type gid) const {
-        auto it = gid_index_map_.find(gid);
-        EXPECTS(it!=gid_index_map_.end());
-        return it->second;
+        auto index = gid_index_map_.find(gid);
+        EXPECTS(index);
+        return *index;
     }
 };
 
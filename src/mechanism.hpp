@@ -129,6 +129,11 @@ public:
     // For global fields:
     virtual value_type mechanism::* field_value_ptr(const char* id) const { return nullptr; }
 
+    // The storage of all the per-instance fields of the mechanism, both
+    // parameters and state, as one contiguous view. Used to checkpoint the
+    // state of the mechanism. Empty for mechanisms without such storage.
+    virtual view field_data() { return view(); }
+
     // Convenience wrappers for field access methods with string parameter.
     view mechanism::* field_view_ptr(const std::string& id) const { return field_view_ptr(id.c_str()); }
     value_type mechanism::* field_value_ptr(const std::string& id) const { return field_value_ptr(id.c_str()); }
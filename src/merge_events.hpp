@@ -1,9 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 
 #include <event_generator.hpp>
+#include <event_lanes.hpp>
 #include <event_queue.hpp>
 #include <profiling/profiler.hpp>
 
@@ -36,48 +38,35 @@ namespace arb {
 // All events in lc that are to be delivered before t₀ are discared, along with
 // events from generators after t₁. The generators are left in a state where
 // the next event in the generator is the first event with deliver time >= t₁.
+// The events in the events lane are sorted in place.
+//
+// The events of each generator are drawn in a single batch with
+// event_generator::events, and merged with the other sorted sequences in a
+// k-way merge.
 void merge_events(time_type t0,
                   time_type t1,
-                  const pse_vector& lc,
-                  pse_vector& events,
+                  const_event_lane lc,
+                  event_lane events,
                   std::vector<event_generator_ptr>& generators,
                   pse_vector& lf);
 
-namespace impl {
-    // The tournament tree is used internally by the merge_events method, and
-    // it is not intended for use elsewhere. It is exposed here for unit testing
-    // of its functionality.
-    class tourney_tree {
-        using key_val = std::pair<unsigned, postsynaptic_spike_event>;
-
-    public:
-        tourney_tree(std::vector<event_generator_ptr>& input);
-        bool empty() const;
-        bool empty(time_type t) const;
-        postsynaptic_spike_event head() const;
-        void pop();
-        void print() const;
-
-    private:
-        void setup(unsigned i);
-        void merge_up(unsigned i);
-        void update_lane(unsigned lane);
-        unsigned parent(unsigned i) const;
-        unsigned left(unsigned i) const;
-        unsigned right(unsigned i) const;
-        unsigned leaf(unsigned i) const;
-        bool is_leaf(unsigned i) const;
-        const unsigned& id(unsigned i) const;
-        postsynaptic_spike_event& event(unsigned i);
-        const postsynaptic_spike_event& event(unsigned i) const;
-        unsigned next_power_2(unsigned x) const;
+// Scratch space used to gather and merge the events drawn from generators.
+// Reusing one instance over many calls avoids reallocating the buffers.
+struct merge_scratch {
+    pse_vector events;
+    pse_vector tmp;
+    std::vector<std::size_t> divisions;
+};
 
-        std::vector<key_val> heap_;
-        const std::vector<event_generator_ptr>& input_;
-        unsigned leaves_;
-        unsigned nodes_;
-        unsigned n_lanes_;
-    };
-}
+// As for merge_events, except that the merged events are appended to lf,
+// leaving any events already in lf in place. This is used to merge the lanes
+// of many cells into one staging buffer.
+void append_merged_events(time_type t0,
+                          time_type t1,
+                          const_event_lane lc,
+                          event_lane events,
+                          std::vector<event_generator_ptr>& generators,
+                          pse_vector& lf,
+                          merge_scratch& scratch);
 
 } // namespace arb
@@ -1,75 +1,141 @@
-#include <set>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <backends.hpp>
 #include <cell_group.hpp>
 #include <cell_group_factory.hpp>
+#include <checkpoint.hpp>
 #include <domain_decomposition.hpp>
+#include <execution_context.hpp>
 #include <merge_events.hpp>
 #include <model.hpp>
 #include <recipe.hpp>
+#include <util/allocation_counter.hpp>
 #include <util/filter.hpp>
+#include <util/rangeutil.hpp>
 #include <util/span.hpp>
+#include <util/transform.hpp>
 #include <util/unique_any.hpp>
+#include <profiling/meter_manager.hpp>
 #include <profiling/profiler.hpp>
+#include <threading/timer.hpp>
 
 namespace arb {
 
-model::model(const recipe& rec, const domain_decomposition& decomp):
-    communicator_(rec, decomp)
+namespace {
+    constexpr std::array<char, 8> checkpoint_magic = {{'A', 'R', 'B', 'C', 'K', 'P', 'N', 'T'}};
+
+    std::string checkpoint_file(const std::string& path, int domain_id) {
+        return path+"."+std::to_string(domain_id);
+    }
+}
+
+model::model(const recipe& rec, const domain_decomposition& decomp,
+             execution_context ctx, util::meter_manager* meters):
+    model(rec, decomp, ctx, meters, execution_scope(ctx))
+{}
+
+// The execution_scope makes the task pool and profilers of the context
+// current for the construction of the members and the cell groups.
+model::model(const recipe& rec, const domain_decomposition& decomp,
+             execution_context ctx, util::meter_manager* meters, const execution_scope&):
+    context_(std::move(ctx)),
+    communicator_(rec, decomp, context_.distributed)
 {
-    event_generators_.resize(communicator_.num_local_cells());
-    cell_local_size_type lidx = 0;
+    if (meters) meters->checkpoint("model-communicator", context_.distributed);
+
+    // Store mapping of gid to local cell index and cell group.
     const auto& grps = decomp.groups;
+    std::vector<cell_size_type> group_first_index;
+    group_first_index.reserve(grps.size());
+    std::vector<local_cell> locations;
+    locations.reserve(communicator_.num_local_cells());
+    local_gids_.reserve(communicator_.num_local_cells());
+    cell_local_size_type lidx = 0;
     for (auto i: util::make_span(0, grps.size())) {
+        group_first_index.push_back(lidx);
         for (auto gid: grps[i].gids) {
-            // Store mapping of gid to local cell index.
-            gid_to_local_[gid] = lidx++;
-
-            // Set up the event generators for cell gid.
-            auto rec_gens = rec.event_generators(gid);
-            auto& gens = event_generators_[lidx];
-            if (rec_gens.size()) {
-                // Allocate two empty event generators that will be used to
-                // merge events from the communicator and those already queued
-                // for delivery in future epochs.
-                gens.reserve(2+rec_gens.size());
-                gens.resize(2);
-                for (auto& g: rec_gens) {
-                    gens.push_back(std::move(g));
-                }
-            }
+            local_gids_.push_back(gid);
+            locations.push_back({lidx++, cell_size_type(i)});
         }
     }
+    gid_to_local_ = gid_map<local_cell>(local_gids_, locations);
 
-    // Generate the cell groups in parallel, with one task per cell group.
-    cell_groups_.resize(decomp.groups.size());
+    // Generate the cell groups and the event generators of their cells in
+    // parallel, with one task per cell group.
+    // The groups share the discretizations of cells with the same morphology.
+    fvm::discretization_cache discretizations;
+    event_generators_.resize(communicator_.num_local_cells());
+    cell_groups_.resize(grps.size());
     threading::parallel_for::apply(0, cell_groups_.size(),
         [&](cell_gid_type i) {
             PE("setup", "cells");
-            cell_groups_[i] = cell_group_factory(rec, decomp.groups[i]);
+            cell_groups_[i] = cell_group_factory(rec, grps[i], &discretizations);
             PL(2);
+
+            std::vector<std::vector<event_generator_ptr>> gens;
+            rec.event_generators_range(make_gid_range(grps[i].gids), gens);
+            std::move(gens.begin(), gens.end(), event_generators_.begin()+group_first_index[i]);
         });
 
+    if (meters) meters->checkpoint("model-cells", context_.distributed);
+
 
     // Create event lane buffers.
     // There is one set for each epoch: current (0) and next (1).
     // For each epoch there is one lane for each cell in the cell group.
-    event_lanes_[0].resize(communicator_.num_local_cells());
-    event_lanes_[1].resize(communicator_.num_local_cells());
+    event_lanes_[0].clear(communicator_.num_local_cells());
+    event_lanes_[1].clear(communicator_.num_local_cells());
+    exchange_events_.clear(communicator_.num_local_cells());
+
+    // Divide the local cells into blocks for merging events, with a few
+    // blocks per thread for load balance.
+    const cell_size_type num_cells = communicator_.num_local_cells();
+    const cell_size_type num_blocks = std::min<cell_size_type>(num_cells, 4*context_.thread_pool->get_num_threads());
+    merge_blocks_.resize(num_blocks);
+    for (cell_size_type b=0; b<num_blocks; ++b) {
+        merge_blocks_[b].first = b*num_cells/num_blocks;
+        merge_blocks_[b].last = (b+1)*num_cells/num_blocks;
+    }
+    merged_sizes_.resize(num_cells);
+
+    dataflow_.advance_deps = std::vector<std::atomic<unsigned>>(2*cell_groups_.size());
+
+    // Until the advance of the groups has been timed, each group is advanced
+    // in its own task, in the order of the decomposition.
+    const unsigned num_groups = cell_groups_.size();
+    advance_time_.assign(num_groups, 0.);
+    window_time_.assign(num_groups, 0.);
+    group_order_.resize(num_groups);
+    task_divisions_.resize(num_groups+1);
+    for (unsigned i=0; i<num_groups; ++i) {
+        group_order_[i] = i;
+        task_divisions_[i] = i;
+    }
+    task_divisions_[num_groups] = num_groups;
 }
 
 void model::reset() {
+    execution_scope scope(context_);
+
     t_ = 0.;
+    epoch_ = epoch();
 
     for (auto& group: cell_groups_) {
         group->reset();
     }
 
     for (auto& lanes: event_lanes_) {
-        for (auto& lane: lanes) {
-            lane.clear();
-        }
+        lanes.clear();
     }
 
     for (auto& lane: event_generators_) {
@@ -82,110 +148,368 @@ void model::reset() {
 
     communicator_.reset();
 
-    current_spikes().clear();
-    previous_spikes().clear();
+    for (auto& store: local_spikes_) {
+        store.clear();
+    }
+    local_pending_.clear();
+    interval_spikes_.clear();
+
+    std::fill(advance_time_.begin(), advance_time_.end(), 0.);
+    std::fill(window_time_.begin(), window_time_.end(), 0.);
+    epochs_since_rebalance_ = 0;
 
     util::profilers_restart();
 }
 
 time_type model::run(time_type tfinal, time_type dt) {
+    execution_scope scope(context_);
+
     // Calculate the size of the largest possible time integration interval
     // before communication of spikes is required.
     // If spike exchange and cell update are serialized, this is the
     // minimum delay of the network, however we use half this period
     // to overlap communication and computation.
+    //
+    // If the events of the connections within the domain are delivered on
+    // the domain, the exchange need only overlap the advance of the cells
+    // for the connections between domains. The connections within the
+    // domain are then served by serializing their delivery with the advance
+    // of the cells, in intervals of their minimum delay.
     time_type t_interval = communicator_.min_delay()/2;
+    local_interval_ = 0;
+    if (epoch_length_==epoch_length::cross_domain_delay ||
+        (epoch_length_==epoch_length::min_delay && context_.distributed.size()==1))
+    {
+        const auto remote = communicator_.min_remote_delay();
+        t_interval = remote==std::numeric_limits<time_type>::max()? 2*t_interval: remote/2;
+        local_interval_ = std::min(t_interval, communicator_.min_local_delay());
+    }
+    communicator_.set_local_delivery(local_interval_>0);
+
+    // The end time of each epoch of this run, followed by tfinal: the
+    // exchange in each epoch merges the events due in the epoch after it.
+    epoch_tfinal_.clear();
+    for (time_type t = t_; t<tfinal; ) {
+        t = std::min(t+t_interval, tfinal);
+        epoch_tfinal_.push_back(t);
+    }
+    const std::size_t num_epochs = epoch_tfinal_.size();
+    epoch_tfinal_.push_back(tfinal);
+
+    time_type tuntil = epoch_tfinal_.front();
+
+    // The last exchange of the previous call to run left the pending events
+    // in the lanes of the epoch that follows it, so count on from there.
+    epoch_ = epoch(epoch_.id+1, tuntil);
+    const std::size_t first_epoch = epoch_.id;
+
+    // Generated events are merged into the lanes of an epoch during the
+    // exchange in the epoch before it, so those for the first epoch of this
+    // run are merged here.
+    exchange_events_.clear();
+    merge_lanes(t_, tuntil, lanes(epoch_.id), exchange_events_, lanes(epoch_.id+1));
+    lanes(epoch_.id).swap(lanes(epoch_.id+1));
+
+    epoch_allocations_ = 0;
+    if (scheduling_==epoch_scheduling::dataflow && threading::multithreaded() && !local_interval_) {
+        if (rebalance_interval_ && epochs_since_rebalance_>=rebalance_interval_) {
+            rebalance();
+        }
+        epochs_since_rebalance_ += num_epochs;
 
-    time_type tuntil;
-
-    // task that updates cell state in parallel.
-    auto update_cells = [&] () {
-        threading::parallel_for::apply(
-            0u, cell_groups_.size(),
-            [&](unsigned i) {
-                PE("stepping");
-                auto &group = cell_groups_[i];
-
-                auto queues = util::subrange_view(
-                    event_lanes(epoch_.id),
-                    communicator_.group_queue_range(i));
-                group->advance(epoch_, dt, queues);
-                PE("events");
-                current_spikes().insert(group->spikes());
-                group->clear_spikes();
-                PL(2);
+        const auto allocations = util::allocation_count();
+        run_dataflow(first_epoch, num_epochs, dt);
+        epoch_allocations_ = util::allocation_count()-allocations;
+
+        t_ = tfinal;
+        epoch_ = epoch(first_epoch+num_epochs, tfinal);
+    }
+    else {
+        for (std::size_t k=0; k<num_epochs; ++k) {
+            const auto allocations = util::allocation_count();
+
+            // Run the cell update and the exchange tasks, overlapping if the
+            // threading model and number of available threads permits it.
+            // The tasks are passed by reference, so that the closures handed
+            // to the task system are small enough not to be heap allocated.
+            const time_type tnext = epoch_tfinal_[k+1];
+            threading::task_group g;
+            g.run([&] { exchange(epoch_, tnext); });
+            g.run([&] {
+                if (local_interval_) {
+                    advance_local(epoch_, t_, dt);
+                }
+                else {
+                    advance_groups(epoch_, dt, lanes(epoch_.id));
+                }
             });
-    };
-
-    // task that performs spike exchange with the spikes generated in
-    // the previous integration period, generating the postsynaptic
-    // events that must be delivered at the start of the next
-    // integration period at the latest.
-    auto exchange = [&] () {
-        PE("stepping", "communication");
-
-        PE("exchange");
-        auto local_spikes = previous_spikes().gather();
-        auto global_spikes = communicator_.exchange(local_spikes);
-        PL();
-
-        PE("spike output");
-        local_export_callback_(local_spikes);
-        global_export_callback_(global_spikes.values());
-        PL();
-
-        PE("events","from-spikes");
-        auto events = communicator_.make_event_queues(global_spikes);
-        PL();
-
-        PE("enqueue");
-        threading::parallel_for::apply(0, communicator_.num_local_cells(),
-            [&](cell_size_type i) {
-                const auto epid = epoch_.id;
-                merge_events(
-                    epoch_.tfinal,
-                    epoch_.tfinal+std::min(t_+t_interval, tfinal),
-                    event_lanes(epid)[i],
-                    events[i],
-                    event_generators_[i],
-                    event_lanes(epid+1)[i]);
+            g.wait();
+
+            if (rebalance_interval_ && ++epochs_since_rebalance_>=rebalance_interval_) {
+                rebalance();
+            }
+
+            epoch_allocations_ += util::allocation_count()-allocations;
+
+            t_ = epoch_.tfinal;
+            epoch_.advance(epoch_tfinal_[k+1]);
+        }
+    }
+
+    // Run the exchange one last time to ensure that all spikes are output
+    // to file.
+    exchange(epoch_, tfinal);
+
+    // Move the events still to be delivered within the domain into the
+    // lanes of the next epoch, where the next run expects all pending events.
+    if (!local_pending_.empty()) {
+        exchange_events_.assign(communicator_.num_local_cells(), local_pending_);
+        local_pending_.clear();
+        merge_lanes(tfinal, tfinal, lanes(epoch_.id+1), exchange_events_, lanes(epoch_.id));
+        lanes(epoch_.id).swap(lanes(epoch_.id+1));
+    }
+
+    return t_;
+}
+
+// Advance cell group i over epoch ep with the events in the lanes events,
+// storing its spikes for the exchange in the next epoch, and for the delivery
+// of the events within the domain if that is done locally.
+void model::advance_group(cell_size_type i, const epoch& ep, time_type dt, const event_lanes& events) {
+    PE("stepping");
+    auto& group = cell_groups_[i];
+
+    auto queues = events.subrange(communicator_.group_queue_range(i));
+    const auto start = threading::timer::tic();
+    group->advance(ep, dt, queues);
+    const auto elapsed = threading::timer::toc(start);
+    advance_time_[i] += elapsed;
+    window_time_[i] += elapsed;
+    PE("events");
+    spikes(ep.id).insert(group->spikes());
+    if (local_interval_) {
+        interval_spikes_.insert(group->spikes());
+    }
+    group->clear_spikes();
+    PL(2);
+}
+
+// Advance all cell groups over epoch ep, in parallel over the tasks of the
+// current balance.
+void model::advance_groups(const epoch& ep, time_type dt, const event_lanes& events) {
+    threading::parallel_for::apply(0u, task_divisions_.size()-1,
+        [&](unsigned task) {
+            for (auto j=task_divisions_[task]; j<task_divisions_[task+1]; ++j) {
+                advance_group(group_order_[j], ep, dt, events);
+            }
+        });
+}
+
+// Advance all cell groups over epoch ep, which starts at t0, in intervals of
+// at most local_interval_. The cells of each interval see the events of the
+// lanes of the epoch and the pending events of the connections within the
+// domain that are due in the interval, and the events of their spikes on the
+// domain are made after the interval, to be delivered in later intervals: the
+// minimum delay of these connections is at least the length of an interval.
+void model::advance_local(const epoch& ep, time_type t0, time_type dt) {
+    const auto num_cells = communicator_.num_local_cells();
+    const auto& current = lanes(ep.id);
+    auto by_time = [](const postsynaptic_spike_event& e, time_type t) { return e.time<t; };
+
+    for (time_type t = t0; t<ep.tfinal; ) {
+        const time_type t1 = std::min(t+local_interval_, ep.tfinal);
+
+        PE("events", "local");
+        interval_staged_.clear();
+        for (cell_size_type i=0; i<num_cells; ++i) {
+            auto lane = current[i];
+            auto b = std::lower_bound(lane.begin(), lane.end(), t, by_time);
+            auto e = std::lower_bound(b, lane.end(), t1, by_time);
+            for (; b!=e; ++b) {
+                interval_staged_.push_back({i, *b});
+            }
+        }
+        auto due = std::partition(local_pending_.begin(), local_pending_.end(),
+            [t1](const event_lanes::staged_event& s) { return s.second.time>=t1; });
+        interval_staged_.insert(interval_staged_.end(), due, local_pending_.end());
+        local_pending_.erase(due, local_pending_.end());
+
+        interval_lanes_.assign(num_cells, interval_staged_);
+        threading::parallel_for::apply(0, merge_blocks_.size(),
+            [&](std::size_t b) {
+                for (auto i=merge_blocks_[b].first; i<merge_blocks_[b].last; ++i) {
+                    util::sort(interval_lanes_[i]);
+                }
             });
         PL(2);
 
+        advance_groups(epoch(ep.id, t1), dt, interval_lanes_);
+
+        PE("events", "local");
+        // gather() collates the spikes sorted by source, as make_local_events
+        // requires.
+        interval_spikes_.gather(interval_spike_buffer_);
+        interval_spikes_.clear();
+        communicator_.make_local_events(interval_spike_buffer_, local_pending_);
         PL(2);
-    };
 
-    tuntil = std::min(t_+t_interval, tfinal);
-    epoch_ = epoch(0, tuntil);
-    while (t_<tfinal) {
-        local_spikes_.exchange();
+        t = t1;
+    }
+}
 
-        // empty the spike buffers for the current integration period.
-        // these buffers will store the new spikes generated in update_cells.
-        current_spikes().clear();
+// Reorder the advance of the cell groups by decreasing wall time since the
+// last rebalance, and divide them into tasks. A group that takes at least the
+// target time per task is advanced in a task of its own, while successive
+// cheaper groups are batched into tasks that take about the target time,
+// which is a fraction of the time per thread, as for the merge blocks.
+// Ties are broken by group index, so that the order only depends on the
+// measured times. Called between epochs, when no group is being advanced.
+void model::rebalance() {
+    PE("rebalance");
+    const unsigned num_groups = cell_groups_.size();
+    double total = 0;
+    for (auto t: window_time_) {
+        total += t;
+    }
 
-        // run the tasks, overlapping if the threading model and number of
-        // available threads permits it.
-        threading::task_group g;
-        g.run(exchange);
-        g.run(update_cells);
-        g.wait();
+    if (total>0) {
+        std::sort(group_order_.begin(), group_order_.end(),
+            [&](unsigned a, unsigned b) {
+                return window_time_[a]>window_time_[b] || (window_time_[a]==window_time_[b] && a<b);
+            });
 
-        t_ = tuntil;
+        const double target = total/(4*context_.thread_pool->get_num_threads());
+        task_divisions_.clear();
+        task_divisions_.push_back(0);
+        double batch = 0;
+        for (unsigned j=0; j<num_groups; ++j) {
+            batch += window_time_[group_order_[j]];
+            if (batch>=target || j+1==num_groups) {
+                task_divisions_.push_back(j+1);
+                batch = 0;
+            }
+        }
+    }
 
-        tuntil = std::min(t_+t_interval, tfinal);
-        epoch_.advance(tuntil);
+    std::fill(window_time_.begin(), window_time_.end(), 0.);
+    epochs_since_rebalance_ = 0;
+    PL();
+}
+
+// Perform the spike exchange in epoch ep, with the spikes generated in the
+// previous epoch, generating the postsynaptic events that must be delivered
+// in the next epoch, which ends at tnext, at the latest.
+void model::exchange(const epoch& ep, time_type tnext) {
+    PE("stepping", "communication");
+
+    PE("exchange");
+    auto& local_spikes = local_spike_buffer_;
+    auto& previous = spikes(ep.id-1);
+    previous.gather(local_spikes);
+    previous.clear();
+    const auto& global_spikes = communicator_.exchange(local_spikes);
+    PL();
+
+    PE("spike output");
+    local_export_callback_(local_spikes);
+    global_export_callback_(global_spikes.values());
+    PL();
+
+    PE("events","from-spikes");
+    communicator_.make_event_queues(global_spikes, exchange_events_);
+    PL();
+
+    PE("enqueue");
+    merge_lanes(ep.tfinal, tnext, lanes(ep.id), exchange_events_, lanes(ep.id+1));
+    PL(2);
+
+    PL(2);
+}
+
+// Run num_epochs epochs, starting with the epoch with id first, as a graph
+// of tasks: the advance of each cell group over each epoch, and the exchange
+// in each epoch. Writing A(g, k) for the advance of group g over epoch k, and
+// X(k) for the exchange in epoch k:
+//
+//   A(g, k) depends on A(g, k-1), and on X(k-1), which merges the lanes of
+//           epoch k;
+//   X(k)    depends on X(k-1), and on A(g, k-1) for every group g, which
+//           generate the spikes it exchanges and are the last readers of the
+//           lanes that it overwrites.
+//
+// There is no barrier between epochs: a cell group can advance over epoch k+1
+// while slower groups are still in epoch k.
+//
+// Each task counts down the outstanding dependencies of its successors, and
+// runs those that become ready. The counts for epoch k are indexed by k%2:
+// the count for epoch k+2 is reset when the task for epoch k is run, before
+// any of the dependencies of the task for epoch k+2 can complete.
+void model::run_dataflow(std::size_t first, std::size_t num_epochs, time_type dt) {
+    if (!num_epochs) {
+        return;
     }
 
-    // Run the exchange one last time to ensure that all spikes are output
-    // to file.
-    local_spikes_.exchange();
-    exchange();
+    const unsigned num_groups = cell_groups_.size();
+    dataflow_.first = first;
+    dataflow_.num_epochs = num_epochs;
+    dataflow_.dt = dt;
 
-    return t_;
+    threading::task_group g;
+    dataflow_.tasks = &g;
+
+    for (unsigned i=0; i<num_groups; ++i) {
+        dataflow_.advance_deps[2*i+1] = 2;
+    }
+    dataflow_.exchange_deps[1] = num_groups+1;
+
+    for (auto i: group_order_) {
+        run_advance_task(i, 0);
+    }
+    run_exchange_task(0);
+
+    g.wait();
+    dataflow_.tasks = nullptr;
+}
+
+void model::run_advance_task(unsigned i, unsigned k) {
+    dataflow_.advance_deps[2*i+k%2] = 2;
+    dataflow_.tasks->run([this, i, k] {
+        const auto id = dataflow_.first+k;
+        advance_group(i, epoch(id, epoch_tfinal_[k]), dataflow_.dt, lanes(id));
+
+        if (k+1<dataflow_.num_epochs) {
+            if (--dataflow_.advance_deps[2*i+(k+1)%2]==0) {
+                run_advance_task(i, k+1);
+            }
+            if (--dataflow_.exchange_deps[(k+1)%2]==0) {
+                run_exchange_task(k+1);
+            }
+        }
+    });
+}
+
+void model::run_exchange_task(unsigned k) {
+    dataflow_.exchange_deps[k%2] = cell_groups_.size()+1;
+    dataflow_.tasks->run([this, k] {
+        const auto id = dataflow_.first+k;
+        exchange(epoch(id, epoch_tfinal_[k]), epoch_tfinal_[k+1]);
+
+        if (k+1<dataflow_.num_epochs) {
+            for (auto i: group_order_) {
+                if (--dataflow_.advance_deps[2*i+(k+1)%2]==0) {
+                    run_advance_task(i, k+1);
+                }
+            }
+            if (--dataflow_.exchange_deps[(k+1)%2]==0) {
+                run_exchange_task(k+1);
+            }
+        }
+    });
 }
 
 sampler_association_handle model::add_sampler(cell_member_predicate probe_ids, schedule sched, sampler_function f, sampling_policy policy) {
+    execution_scope scope(context_);
+
     sampler_association_handle h = sassoc_handles_.acquire();
 
     threading::parallel_for::apply(0, cell_groups_.size(),
@@ -197,6 +521,8 @@ sampler_association_handle model::add_sampler(cell_member_predicate probe_ids, s
 }
 
 void model::remove_sampler(sampler_association_handle h) {
+    execution_scope scope(context_);
+
     threading::parallel_for::apply(0, cell_groups_.size(),
         [&](std::size_t i) {
             cell_groups_[i]->remove_sampler(h);
@@ -206,6 +532,8 @@ void model::remove_sampler(sampler_association_handle h) {
 }
 
 void model::remove_all_samplers() {
+    execution_scope scope(context_);
+
     threading::parallel_for::apply(0, cell_groups_.size(),
         [&](std::size_t i) {
             cell_groups_[i]->remove_all_samplers();
@@ -218,14 +546,227 @@ std::size_t model::num_spikes() const {
     return communicator_.num_spikes();
 }
 
+std::size_t model::num_epoch_allocations() const {
+    return epoch_allocations_;
+}
+
 std::size_t model::num_groups() const {
     return cell_groups_.size();
 }
 
-std::vector<pse_vector>& model::event_lanes(std::size_t epoch_id) {
+// Merge the pending events in lc, the events from the spike exchange, and the
+// events drawn from the event generators in [t0, t1), into lf.
+// The lanes of each block of cells are merged into the staging buffer of the
+// block, then packed into the flat lanes of lf.
+void model::merge_lanes(time_type t0, time_type t1, const event_lanes& lc, event_lanes& events, event_lanes& lf) {
+    threading::parallel_for::apply(0, merge_blocks_.size(),
+        [&](std::size_t b) {
+            auto& block = merge_blocks_[b];
+            block.buffer.clear();
+            for (auto i=block.first; i<block.last; ++i) {
+                const auto offset = block.buffer.size();
+                append_merged_events(
+                    t0, t1,
+                    lc[i],
+                    events[i],
+                    event_generators_[i],
+                    block.buffer,
+                    block.scratch);
+                merged_sizes_[i] = block.buffer.size()-offset;
+            }
+        });
+
+    lf.resize_lanes(merged_sizes_);
+
+    // The lanes of a block are contiguous in lf, in the same order as in the
+    // staging buffer of the block.
+    threading::parallel_for::apply(0, merge_blocks_.size(),
+        [&](std::size_t b) {
+            const auto& block = merge_blocks_[b];
+            if (block.first<block.last) {
+                std::copy(block.buffer.begin(), block.buffer.end(), lf[block.first].begin());
+            }
+        });
+}
+
+bool model::initialize_steady_state(double tolerance, unsigned max_steps, time_type dt_min, time_type dt_max) {
+    execution_scope scope(context_);
+
+    std::vector<char> converged(cell_groups_.size());
+    threading::parallel_for::apply(0, cell_groups_.size(),
+        [&](std::size_t i) {
+            PE("steady-state");
+            converged[i] = cell_groups_[i]->initialize_steady_state(tolerance, max_steps, dt_min, dt_max);
+            PL();
+        });
+    return util::all_of(converged, [](char c) { return c; });
+}
+
+// The checkpoint of a domain holds, in order: a header with the format
+// version, the domain and the time; the local gids; the pending event lanes;
+// the state of the event generators; and the state of each cell group. The
+// cell groups are saved to separate buffers in parallel.
+void model::checkpoint(const std::string& path) const {
+    execution_scope scope(context_);
+
+    std::vector<std::string> group_state(cell_groups_.size());
+    threading::parallel_for::apply(0, cell_groups_.size(),
+        [&](std::size_t i) {
+            std::ostringstream out;
+            checkpoint_writer w(out);
+            cell_groups_[i]->checkpoint(w);
+            group_state[i] = out.str();
+        });
+
+    const auto name = checkpoint_file(path, context_.distributed.id());
+    std::ofstream file(name, std::ios::binary);
+    if (!file) {
+        throw checkpoint_error("unable to open "+name);
+    }
+    checkpoint_writer w(file);
+
+    w.write(checkpoint_magic);
+    w.write(checkpoint_version);
+    w.write<std::uint32_t>(context_.distributed.size());
+    w.write<std::uint32_t>(context_.distributed.id());
+    w.write(t_);
+    w.write<std::uint64_t>(epoch_.id);
+    communicator_.checkpoint(w);
+
+    w.write_sequence(local_gids_);
+
+    // The pending events, merged by the last exchange, are in the lanes of
+    // the epoch after the current one.
+    event_lanes_[(epoch_.id+1)%2].checkpoint(w);
+
+    for (const auto& gens: event_generators_) {
+        w.write<std::uint64_t>(gens.size());
+        for (const auto& gen: gens) {
+            gen->checkpoint(w);
+        }
+    }
+
+    w.write<std::uint64_t>(group_state.size());
+    for (const auto& state: group_state) {
+        w.write_string(state);
+    }
+
+    if (!file) {
+        throw checkpoint_error("unable to write "+name);
+    }
+}
+
+void model::restore(const std::string& path) {
+    execution_scope scope(context_);
+    const auto num_cells = communicator_.num_local_cells();
+
+    const auto name = checkpoint_file(path, context_.distributed.id());
+    std::ifstream file(name, std::ios::binary);
+    if (!file) {
+        throw checkpoint_error("unable to open "+name);
+    }
+    checkpoint_reader r(file);
+
+    if (r.read<std::array<char, 8>>()!=checkpoint_magic) {
+        throw checkpoint_error(name+" is not a checkpoint");
+    }
+    auto version = r.read<std::uint32_t>();
+    if (version!=checkpoint_version) {
+        throw checkpoint_error(name+" has format version "+std::to_string(version)
+            +", expected version "+std::to_string(checkpoint_version));
+    }
+    if (r.read<std::uint32_t>()!=unsigned(context_.distributed.size()) ||
+        r.read<std::uint32_t>()!=unsigned(context_.distributed.id()))
+    {
+        throw checkpoint_error(name+" was written by a different domain");
+    }
+    r.read(t_);
+    epoch_ = epoch(r.read<std::uint64_t>(), t_);
+    communicator_.restore(r);
+
+    std::vector<cell_gid_type> gids;
+    r.read_sequence(gids);
+    if (gids!=local_gids_) {
+        throw checkpoint_error("domain decomposition does not match");
+    }
+
+    event_lanes_[(epoch_.id+1)%2].restore(r, num_cells);
+    event_lanes_[epoch_.id%2].clear(num_cells);
+    exchange_events_.clear(num_cells);
+    for (auto& store: local_spikes_) {
+        store.clear();
+    }
+
+    for (auto& gens: event_generators_) {
+        if (r.read<std::uint64_t>()!=gens.size()) {
+            throw checkpoint_error("event generators do not match");
+        }
+        for (auto& gen: gens) {
+            gen->restore(r);
+        }
+    }
+
+    if (r.read<std::uint64_t>()!=cell_groups_.size()) {
+        throw checkpoint_error("cell groups do not match");
+    }
+    std::vector<std::string> group_state(cell_groups_.size());
+    for (auto& state: group_state) {
+        state = r.read_string();
+    }
+
+    // Exceptions are passed out of the tasks that restore the groups, and
+    // the first is rethrown.
+    std::vector<std::exception_ptr> errors(cell_groups_.size());
+    threading::parallel_for::apply(0, cell_groups_.size(),
+        [&](std::size_t i) {
+            try {
+                std::istringstream in(group_state[i]);
+                checkpoint_reader gr(in);
+                cell_groups_[i]->restore(gr);
+                if (in.peek()!=std::istringstream::traits_type::eof()) {
+                    throw checkpoint_error("state of cell group does not match");
+                }
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    for (auto& e: errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+event_lanes& model::lanes(std::size_t epoch_id) {
     return event_lanes_[epoch_id%2];
 }
 
+thread_private_spike_store& model::spikes(std::size_t epoch_id) {
+    return local_spikes_[epoch_id%2];
+}
+
+void model::set_epoch_scheduling(epoch_scheduling policy) {
+    scheduling_ = policy;
+}
+
+void model::set_epoch_length(epoch_length policy) {
+    epoch_length_ = policy;
+}
+
+void model::set_rebalance_interval(unsigned num_epochs) {
+    rebalance_interval_ = num_epochs;
+}
+
+const std::vector<double>& model::group_advance_times() const {
+    return advance_time_;
+}
+
+void model::set_spike_compression(util::optional<time_type> quantum) {
+    EXPECTS(!quantum || *quantum>=0);
+    communicator_.set_spike_compression(quantum);
+}
+
 void model::set_binning_policy(binning_kind policy, time_type bin_interval) {
     for (auto& group: cell_groups_) {
         group->set_binning_policy(policy, bin_interval);
@@ -241,35 +782,92 @@ void model::set_local_spike_callback(spike_export_function export_callback) {
 }
 
 util::optional<cell_size_type> model::local_cell_index(cell_gid_type gid) {
-    auto it = gid_to_local_.find(gid);
-    return it==gid_to_local_.end()?
-        util::nothing:
-        util::optional<cell_size_type>(it->second);
+    auto cell = gid_to_local_.find(gid);
+    return cell? util::optional<cell_size_type>(cell->index): util::nothing;
+}
+
+cell_group* model::local_group(cell_gid_type gid) {
+    auto cell = gid_to_local_.find(gid);
+    return cell? cell_groups_[cell->group].get(): nullptr;
+}
+
+void model::set_mechanism_parameter(cell_gid_type gid, segment_location loc,
+    const std::string& mech, const std::string& param, double value)
+{
+    if (auto group = local_group(gid)) {
+        group->set_mechanism_parameter(gid, loc, mech, param, value);
+    }
+}
+
+void model::set_synapse_parameter(cell_member_type target, const std::string& param, double value) {
+    if (auto group = local_group(target.gid)) {
+        group->set_synapse_parameter(target, param, value);
+    }
+}
+
+void model::set_mechanism_global(cell_gid_type gid, const std::string& mech,
+    const std::string& param, double value)
+{
+    if (auto group = local_group(gid)) {
+        group->set_mechanism_global(mech, param, value);
+    }
+}
+
+void model::set_connection_weight(cell_member_type source, cell_member_type target, float weight) {
+    // The connections onto a target are stored on the domain of the target.
+    if (local_cell_index(target.gid) && !communicator_.set_connection_weight(source, target, weight)) {
+        std::ostringstream msg;
+        msg << "no connection from " << source << " to " << target;
+        if (communicator_.has_procedural_connections()) {
+            msg << " (procedural connections can not be changed)";
+        }
+        throw std::invalid_argument(msg.str());
+    }
 }
 
 void model::inject_events(const pse_vector& events) {
-    auto& lanes = event_lanes(epoch_.id);
-
-    // Append all events that are to be delivered to local cells to the
-    // appropriate lane. At the same time, keep track of which lanes have been
-    // modified, because the lanes will have to be sorted once all events have
-    // been added.
-    pse_vector local_events;
-    std::set<cell_size_type> modified_lanes;
+    // The next call to run starts from the pending events, which are in the
+    // lanes of the epoch after the current one.
+    auto& current = lanes(epoch_.id+1);
+
+    // Collect all events that are to be delivered to local cells, tagged with
+    // the lane of their target. The lanes are flat, so the new events are
+    // merged with the existing lane contents into a new set of lanes.
+    std::vector<event_lanes::staged_event> staged;
     for (auto& e: events) {
         if (e.time<t_) {
             throw std::runtime_error("model::inject_events(): attempt to inject an event at time " + std::to_string(e.time) + ", when model state is at time " + std::to_string(t_));
         }
         if (auto lidx = local_cell_index(e.target.gid)) {
-            lanes[*lidx].push_back(e);
-            modified_lanes.insert(*lidx);
+            staged.push_back({*lidx, e});
         }
     }
+    util::sort(staged);
 
-    // Sort events in the event lanes that were modified
-    for (auto l: modified_lanes) {
-        util::sort(lanes[l]);
+    auto n = current.size();
+    std::vector<std::size_t> counts(n);
+    for (auto i: util::make_span(0, n)) {
+        counts[i] = current[i].size();
+    }
+    for (auto& s: staged) {
+        ++counts[s.first];
     }
+
+    event_lanes updated;
+    updated.resize_lanes(counts);
+
+    auto it = staged.begin();
+    for (auto i: util::make_span(0, n)) {
+        auto end = std::find_if(it, staged.end(),
+            [i](const event_lanes::staged_event& s) { return s.first!=i; });
+        auto lane = current[i];
+        auto injected = util::transform_view(util::make_range(it, end),
+            [](const event_lanes::staged_event& s) { return s.second; });
+        std::merge(lane.begin(), lane.end(), injected.begin(), injected.end(), updated[i].begin());
+        it = end;
+    }
+
+    current.swap(updated);
 }
 
 } // namespace arb
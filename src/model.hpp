@@ -1,31 +1,87 @@
 #pragma once
 
 #include <array>
-#include <unordered_map>
+#include <atomic>
+#include <string>
 #include <vector>
 
 #include <backends.hpp>
 #include <cell_group.hpp>
 #include <common_types.hpp>
 #include <communication/communicator.hpp>
-#include <communication/global_policy.hpp>
+#include <communication/distributed_context.hpp>
 #include <domain_decomposition.hpp>
 #include <epoch.hpp>
+#include <event_lanes.hpp>
+#include <execution_context.hpp>
+#include <gid_map.hpp>
+#include <merge_events.hpp>
 #include <recipe.hpp>
 #include <sampling.hpp>
 #include <thread_private_spike_store.hpp>
+#include <threading/threading.hpp>
 #include <util/nop.hpp>
 #include <util/handle_set.hpp>
+#include <util/optional.hpp>
 #include <util/unique_any.hpp>
 
 namespace arb {
 
+namespace util {
+    class meter_manager;
+}
+
+// How the epochs of model::run are scheduled over the threads.
+enum class epoch_scheduling {
+    // All cell groups finish an epoch, and the spike exchange that overlaps
+    // it, before the next epoch starts.
+    barrier,
+    // Epochs are run as a graph of tasks that depend only on the data that
+    // they use, so that cell groups may run ahead of slower groups and of the
+    // exchange. Falls back to barrier with a single threaded backend.
+    dataflow
+};
+
+// How model::run chooses the length of its epochs, at the end of which the
+// spikes of the cells are exchanged between domains.
+enum class epoch_length {
+    // Half the minimum delay of all connections, so that the exchange of the
+    // spikes of each epoch overlaps the advance of the cells over the next.
+    half_min_delay,
+    // With a single domain, where there is no communication to overlap with
+    // the advance of the cells, the minimum delay of all connections: the
+    // spikes of each epoch are delivered after the cells have advanced over
+    // it. With more than one domain, the same as half_min_delay.
+    min_delay,
+    // Half the minimum delay of the connections between domains, or the
+    // minimum delay of all connections if there are none. The events of the
+    // connections within a domain are delivered on the domain, after the
+    // cells have advanced over each interval of the minimum delay of those
+    // connections within the epoch. Epochs are scheduled with barriers.
+    cross_domain_delay
+};
+
 class model {
 public:
-    using communicator_type = communication::communicator<communication::global_policy>;
+    using communicator_type = communication::communicator<communication::distributed_context>;
     using spike_export_function = std::function<void(const std::vector<spike>&)>;
 
-    model(const recipe& rec, const domain_decomposition& decomp);
+    // The model divides its work over the threads of the task pool of ctx,
+    // profiles with its profilers, and communicates with the other domains
+    // through its distributed context. The domain decomposition must be for
+    // the distributed context.
+    //
+    // The setup of the model is parallel over the threads of the pool. If
+    // meters are provided, the phases of the setup are recorded as their
+    // checkpoints: "model-communicator" and "model-cells". The checkpoints
+    // synchronize the domains of the distributed context of ctx. The report
+    // of the meters is gathered over the global policy, so all processes must
+    // record the same number of checkpoints.
+    model(const recipe& rec, const domain_decomposition& decomp,
+          execution_context ctx = make_global_context(),
+          util::meter_manager* meters = nullptr);
+
+    const execution_context& context() const { return context_; }
 
     void reset();
 
@@ -43,6 +99,38 @@ public:
 
     std::size_t num_spikes() const;
 
+    // The number of heap allocations made during the epochs of the most
+    // recent call to run. Allocations are only counted in builds with
+    // ARB_WITH_ALLOCATION_COUNTER; otherwise this is always zero.
+    std::size_t num_epoch_allocations() const;
+
+    // Set how the epochs of subsequent calls to run are scheduled.
+    void set_epoch_scheduling(epoch_scheduling policy);
+
+    // Set how the length of the epochs of subsequent calls to run is chosen.
+    void set_epoch_length(epoch_length policy);
+
+    // Rebalance the advance of the cell groups over the threads every
+    // num_epochs epochs, from the wall time of the advance of each group
+    // measured since the last rebalance: the groups are advanced in order of
+    // decreasing time, with groups that take much less than the mean time per
+    // task batched into a single task. With dataflow scheduling, the groups
+    // are only reordered at the start of each call to run.
+    // Zero, the default, disables rebalancing.
+    // The order in which groups are advanced does not change the results.
+    void set_rebalance_interval(unsigned num_epochs);
+
+    // The total wall time in seconds spent in the advance of each cell group
+    // since the model was constructed or reset.
+    const std::vector<double>& group_advance_times() const;
+
+    // Exchange spikes between domains in a compressed format, in which spike
+    // times are rounded to multiples of quantum [ms] from the earliest spike
+    // of each domain, or are exact if quantum is zero. Nothing, the default,
+    // exchanges spikes verbatim. The global spike callback and the events
+    // generated by spikes see the rounded times.
+    void set_spike_compression(util::optional<time_type> quantum);
+
     // Set event binning policy on all our groups.
     void set_binning_policy(binning_kind policy, time_type bin_interval);
 
@@ -54,55 +142,194 @@ public:
     // spike vector.
     void set_local_spike_callback(spike_export_function export_callback);
 
+    // Replace the initial state of the cells, from the resting potential and
+    // the initial values of the mechanisms, by the steady state of the cells
+    // in the absence of events, so that simulations need no warm-up period.
+    // The iteration for each cell group stops when the largest rate of
+    // change of the membrane voltage is below tolerance [mV/ms]. The
+    // iteration takes pseudo-time steps between dt_min and dt_max [ms]:
+    // dt_min must be small enough for the iteration to be stable from the
+    // initial state, and dt_max bounds the step once it converges. Returns
+    // false if any group did not converge within max_steps steps. Must be
+    // called between calls to run; reset restores the original initial
+    // state.
+    bool initialize_steady_state(double tolerance=1e-6, unsigned max_steps=100000,
+                                 time_type dt_min=0.025, time_type dt_max=10);
+
+    // Save the state of the model in a checkpoint, from which a model
+    // constructed from the same recipe and domain decomposition can continue
+    // with the same results. Each domain writes its own file, named
+    // path.<domain id>, in a versioned binary format. Must be called between
+    // calls to run; throws checkpoint_error on failure.
+    void checkpoint(const std::string& path) const;
+
+    // Restore the state saved by checkpoint, replacing the current state.
+    // Samplers and the binning policy are not part of the state: the same
+    // samplers must be added, in the same order, and the same binning policy
+    // set, before the model is restored.
+    void restore(const std::string& path);
+
+    // Change the parameters of the cells and connections of the model in
+    // place, between calls to run, e.g. in a parameter sweep, instead of
+    // constructing a new model for each set of parameters. Call reset()
+    // after the changes to start a new run from the initial state with the
+    // new parameters, which reset() keeps. Changes for cells and targets that
+    // are not on this domain are ignored, so all domains can make the same
+    // calls. Throws std::invalid_argument if a cell has no such mechanism or
+    // parameter, or a target has no such connection.
+
+    // Set a range parameter of the density mechanism mech in the CV of cell
+    // gid that holds loc.
+    void set_mechanism_parameter(cell_gid_type gid, segment_location loc,
+        const std::string& mech, const std::string& param, double value);
+
+    // Set a range parameter of the synapse of target.
+    void set_synapse_parameter(cell_member_type target, const std::string& param, double value);
+
+    // Set a global parameter of mechanism mech in the cell group of gid,
+    // which applies to all the cells of the group.
+    void set_mechanism_global(cell_gid_type gid, const std::string& mech,
+        const std::string& param, double value);
+
+    // Set the weight of the connections from source to target given by
+    // recipe::connections_on. Procedural connections are generated anew
+    // from the rule of the recipe as spikes arrive, and can not be changed:
+    // a target with only procedural connections from source throws.
+    void set_connection_weight(cell_member_type source, cell_member_type target, float weight);
+
     // Add events directly to targets.
     // Must be called before calling model::run, and must contain events that
     // are to be delivered at or after the current model time.
     void inject_events(const pse_vector& events);
 
 private:
-    std::vector<pse_vector>& event_lanes(std::size_t epoch_id);
+    model(const recipe& rec, const domain_decomposition& decomp,
+          execution_context ctx, util::meter_manager* meters, const execution_scope&);
+
+    event_lanes& lanes(std::size_t epoch_id);
+
+    void merge_lanes(time_type t0, time_type t1, const event_lanes& lc, event_lanes& events, event_lanes& lf);
+
+    void advance_group(cell_size_type i, const epoch& ep, time_type dt, const event_lanes& events);
+    void advance_groups(const epoch& ep, time_type dt, const event_lanes& events);
+    void advance_local(const epoch& ep, time_type t0, time_type dt);
+    void rebalance();
+    void exchange(const epoch& ep, time_type tnext);
+
+    void run_dataflow(std::size_t first, std::size_t num_epochs, time_type dt);
+    void run_advance_task(unsigned i, unsigned k);
+    void run_exchange_task(unsigned k);
 
     std::size_t num_groups() const;
 
+    execution_context context_;
+
     // keep track of information about the current integration interval
     epoch epoch_;
 
     time_type t_ = 0.;
     std::vector<cell_group_ptr> cell_groups_;
 
+    epoch_scheduling scheduling_ = epoch_scheduling::barrier;
+    epoch_length epoch_length_ = epoch_length::half_min_delay;
+
+    // The wall time of the advance of each cell group: the total, and that
+    // since the last rebalance. Each entry is only written by the task that
+    // advances the group.
+    std::vector<double> advance_time_;
+    std::vector<double> window_time_;
+
+    // The cell groups are advanced in group_order_, in tasks that advance the
+    // groups in successive ranges of the order given by task_divisions_.
+    std::vector<unsigned> group_order_;
+    std::vector<unsigned> task_divisions_;
+    unsigned rebalance_interval_ = 0;
+    unsigned epochs_since_rebalance_ = 0;
+
+    // The end time of each epoch of the current run, followed by its tfinal.
+    std::vector<time_type> epoch_tfinal_;
+
+    // State of a run with dataflow scheduling: the number of outstanding
+    // dependencies of the advance of each cell group i over epoch k, stored
+    // at advance_deps[2*i+k%2], and of the exchange in epoch k, stored at
+    // exchange_deps[k%2]. Epochs k are counted from first.
+    struct dataflow_state {
+        threading::task_group* tasks = nullptr;
+        std::size_t first = 0;
+        std::size_t num_epochs = 0;
+        time_type dt = 0;
+        std::vector<std::atomic<unsigned>> advance_deps;
+        std::atomic<unsigned> exchange_deps[2];
+    };
+    dataflow_state dataflow_;
+
+    // Debug count of the heap allocations made in the epochs of the last run.
+    std::size_t epoch_allocations_ = 0;
+
     // one set of event_generators for each local cell
     std::vector<std::vector<event_generator_ptr>> event_generators_;
 
-    using local_spike_store_type = thread_private_spike_store;
-    util::double_buffer<local_spike_store_type> local_spikes_;
+    // Spikes generated in the cells on this domain, one store for each of
+    // two successive epochs: the spikes of an epoch are exchanged in the
+    // next epoch.
+    std::array<thread_private_spike_store, 2> local_spikes_;
+    thread_private_spike_store& spikes(std::size_t epoch_id);
 
     spike_export_function global_export_callback_ = util::nop_function;
     spike_export_function local_export_callback_ = util::nop_function;
 
-    // Hash table for looking up the the local index of a cell with a given gid
-    std::unordered_map<cell_gid_type, cell_size_type> gid_to_local_;
+    // The index on the domain and the cell group of each local cell, looked
+    // up by gid, and the gid of each local cell, by index.
+    struct local_cell {
+        cell_size_type index;
+        cell_size_type group;
+    };
+    gid_map<local_cell> gid_to_local_;
+    std::vector<cell_gid_type> local_gids_;
 
     util::optional<cell_size_type> local_cell_index(cell_gid_type);
 
+    // The cell group of the local cell gid, or nullptr if gid is not local.
+    cell_group* local_group(cell_gid_type gid);
+
     communicator_type communicator_;
 
-    // Convenience functions that map the spike buffers onto the appropriate
-    // integration interval.
-    //
-    // To overlap communication and computation, integration intervals of
-    // size Delta/2 are used, where Delta is the minimum delay in the global
-    // system.
-    // From the frame of reference of the current integration period we
-    // define three intervals: previous, current and future
-    // Then we define the following :
-    //      current_spikes : spikes generated in the current interval
-    //      previous_spikes: spikes generated in the preceding interval
-
-    local_spike_store_type& current_spikes()  { return local_spikes_.get(); }
-    local_spike_store_type& previous_spikes() { return local_spikes_.other(); }
+    // Buffer for the local spikes gathered for exchange.
+    std::vector<spike> local_spike_buffer_;
 
     // Pending events to be delivered.
-    std::array<std::vector<pse_vector>, 2> event_lanes_;
+    std::array<event_lanes, 2> event_lanes_;
+
+    // Events generated by the spike exchange, one lane per local cell.
+    event_lanes exchange_events_;
+
+    // State of the delivery of the events of the connections within this
+    // domain, in intervals of at most local_interval_ in each epoch, or
+    // zero if these events are delivered by the exchange: the events that
+    // are still to be delivered, tagged by the index of their target cell;
+    // the spikes of the cells in the current interval; and the lanes of the
+    // events for the current interval.
+    time_type local_interval_ = 0;
+    std::vector<event_lanes::staged_event> local_pending_;
+    thread_private_spike_store interval_spikes_;
+    std::vector<spike> interval_spike_buffer_;
+    std::vector<event_lanes::staged_event> interval_staged_;
+    event_lanes interval_lanes_;
+
+    // The local cells are divided into a fixed set of contiguous blocks for
+    // merging events: each block has its own staging buffer and scratch space,
+    // so that the size of the buffers depends only on the events, and not on
+    // how the blocks are scheduled over threads.
+    struct merge_block {
+        cell_size_type first;
+        cell_size_type last;
+        pse_vector buffer;
+        merge_scratch scratch;
+    };
+    std::vector<merge_block> merge_blocks_;
+
+    // The number of merged events for each local cell.
+    std::vector<std::size_t> merged_sizes_;
 
     // Sampler associations handles are managed by a helper class.
     util::handle_set<sampler_association_handle> sassoc_handles_;
@@ -1,47 +1,90 @@
-#include <communication/global_policy.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include <cell.hpp>
+#include <communication/distributed_context.hpp>
 #include <domain_decomposition.hpp>
+#include <graph_partition.hpp>
 #include <hardware/node_info.hpp>
+#include <load_balance.hpp>
 #include <recipe.hpp>
+#include <threading/threading.hpp>
+#include <util/rangeutil.hpp>
+#include <util/span.hpp>
 
 namespace arb {
 
-domain_decomposition partition_load_balance(const recipe& rec, hw::node_info nd) {
-    struct partition_gid_domain {
-        partition_gid_domain(std::vector<cell_gid_type> divs):
-            gid_divisions(std::move(divs))
-        {}
+namespace {
 
-        int operator()(cell_gid_type gid) const {
-            auto gid_part = util::partition_view(gid_divisions);
-            return gid_part.index(gid);
-        }
+struct partition_gid_domain {
+    partition_gid_domain(std::vector<cell_gid_type> divs):
+        gid_divisions(std::move(divs))
+    {}
 
-        const std::vector<cell_gid_type> gid_divisions;
-    };
+    int operator()(cell_gid_type gid) const {
+        auto gid_part = util::partition_view(gid_divisions);
+        return gid_part.index(gid);
+    }
 
-    using kind_type = std::underlying_type<cell_kind>::type;
-    using util::make_span;
+    const std::vector<cell_gid_type> gid_divisions;
+};
 
-    unsigned num_domains = communication::global_policy::size();
-    unsigned domain_id = communication::global_policy::id();
-    auto num_global_cells = rec.num_cells();
+// Lookup of the domain of each gid in a table, with entries of the smallest
+// integer type that can hold the domain indexes.
+template <typename T>
+struct table_gid_domain {
+    table_gid_domain(const std::vector<unsigned>& domains):
+        table(std::make_shared<std::vector<T>>(domains.begin(), domains.end()))
+    {}
 
-    auto dom_size = [&](unsigned dom) -> cell_gid_type {
-        const cell_gid_type B = num_global_cells/num_domains;
-        const cell_gid_type R = num_global_cells - num_domains*B;
-        return B + (dom<R);
-    };
+    int operator()(cell_gid_type gid) const {
+        return (*table)[gid];
+    }
 
-    // Global load balance
+    // Shared, so that copies of the std::function do not copy the table.
+    std::shared_ptr<const std::vector<T>> table;
+};
 
-    std::vector<cell_gid_type> gid_divisions;
-    auto gid_part = make_partition(
-        gid_divisions, transform_view(make_span(0, num_domains), dom_size));
+std::function<int(cell_gid_type)> make_table_gid_domain(const std::vector<unsigned>& domains, unsigned num_domains) {
+    if (num_domains<=std::numeric_limits<std::uint8_t>::max()+1u) {
+        return table_gid_domain<std::uint8_t>(domains);
+    }
+    if (num_domains<=std::numeric_limits<std::uint16_t>::max()+1u) {
+        return table_gid_domain<std::uint16_t>(domains);
+    }
+    return table_gid_domain<std::uint32_t>(domains);
+}
+
+// Build the decomposition of the local domain, given the gids of the local
+// cells in ascending order, and the lookup of the domain of each gid.
+// If costs is not empty, it holds the estimated cost of each global cell, and
+// the cell groups that run on the cpu are ordered by decreasing cost, so that
+// the most expensive groups are scheduled first.
+domain_decomposition make_decomposition(
+    const recipe& rec,
+    hw::node_info nd,
+    const communication::distributed_context& ctx,
+    const std::vector<cell_gid_type>& local_gids,
+    std::function<int(cell_gid_type)> gid_domain,
+    const std::vector<double>& costs)
+{
+    using kind_type = std::underlying_type<cell_kind>::type;
+    unsigned num_domains = ctx.size();
+    unsigned domain_id = ctx.id();
+    auto num_global_cells = rec.num_cells();
 
     // Local load balance
 
     std::unordered_map<kind_type, std::vector<cell_gid_type>> kind_lists;
-    for (auto gid: make_span(gid_part[domain_id])) {
+    for (auto gid: local_gids) {
         kind_lists[rec.get_cell_kind(gid)].push_back(gid);
     }
 
@@ -62,6 +105,7 @@ domain_decomposition partition_load_balance(const recipe& rec, hw::node_info nd)
     std::partition(kinds.begin(), kinds.end(), has_gpu_backend);
 
     std::vector<group_description> groups;
+    std::vector<std::pair<cell_gid_type, cell_kind>> cpu_cells;
     for (auto k: kinds) {
         // put all cells into a single cell group on the gpu if possible
         if (nd.num_gpus && has_gpu_backend(k)) {
@@ -70,27 +114,237 @@ domain_decomposition partition_load_balance(const recipe& rec, hw::node_info nd)
         // otherwise place into cell groups of size 1 on the cpu cores
         else {
             for (auto gid: kind_lists[k]) {
-                groups.push_back({k, {gid}, backend_kind::multicore});
+                cpu_cells.push_back({gid, k});
             }
         }
     }
 
-    // calculate the number of local cells
-    auto rng = gid_part[domain_id];
-    cell_size_type num_local_cells = rng.second - rng.first;
+    if (!costs.empty()) {
+        std::stable_sort(cpu_cells.begin(), cpu_cells.end(),
+            [&](const std::pair<cell_gid_type, cell_kind>& a, const std::pair<cell_gid_type, cell_kind>& b) {
+                return costs[a.first]>costs[b.first];
+            });
+    }
+    for (auto& c: cpu_cells) {
+        groups.push_back({c.second, {c.first}, backend_kind::multicore});
+    }
 
     domain_decomposition d;
     d.num_domains = num_domains;
     d.domain_id = domain_id;
-    d.num_local_cells = num_local_cells;
+    d.num_local_cells = local_gids.size();
     d.num_global_cells = num_global_cells;
     d.groups = std::move(groups);
-    d.gid_domain = partition_gid_domain(std::move(gid_divisions));
+    d.gid_domain = std::move(gid_domain);
 
     return d;
+}
+
+// Build the decomposition of the local domain, given the division of gids
+// into contiguous ranges, one per domain.
+domain_decomposition make_decomposition(
+    const recipe& rec,
+    hw::node_info nd,
+    const communication::distributed_context& ctx,
+    std::vector<cell_gid_type> gid_divisions,
+    const std::vector<double>& costs)
+{
+    unsigned domain_id = ctx.id();
+    auto rng = util::partition_view(gid_divisions)[domain_id];
+    std::vector<cell_gid_type> local_gids = util::assign_from(util::make_span(rng));
 
-    //return domain_decomposition(num_domains, domain_id, num_local_cells, num_global_cells, std::move(groups));
+    return make_decomposition(rec, nd, ctx, local_gids, partition_gid_domain(std::move(gid_divisions)), costs);
 }
 
-} // namespace arb
+// The connectivity graph of the cells, with an edge between each pair of
+// cells that are connected, weighted by the number of connections, and with
+// the estimated cost of each cell as its vertex weight.
+//
+// The connections of each cell are converted to edges as they are queried,
+// so that the connections of all cells are never held at once. The order of
+// the edges depends on the scheduling of the threads, but the graph does
+// not, as make_weighted_graph sorts the neighbours of each vertex.
+weighted_graph make_connectivity_graph(const recipe& rec, std::vector<double>& costs) {
+    using edge_list = std::vector<std::pair<unsigned, unsigned>>;
+    cell_gid_type num_global_cells = rec.num_cells();
+
+    costs.assign(num_global_cells, 0.);
+    threading::enumerable_thread_specific<edge_list> thread_edges;
+    threading::parallel_for::apply(0, num_global_cells,
+        [&](cell_gid_type gid) {
+            costs[gid] = estimate_cell_cost(rec, gid);
+            auto& edges = thread_edges.local();
+            for (const auto& c: rec.connections_on(gid)) {
+                edges.push_back({c.source.gid, gid});
+            }
+        });
+
+    std::size_t num_edges = 0;
+    for (const auto& e: thread_edges) {
+        num_edges += e.size();
+    }
+
+    edge_list edges;
+    edges.reserve(num_edges);
+    for (auto& e: thread_edges) {
+        edges.insert(edges.end(), e.begin(), e.end());
+        edge_list().swap(e);
+    }
+
+    return make_weighted_graph(costs, edges);
+}
+
+} // namespace
+
+domain_decomposition partition_load_balance(const recipe& rec, hw::node_info nd, const communication::distributed_context& ctx) {
+    using util::make_span;
+
+    unsigned num_domains = ctx.size();
+    auto num_global_cells = rec.num_cells();
+
+    auto dom_size = [&](unsigned dom) -> cell_gid_type {
+        const cell_gid_type B = num_global_cells/num_domains;
+        const cell_gid_type R = num_global_cells - num_domains*B;
+        return B + (dom<R);
+    };
+
+    // Global load balance
+
+    std::vector<cell_gid_type> gid_divisions;
+    make_partition(
+        gid_divisions, transform_view(make_span(0, num_domains), dom_size));
+
+    return make_decomposition(rec, nd, ctx, std::move(gid_divisions), {});
+}
+
+double estimate_cell_cost(const recipe& rec, cell_gid_type gid) {
+    if (auto cost = rec.cell_cost(gid)) {
+        return *cost;
+    }
+
+    // Without an estimate from the recipe, all cells of a kind have the same
+    // cost: building the description of every cell on every domain to
+    // estimate its cost would not scale with the number of domains.
+    switch (rec.get_cell_kind(gid)) {
+    case cell_kind::cable1d_neuron:
+        return 10.;
+    default:
+        return 1.;
+    }
+}
+
+double estimate_cell_cost(const cell& c) {
+    // Each compartment integrates the membrane and the density mechanisms of
+    // its segment; point processes add to this.
+    double cost = c.synapses().size() + c.stimuli().size();
+    for (const auto& seg: c.segments()) {
+        cost += seg->num_compartments()*(1.+seg->mechanisms().size());
+    }
+    return cost;
+}
+
+domain_decomposition cost_load_balance(const recipe& rec, hw::node_info nd, const communication::distributed_context& ctx) {
+    unsigned num_domains = ctx.size();
+    cell_gid_type num_global_cells = rec.num_cells();
+
+    // Every domain estimates the cost of every cell, so that all domains
+    // arrive at the same partition without communication. The estimates do
+    // not build the descriptions of the cells.
+    std::vector<double> costs(num_global_cells);
+    threading::parallel_for::apply(0, num_global_cells,
+        [&](cell_gid_type gid) { costs[gid] = estimate_cell_cost(rec, gid); });
+
+    std::vector<double> cost_part(num_global_cells+1, 0.);
+    std::partial_sum(costs.begin(), costs.end(), cost_part.begin()+1);
+    const double total_cost = cost_part.back();
+
+    // Global load balance: divide the gids into contiguous ranges, with the
+    // boundary of each range at the gid where the total cost of the cells
+    // before it is closest to the even share of the domains before it.
+
+    std::vector<cell_gid_type> gid_divisions(num_domains+1, 0);
+    for (unsigned dom=1; dom<num_domains; ++dom) {
+        const double target = total_cost*dom/num_domains;
+        auto it = std::lower_bound(cost_part.begin(), cost_part.end(), target);
+        cell_gid_type b = it-cost_part.begin();
+        if (b>0 && target-cost_part[b-1]<cost_part[b]-target) {
+            --b;
+        }
+        gid_divisions[dom] = std::max(b, gid_divisions[dom-1]);
+    }
+    gid_divisions[num_domains] = num_global_cells;
+
+    return make_decomposition(rec, nd, ctx, std::move(gid_divisions), costs);
+}
+
+domain_decomposition graph_load_balance(const recipe& rec, hw::node_info nd, const communication::distributed_context& ctx) {
+    unsigned num_domains = ctx.size();
+    unsigned domain_id = ctx.id();
+    cell_gid_type num_global_cells = rec.num_cells();
 
+    // Every domain builds and partitions the whole graph, and arrives at the
+    // same partition without communication.
+    std::vector<double> costs;
+    auto domains = partition_graph(make_connectivity_graph(rec, costs), num_domains);
+
+    std::vector<cell_gid_type> local_gids;
+    for (cell_gid_type gid=0; gid<num_global_cells; ++gid) {
+        if (domains[gid]==domain_id) {
+            local_gids.push_back(gid);
+        }
+    }
+
+    return make_decomposition(rec, nd, ctx, local_gids, make_table_gid_domain(domains, num_domains), costs);
+}
+
+decomposition_report make_decomposition_report(const recipe& rec, const domain_decomposition& d) {
+    cell_gid_type num_global_cells = rec.num_cells();
+
+    decomposition_report report;
+    report.domain_cells.assign(d.num_domains, 0);
+    report.domain_fan_out.assign(d.num_domains, 0);
+
+    std::vector<unsigned> domains(num_global_cells);
+    for (cell_gid_type gid=0; gid<num_global_cells; ++gid) {
+        domains[gid] = d.gid_domain(gid);
+        ++report.domain_cells[domains[gid]];
+    }
+
+    // Pairs of (source gid, target domain) for each connection that crosses
+    // domains: each distinct pair is a domain to which the spikes of the
+    // source must be sent.
+    std::vector<std::pair<cell_gid_type, unsigned>> remote;
+    for (cell_gid_type gid=0; gid<num_global_cells; ++gid) {
+        for (const auto& c: rec.connections_on(gid)) {
+            ++report.num_connections;
+            if (domains[c.source.gid]!=domains[gid]) {
+                ++report.cut_connections;
+                remote.push_back({c.source.gid, domains[gid]});
+            }
+        }
+    }
+
+    util::sort(remote);
+    remote.erase(std::unique(remote.begin(), remote.end()), remote.end());
+    for (auto& r: remote) {
+        ++report.domain_fan_out[domains[r.first]];
+    }
+
+    return report;
+}
+
+std::ostream& operator<<(std::ostream& o, const decomposition_report& r) {
+    o << "connections cut: " << r.cut_connections << " of " << r.num_connections;
+    if (r.num_connections) {
+        o << " (" << 100.*r.cut_connections/r.num_connections << "%)";
+    }
+    o << "\n";
+    o << "domain     cells    spike fan-out\n";
+    for (std::size_t i=0; i<r.domain_cells.size(); ++i) {
+        double fan_out = r.domain_cells[i]? double(r.domain_fan_out[i])/r.domain_cells[i]: 0.;
+        o << std::setw(6) << i << std::setw(10) << r.domain_cells[i] << std::setw(17) << fan_out << "\n";
+    }
+    return o;
+}
+
+} // namespace arb
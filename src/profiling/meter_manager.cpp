@@ -6,6 +6,7 @@
 
 #include "meter_manager.hpp"
 #include "memory_meter.hpp"
+#include "network_meter.hpp"
 #include "power_meter.hpp"
 
 namespace arb {
@@ -40,6 +41,9 @@ meter_manager::meter_manager() {
     if (auto m = make_power_meter()) {
         meters_.push_back(std::move(m));
     }
+    if (auto m = make_network_meter()) {
+        meters_.push_back(std::move(m));
+    }
 };
 
 void meter_manager::start() {
@@ -60,6 +64,10 @@ void meter_manager::start() {
 
 
 void meter_manager::checkpoint(std::string name) {
+    checkpoint(std::move(name), communication::global_context());
+}
+
+void meter_manager::checkpoint(std::string name, const communication::distributed_context& ctx) {
     EXPECTS(started_);
 
     // Record the time taken on this domain since the last checkpoint
@@ -73,7 +81,7 @@ void meter_manager::checkpoint(std::string name) {
     }
 
     // Synchronize all domains before setting start time for the next interval
-    communication::global_policy::barrier();
+    ctx.barrier();
     start_time_ = timer_type::tic();
 }
 
@@ -160,6 +168,9 @@ std::ostream& operator<<(std::ostream& o, const meter_report& report) {
         else if (m.name.find("energy")!=std::string::npos) {
             o << strprintf("%16s", m.name+"(kJ)");
         }
+        else if (m.name=="network") {
+            o << strprintf("%16s", "network(s)");
+        }
     }
     o << "\n-------------------------------------------------------------------------------------------\n";
     int cp_index = 0;
@@ -181,6 +192,13 @@ std::ostream& operator<<(std::ostream& o, const meter_report& report) {
                 auto doms_per_host = double(report.num_domains)/report.num_hosts;
                 o << strprintf("%16.3f", algorithms::sum(e)/doms_per_host*1e-3);
             }
+            else if (m.name=="network") {
+                // The time predicted for the exchanges between dry run ranks,
+                // which is much shorter than the time of the run on small
+                // numbers of ranks.
+                std::vector<double> times = m.measurements[cp_index];
+                o << strprintf("%16.6f", algorithms::mean(times));
+            }
         }
         o << "\n";
         ++cp_index;
@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 
+#include <communication/distributed_context.hpp>
 #include <communication/global_policy.hpp>
 #include <json/json.hpp>
 
@@ -44,6 +45,11 @@ public:
     void start();
     void checkpoint(std::string name);
 
+    // As above, but synchronize only the domains of ctx before the start of
+    // the next interval, e.g. at the checkpoints of a model that runs on a
+    // local context.
+    void checkpoint(std::string name, const communication::distributed_context& ctx);
+
     const std::vector<std::unique_ptr<meter>>& meters() const;
     const std::vector<std::string>& checkpoint_names() const;
     const std::vector<double>& times() const;
@@ -0,0 +1,54 @@
+#include <string>
+#include <vector>
+
+#include <communication/global_policy.hpp>
+
+#include "meter.hpp"
+#include "network_meter.hpp"
+
+namespace arb {
+namespace util {
+
+#ifdef ARB_HAVE_DRYRUN
+
+class network_meter: public meter {
+    std::vector<double> readings_;
+
+public:
+    std::string name() override {
+        return "network";
+    }
+
+    std::string units() override {
+        return "s";
+    }
+
+    std::vector<double> measurements() override {
+        std::vector<double> diffs;
+
+        for (auto i=1ul; i<readings_.size(); ++i) {
+            diffs.push_back(readings_[i]-readings_[i-1]);
+        }
+
+        return diffs;
+    }
+
+    void take_reading() override {
+        readings_.push_back(communication::global_policy::predicted_network_time());
+    }
+};
+
+meter_ptr make_network_meter() {
+    return meter_ptr(new network_meter());
+}
+
+#else
+
+meter_ptr make_network_meter() {
+    return nullptr;
+}
+
+#endif
+
+} // namespace util
+} // namespace arb
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "meter.hpp"
+
+namespace arb {
+namespace util {
+
+// The communication time predicted by the network model of a dry run: see
+// dryrun_global_policy::set_network_model. Only available in dry run builds.
+meter_ptr make_network_meter();
+
+} // namespace util
+} // namespace arb
@@ -15,6 +15,7 @@
 #include <json/json.hpp>
 
 #include <threading/threading.hpp>
+#include <util/debug.hpp>
 
 namespace arb {
 namespace util {
@@ -202,12 +203,72 @@ private:
     region_type* current_region_ = &root_region_;
 };
 
-#ifdef ARB_HAVE_PROFILING
-namespace data {
-    using profiler_wrapper = arb::threading::enumerable_thread_specific<profiler>;
-    extern profiler_wrapper profilers_;
-}
-#endif
+// The profilers of the threads of a task pool, one for each thread, indexed
+// by threading::current_thread_index().
+//
+// The profiling functions below use the profiler context of the calling
+// thread, which is the global context, with one profiler for each thread of
+// the process-wide task pool, unless another context has been made current
+// with a profiler_scope. A context may only be used by one thread outside
+// its pool at a time.
+class profiler_context {
+public:
+    using iterator = std::vector<profiler>::iterator;
+
+    explicit profiler_context(std::size_t num_threads):
+        profilers_(num_threads, profiler("root"))
+    {}
+
+    profiler_context(const profiler_context&) = delete;
+    profiler_context& operator=(const profiler_context&) = delete;
+
+    // The profiler of the calling thread.
+    profiler& local() {
+        auto i = threading::current_thread_index();
+        EXPECTS(i<profilers_.size());
+        return profilers_[i];
+    }
+
+    std::size_t size() const { return profilers_.size(); }
+    iterator begin() { return profilers_.begin(); }
+    iterator end() { return profilers_.end(); }
+
+    static profiler_context& global();
+    static profiler_context& current();
+
+    // Make ctx the context of the calling thread for the rest of its life,
+    // e.g. for the worker threads of a task pool.
+    static void set_current(profiler_context& ctx) {
+        current_ = &ctx;
+    }
+
+private:
+    friend class profiler_scope;
+    static thread_local profiler_context* current_;
+
+    std::vector<profiler> profilers_;
+};
+
+// Make ctx the profiler context of the calling thread for the lifetime of
+// the profiler_scope.
+class profiler_scope {
+public:
+    explicit profiler_scope(profiler_context& ctx):
+        previous_(profiler_context::current_)
+    {
+        profiler_context::current_ = &ctx;
+    }
+
+    profiler_scope(const profiler_scope&) = delete;
+    profiler_scope& operator=(const profiler_scope&) = delete;
+
+    ~profiler_scope() {
+        profiler_context::current_ = previous_;
+    }
+
+private:
+    profiler_context* previous_;
+};
 
 /// get a reference to the thread private profiler
 /// will lazily create and start the profiler it it has not already been done so
@@ -4,10 +4,13 @@
 #include <memory>
 #include <unordered_map>
 #include <stdexcept>
+#include <vector>
 
 #include <cell.hpp>
 #include <common_types.hpp>
 #include <event_generator.hpp>
+#include <util/optional.hpp>
+#include <util/range.hpp>
 #include <util/unique_any.hpp>
 
 namespace arb {
@@ -52,6 +55,18 @@ struct cell_connection {
     {}
 };
 
+// Procedural connections are described by a connection_rule: see
+// connection_rule.hpp.
+class connection_rule;
+using connection_rule_ptr = std::shared_ptr<const connection_rule>;
+
+// A contiguous sequence of gids, for the bulk queries of a recipe.
+using gid_range = util::range<const cell_gid_type*>;
+
+inline gid_range make_gid_range(const std::vector<cell_gid_type>& gids) {
+    return gid_range(gids.data(), gids.data()+gids.size());
+}
+
 class recipe {
 public:
     virtual cell_size_type num_cells() const = 0;
@@ -69,8 +84,59 @@ public:
     virtual std::vector<cell_connection> connections_on(cell_gid_type) const = 0;
     virtual probe_info get_probe(cell_member_type probe_id) const = 0;
 
+    // An estimate of the relative cost of integrating cell gid, used for load
+    // balancing, or nothing if the recipe has no estimate.
+    virtual util::optional<double> cell_cost(cell_gid_type) const { return util::nothing; }
+
     // Global property type will be specific to given cell kind.
     virtual util::any get_global_properties(cell_kind) const { return util::any{}; };
+
+    // A rule for connections that are generated on demand, in addition to
+    // those given by connections_on, or nothing if there is none.
+    virtual connection_rule_ptr procedural_connections() const { return nullptr; }
+
+    // Bulk queries for the cells in a range of gids, used to set up a model.
+    // The default implementations make the per-gid queries above; recipes
+    // with many cells per domain can override them to avoid a virtual call
+    // and the allocation of a vector for each cell.
+
+    // The number of sources, targets and probes of gids[i] in counts[i].
+    virtual void num_sources_range(gid_range gids, std::vector<cell_size_type>& counts) const {
+        counts.clear();
+        for (auto gid: gids) counts.push_back(num_sources(gid));
+    }
+
+    virtual void num_targets_range(gid_range gids, std::vector<cell_size_type>& counts) const {
+        counts.clear();
+        for (auto gid: gids) counts.push_back(num_targets(gid));
+    }
+
+    virtual void num_probes_range(gid_range gids, std::vector<cell_size_type>& counts) const {
+        counts.clear();
+        for (auto gid: gids) counts.push_back(num_probes(gid));
+    }
+
+    // The connections on the cells in compressed sparse row form: the
+    // connections on gids[i] are conns[divisions[i]] to conns[divisions[i+1]-1].
+    virtual void connections_on_range(gid_range gids,
+        std::vector<cell_connection>& conns, std::vector<cell_size_type>& divisions) const
+    {
+        conns.clear();
+        divisions.assign(1, 0);
+        for (auto gid: gids) {
+            auto c = connections_on(gid);
+            conns.insert(conns.end(), c.begin(), c.end());
+            divisions.push_back(conns.size());
+        }
+    }
+
+    // The event generators of gids[i] in generators[i].
+    virtual void event_generators_range(gid_range gids,
+        std::vector<std::vector<event_generator_ptr>>& generators) const
+    {
+        generators.clear();
+        for (auto gid: gids) generators.push_back(event_generators(gid));
+    }
 };
 
 } // namespace arb
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <stdexcept>
+#include <string>
 #include <utility>
 
 #include <cell_group.hpp>
@@ -34,6 +37,10 @@ public:
         }
     }
 
+    bool initialize_steady_state(double, unsigned, time_type, time_type) override {
+        return true;
+    }
+
     void set_binning_policy(binning_kind policy, time_type bin_interval) override {}
 
     void advance(epoch ep, time_type dt, const event_lane_subrange& events) override {
@@ -60,6 +67,37 @@ public:
         spikes_.clear();
     }
 
+    void checkpoint(checkpoint_writer& w) const override {
+        w.write<std::uint64_t>(cells_.size());
+        for (const auto& cell: cells_) {
+            w.write<std::uint64_t>(cell.step);
+        }
+    }
+
+    void restore(checkpoint_reader& r) override {
+        clear_spikes();
+        if (r.read<std::uint64_t>()!=cells_.size()) {
+            throw checkpoint_error("number of rss cells does not match");
+        }
+        for (auto& cell: cells_) {
+            cell.step = r.read<std::uint64_t>();
+        }
+    }
+
+    void set_mechanism_parameter(cell_gid_type, segment_location,
+        const std::string& mech, const std::string&, double) override
+    {
+        throw std::invalid_argument("rss_cell has no mechanism "+mech);
+    }
+
+    void set_synapse_parameter(cell_member_type, const std::string&, double) override {
+        throw std::invalid_argument("rss_cell has no synapses");
+    }
+
+    void set_mechanism_global(const std::string& mech, const std::string&, double) override {
+        throw std::invalid_argument("rss_cell has no mechanism "+mech);
+    }
+
     void add_sampler(sampler_association_handle, cell_member_predicate, schedule, sampler_function, sampling_policy) override {
         std::logic_error("rss_cell does not support sampling");
     }
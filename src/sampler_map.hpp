@@ -5,14 +5,18 @@
  * cell group classes (see sampling_api doc).
  */
 
+#include <algorithm>
 #include <functional>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
+#include <checkpoint.hpp>
 #include <common_types.hpp>
 #include <sampling.hpp>
 #include <schedule.hpp>
 #include <util/deduce_return.hpp>
+#include <util/flat_map.hpp>
 #include <util/transform.hpp>
 
 namespace arb {
@@ -45,10 +49,43 @@ public:
         map_.clear();
     }
 
+    // Save the schedule of each association, in order of handle.
+    void checkpoint(checkpoint_writer& w) const {
+        std::lock_guard<std::mutex> lock(m_);
+        auto handles = sorted_handles();
+        w.write_sequence(handles);
+        for (auto h: handles) {
+            map_.at(h).sched.checkpoint(w);
+        }
+    }
+
+    // Restore the schedules saved by checkpoint, into associations with the
+    // same handles.
+    void restore(checkpoint_reader& r) {
+        std::lock_guard<std::mutex> lock(m_);
+        std::vector<sampler_association_handle> handles;
+        r.read_sequence(handles);
+        if (handles!=sorted_handles()) {
+            throw checkpoint_error("samplers do not match those of the checkpoint");
+        }
+        for (auto h: handles) {
+            map_.at(h).sched.restore(r);
+        }
+    }
+
 private:
     using assoc_map = std::unordered_map<sampler_association_handle, sampler_association>;
     assoc_map map_;
-    std::mutex m_;
+    mutable std::mutex m_;
+
+    std::vector<sampler_association_handle> sorted_handles() const {
+        std::vector<sampler_association_handle> handles;
+        for (const auto& p: map_) {
+            handles.push_back(p.first);
+        }
+        std::sort(handles.begin(), handles.end());
+        return handles;
+    }
 
     static sampler_association& second(assoc_map::value_type& p) { return p.second; }
     auto assoc_view() DEDUCED_RETURN_TYPE((util::transform_view(map_, &sampler_association_map::second)))
@@ -69,7 +106,8 @@ struct probe_association {
     probe_tag tag;
 };
 
+// Sorted by probe id, as the probes of a cell group are added in order.
 template <typename Handle>
-using probe_association_map = std::unordered_map<cell_member_type, probe_association<Handle>>;
+using probe_association_map = util::flat_map<cell_member_type, probe_association<Handle>>;
 
 } // namespace arb
@@ -12,12 +12,9 @@ namespace arb {
 
 // Regular schedule implementation.
 
-std::vector<time_type> regular_schedule_impl::events(time_type t0, time_type t1) {
-    std::vector<time_type> ts;
-
+void regular_schedule_impl::events(time_type t0, time_type t1, std::vector<time_type>& out) {
     t0 = t0<0? 0: t0;
     if (t1>t0) {
-        ts.reserve(1+std::size_t((t1-t0)*oodt_));
 
         long long n = t0*oodt_;
         time_type t = n*dt_;
@@ -27,22 +24,20 @@ std::vector<time_type> regular_schedule_impl::events(time_type t0, time_type t1)
         }
 
         while (t<t1) {
-            ts.push_back(t);
+            out.push_back(t);
             t = (++n)*dt_;
         }
     }
-
-    return ts;
 }
 
 // Explicit schedule implementation.
 
-std::vector<time_type> explicit_schedule_impl::events(time_type t0, time_type t1) {
+void explicit_schedule_impl::events(time_type t0, time_type t1, std::vector<time_type>& out) {
     auto lb = std::lower_bound(times_.begin()+start_index_, times_.end(), t0);
     auto ub = std::lower_bound(times_.begin()+start_index_, times_.end(), t1);
 
     start_index_ = std::distance(times_.begin(), ub);
-    return std::vector<time_type>(lb, ub);
+    out.insert(out.end(), lb, ub);
 }
 
 } // namespace arb
@@ -5,6 +5,7 @@
 #include <random>
 #include <vector>
 
+#include <checkpoint.hpp>
 #include <common_types.hpp>
 #include <util/compat.hpp>
 #include <util/debug.hpp>
@@ -18,6 +19,9 @@ namespace arb {
 // are queried monotonically in time: if two method calls `events(t0, t1)` 
 // and `events(t2, t3)` are made without an intervening call to `reset()`,
 // then 0 ≤ _t0_ ≤ _t1_ ≤ _t2_ ≤ _t3_.
+//
+// Schedule implementations provide `events(t0, t1, out)`, which appends
+// the times in [t0, t1) to the vector out.
 
 class schedule {
 public:
@@ -41,15 +45,29 @@ public:
     }
 
     std::vector<time_type> events(time_type t0, time_type t1) {
-        return impl_->events(t0, t1);
+        std::vector<time_type> ts;
+        impl_->events(t0, t1, ts);
+        return ts;
+    }
+
+    // Append the times in [t0, t1) to out, so that the same buffer can be
+    // reused over successive queries.
+    void events(time_type t0, time_type t1, std::vector<time_type>& out) {
+        impl_->events(t0, t1, out);
     }
 
     void reset() { impl_->reset(); }
 
+    // Save and restore the position of the schedule in its sequence.
+    void checkpoint(checkpoint_writer& w) const { impl_->checkpoint(w); }
+    void restore(checkpoint_reader& r) { impl_->restore(r); }
+
 private:
     struct interface {
-        virtual std::vector<time_type> events(time_type t0, time_type t1) = 0;
+        virtual void events(time_type t0, time_type t1, std::vector<time_type>& out) = 0;
         virtual void reset() = 0;
+        virtual void checkpoint(checkpoint_writer&) const = 0;
+        virtual void restore(checkpoint_reader&) = 0;
         virtual std::unique_ptr<interface> clone() = 0;
         virtual ~interface() {}
     };
@@ -61,14 +79,22 @@ private:
         explicit wrap(const Impl& impl): wrapped(impl) {}
         explicit wrap(Impl&& impl): wrapped(std::move(impl)) {}
 
-        virtual std::vector<time_type> events(time_type t0, time_type t1) {
-            return wrapped.events(t0, t1);
+        virtual void events(time_type t0, time_type t1, std::vector<time_type>& out) {
+            wrapped.events(t0, t1, out);
         }
 
         virtual void reset() {
             wrapped.reset();
         }
 
+        virtual void checkpoint(checkpoint_writer& w) const {
+            wrapped.checkpoint(w);
+        }
+
+        virtual void restore(checkpoint_reader& r) {
+            wrapped.restore(r);
+        }
+
         virtual std::unique_ptr<interface> clone() {
             return std::unique_ptr<interface>(new wrap<Impl>(wrapped));
         }
@@ -87,7 +113,10 @@ public:
         dt_(dt), oodt_(1./dt) {};
 
     void reset() {}
-    std::vector<time_type> events(time_type t0, time_type t1);
+
+    void checkpoint(checkpoint_writer&) const {}
+    void restore(checkpoint_reader&) {}
+    void events(time_type t0, time_type t1, std::vector<time_type>& out);
 
 private:
     time_type dt_;
@@ -113,7 +142,15 @@ public:
         start_index_ = 0;
     }
 
-    std::vector<time_type> events(time_type t0, time_type t1);
+    void checkpoint(checkpoint_writer& w) const {
+        w.write(start_index_);
+    }
+
+    void restore(checkpoint_reader& r) {
+        r.read(start_index_);
+    }
+
+    void events(time_type t0, time_type t1, std::vector<time_type>& out);
 
 private:
     std::ptrdiff_t start_index_;
@@ -143,19 +180,25 @@ public:
         step();
     }
 
-    std::vector<time_type> events(time_type t0, time_type t1) {
-        std::vector<time_type> ts;
+    void checkpoint(checkpoint_writer& w) const {
+        w.write_engine(rng_);
+        w.write(next_);
+    }
+
+    void restore(checkpoint_reader& r) {
+        r.read_engine(rng_);
+        r.read(next_);
+    }
 
+    void events(time_type t0, time_type t1, std::vector<time_type>& out) {
         while (next_<t0) {
             step();
         }
 
         while (next_<t1) {
-            ts.push_back(next_);
+            out.push_back(next_);
             step();
         }
-
-        return ts;
     }
 
 private:
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 
 #include <common_types.hpp>
@@ -13,24 +15,84 @@ namespace arb {
 /// This can be accessed directly using the get() method, which returns a reference to
 /// The thread private buffer of the calling thread.
 /// The insert() and gather() methods add a vector of spikes to the buffer,
-/// and collate all of the buffers into a single vector respectively.
+/// and collate all of the buffers into a single vector sorted by source respectively.
+/// Spikes with the same source are sorted by time.
 class thread_private_spike_store {
 public :
-    /// Collate all of the individual buffers into a single vector of spikes.
-    /// Does not modify the buffer contents.
-    std::vector<spike> gather() const {
+    /// Collate all of the individual buffers into a single vector of spikes,
+    /// sorted by source, and by time for each source.
+    std::vector<spike> gather() {
         std::vector<spike> spikes;
-        unsigned num_spikes = 0u;
-        for (auto& b : buffers_) {
-            num_spikes += b.size();
+        gather(spikes);
+        return spikes;
+    }
+
+    /// Collate all of the individual buffers into spikes, replacing its
+    /// contents, with the spikes sorted by source, and by time for each
+    /// source. The storage of spikes is reused, so that gathering into the
+    /// same vector on successive calls does not allocate once its high water
+    /// mark is reached.
+    ///
+    /// Each buffer is sorted in place, in parallel, and the sorted buffers are
+    /// combined with a parallel k-way merge: the output is divided into parts
+    /// by source, and the sub-ranges of the buffers that fall in each part are
+    /// merged independently into their place in the output.
+    void gather(std::vector<spike>& spikes) {
+        const auto num_buffers = buffers_.size();
+
+        threading::parallel_for::apply(0, num_buffers,
+            [&](std::size_t i) {
+                auto& b = buffers_.begin()[i];
+                std::sort(b.begin(), b.end(), spike_less);
+            });
+
+        // The largest buffer is used to choose the sources at which the
+        // output is divided into parts, one part per buffer.
+        std::size_t num_spikes = 0u;
+        std::size_t largest = 0u;
+        for (auto i=0u; i<num_buffers; ++i) {
+            const auto n = buffers_.begin()[i].size();
+            num_spikes += n;
+            if (n>buffers_.begin()[largest].size()) {
+                largest = i;
+            }
+        }
+        spikes.resize(num_spikes);
+        max_gathered_ = std::max(max_gathered_, num_spikes);
+        if (!num_spikes) {
+            return;
         }
-        spikes.reserve(num_spikes);
 
-        for (auto& b : buffers_) {
-            spikes.insert(spikes.begin(), b.begin(), b.end());
+        // cuts_[p*num_buffers+i] is the index of the first spike in buffer i
+        // that belongs to part p; part_begin_[p] is the index of the first
+        // spike of part p in the output.
+        const auto num_parts = num_buffers;
+        const auto& splitter = buffers_.begin()[largest];
+        cuts_.resize((num_parts+1)*num_buffers);
+        heads_.resize(num_parts*num_buffers);
+        part_begin_.resize(num_parts+1);
+        for (auto p=0u; p<=num_parts; ++p) {
+            std::size_t offset = 0u;
+            for (auto i=0u; i<num_buffers; ++i) {
+                const auto& b = buffers_.begin()[i];
+                std::size_t cut = b.size();
+                if (p==0) {
+                    cut = 0;
+                }
+                else if (p<num_parts) {
+                    const auto& s = splitter[p*splitter.size()/num_parts];
+                    cut = std::lower_bound(b.begin(), b.end(), s, spike_less)-b.begin();
+                }
+                cuts_[p*num_buffers+i] = cut;
+                offset += cut;
+            }
+            part_begin_[p] = offset;
         }
 
-        return spikes;
+        threading::parallel_for::apply(0, num_parts,
+            [&](std::size_t p) {
+                merge_part(p, spikes.data()+part_begin_[p]);
+            });
     }
 
     /// Return a reference to the thread private buffer of the calling thread
@@ -38,10 +100,14 @@ public :
         return buffers_.local();
     }
 
-    /// Clear all of the thread private buffers
+    /// Clear all of the thread private buffers.
+    /// Each buffer is given the capacity to hold the largest number of spikes
+    /// gathered so far, so that whether the buffers allocate does not depend
+    /// on how spikes are distributed over the threads.
     void clear() {
         for (auto& b : buffers_) {
             b.clear();
+            b.reserve(max_gathered_);
         }
     }
 
@@ -53,12 +119,55 @@ public :
     }
 
 private :
+    /// The order of the gathered spikes: by source, and by time for the same
+    /// source. The spikes of a source can be in any order in a buffer, and
+    /// std::sort is not stable, so the order by time has to be explicit.
+    static bool spike_less(const spike& a, const spike& b) {
+        return a.source<b.source || (a.source==b.source && a.time<b.time);
+    }
+
+    /// Merge the sub-ranges of the buffers in part p into out, by repeatedly
+    /// taking the least spike from the heads of the sub-ranges. The number of
+    /// buffers is the number of threads, which is small enough that a linear
+    /// scan of the heads is cheap.
+    void merge_part(std::size_t p, spike* out) {
+        const auto num_buffers = buffers_.size();
+        auto* head = heads_.data()+p*num_buffers;
+        const auto* last = cuts_.data()+(p+1)*num_buffers;
+        std::copy(last-num_buffers, last, head);
+
+        const auto n = part_begin_[p+1]-part_begin_[p];
+        for (std::size_t k=0; k<n; ++k) {
+            const spike* next = nullptr;
+            std::size_t from = 0;
+            for (auto i=0u; i<num_buffers; ++i) {
+                if (head[i]<last[i]) {
+                    const auto& s = buffers_.begin()[i][head[i]];
+                    if (!next || spike_less(s, *next)) {
+                        next = &s;
+                        from = i;
+                    }
+                }
+            }
+            out[k] = *next;
+            ++head[from];
+        }
+    }
+
     /// thread private storage for accumulating spikes
     using local_spike_store_type =
         threading::enumerable_thread_specific<std::vector<spike>>;
 
     local_spike_store_type buffers_;
 
+    /// scratch space for gather(), retained to avoid reallocation
+    std::vector<std::size_t> cuts_;
+    std::vector<std::size_t> heads_;
+    std::vector<std::size_t> part_begin_;
+
+    /// the largest number of spikes collated by gather()
+    std::size_t max_gathered_ = 0;
+
 public :
     using iterator = typename local_spike_store_type::iterator;
     using const_iterator = typename local_spike_store_type::const_iterator;
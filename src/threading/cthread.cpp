@@ -74,9 +74,12 @@ void task_pool::run_tasks_while(task_group* g) {
     run_tasks_loop([=] {return ! g->in_flight;});
 }
 
+thread_local task_pool* task_pool::current_pool_ = nullptr;
+thread_local std::size_t task_pool::current_index_ = 0;
+
 // Create pool and threads
 // new threads are nthreads-1
-task_pool::task_pool(std::size_t nthreads):
+task_pool::task_pool(std::size_t nthreads, std::function<void()> thread_init):
     tasks_mutex_{},
     tasks_available_{},
     tasks_{},
@@ -84,15 +87,16 @@ task_pool::task_pool(std::size_t nthreads):
 {
     assert(nthreads > 0);
 
-    // now for the main thread
-    auto tid = std::this_thread::get_id();
-    thread_ids_[tid] = 0;
-
-    // and go from there
     for (std::size_t i = 1; i < nthreads; i++) {
-        threads_.emplace_back([this]{run_tasks_forever();});
-        tid = threads_.back().get_id();
-        thread_ids_[tid] = i;
+        threads_.emplace_back(
+            [this, i, thread_init] {
+                current_pool_ = this;
+                current_index_ = i;
+                if (thread_init) {
+                    thread_init();
+                }
+                run_tasks_forever();
+            });
     }
 }
 
@@ -12,8 +12,6 @@
 #include <functional>
 #include <condition_variable>
 #include <utility>
-#include <unordered_map>
-#include <deque>
 
 #include <cstdlib>
 
@@ -24,6 +22,7 @@ namespace threading {
 
 // Forward declare task_group at bottom of this header
 class task_group;
+class pool_scope;
 using arb::threading::impl::timer;
 
 namespace impl {
@@ -34,11 +33,59 @@ using lock = std::unique_lock<mutex>;
 using std::condition_variable;
 
 using task = std::pair<std::function<void()>, task_group*>;
-using task_queue = std::deque<task>;
+
+// FIFO queue of tasks.
+// The tasks are stored in a vector that is reused once it has been drained,
+// so that once the high water mark has been reached queueing tasks does not
+// allocate.
+class task_queue {
+public:
+    bool empty() const {
+        return head_==tasks_.size();
+    }
+
+    task& front() {
+        return tasks_[head_];
+    }
+
+    void push_back(const task& tsk) {
+        tasks_.push_back(tsk);
+    }
+
+    void push_back(task&& tsk) {
+        tasks_.push_back(std::move(tsk));
+    }
+
+    void pop_front() {
+        tasks_[head_] = task{};
+        ++head_;
+        if (head_==tasks_.size()) {
+            tasks_.clear();
+            head_ = 0;
+        }
+        else if (head_>=compact_size && 2*head_>=tasks_.size()) {
+            // Reclaim the space of popped tasks if the queue never drains.
+            tasks_.erase(tasks_.begin(), tasks_.begin()+head_);
+            head_ = 0;
+        }
+    }
+
+private:
+    static constexpr std::size_t compact_size = 1024;
+
+    std::vector<task> tasks_;
+    std::size_t head_ = 0;
+};
 
 using thread_list = std::vector<std::thread>;
-using thread_map = std::unordered_map<std::thread::id, std::size_t>;
 
+// A pool of threads that run tasks.
+//
+// The process-wide pool, with threading::num_threads() threads, is used
+// unless another pool has been made current on the calling thread with a
+// pool_scope: task_groups and enumerable_thread_specific objects use the
+// pool that is current when they are constructed. The worker threads of a
+// pool have it as their current pool.
 class task_pool {
 private:
     // lock and signal on task availability change
@@ -51,8 +98,6 @@ private:
 
     // thread resource
     thread_list threads_;
-    // threads -> index
-    thread_map thread_ids_;
     // flag to handle exit from all threads
     bool quit_ = false;
 
@@ -75,19 +120,19 @@ private:
     template<typename B>
     void run_tasks_loop(B finished );
 
-    // Create nthreads-1 new c std threads
-    // must be > 0
-    // singled only created in static get_global_task_pool()
-    task_pool(std::size_t nthreads);
+public:
+    // Create nthreads-1 new c std threads, which call thread_init before
+    // they run any task; the thread that waits on a task_group is the
+    // remaining thread.
+    // nthreads must be > 0
+    explicit task_pool(std::size_t nthreads, std::function<void()> thread_init = {});
 
-    // task_pool is a singleton 
     task_pool(const task_pool&) = delete;
     task_pool& operator=(const task_pool&) = delete;
 
     // set quit and wait for secondary threads to end
     ~task_pool();
 
-public:
     // Like tbb calls: run queues a task,
     // wait waits for all tasks in the group to be done
     void run(const task&);
@@ -95,22 +140,71 @@ public:
     void wait(task_group*);
 
     // includes master thread
-    int get_num_threads() {
+    int get_num_threads() const {
         return threads_.size() + 1;
     }
 
     // get a stable integer for the current thread that
-    // is 0..nthreads
-    std::size_t get_current_thread() {
-        return thread_ids_[std::this_thread::get_id()];
+    // is 0..nthreads: the index of a worker thread of this pool, or 0 for
+    // any other thread.
+    std::size_t get_current_thread() const {
+        return current_pool_==this? current_index_: 0;
     }
 
     // singleton constructor - needed to order construction
     // with other singletons (profiler)
     static task_pool& get_global_task_pool();
+
+    // The current pool of the calling thread.
+    static task_pool& current() {
+        return current_pool_? *current_pool_: get_global_task_pool();
+    }
+
+private:
+    friend class arb::threading::pool_scope;
+
+    static thread_local task_pool* current_pool_;
+    static thread_local std::size_t current_index_;
 };
 } //impl
 
+using task_pool = impl::task_pool;
+
+// Make pool the current pool of the calling thread for the lifetime of the
+// pool_scope. The calling thread takes the index 0 in the pool.
+class pool_scope {
+public:
+    explicit pool_scope(task_pool& pool):
+        pool_(task_pool::current_pool_),
+        index_(task_pool::current_index_)
+    {
+        task_pool::current_pool_ = &pool;
+        task_pool::current_index_ = 0;
+    }
+
+    pool_scope(const pool_scope&) = delete;
+    pool_scope& operator=(const pool_scope&) = delete;
+
+    ~pool_scope() {
+        task_pool::current_pool_ = pool_;
+        task_pool::current_index_ = index_;
+    }
+
+private:
+    task_pool* pool_;
+    std::size_t index_;
+};
+
+// The number of threads of the current pool, and the index of the calling
+// thread in it.
+inline std::size_t current_num_threads() {
+    return task_pool::current().get_num_threads();
+}
+
+inline std::size_t current_thread_index() {
+    return task_pool::current().get_current_thread();
+}
+
 ///////////////////////////////////////////////////////////////////////
 // types
 ///////////////////////////////////////////////////////////////////////
@@ -126,12 +220,12 @@ public :
     using const_iterator = typename storage_class::const_iterator;
 
     enumerable_thread_specific():
-        global_task_pool{impl::task_pool::get_global_task_pool()},
+        global_task_pool{impl::task_pool::current()},
         data{std::vector<T>(global_task_pool.get_num_threads())}
     {}
 
     enumerable_thread_specific(const T& init):
-        global_task_pool{impl::task_pool::get_global_task_pool()},
+        global_task_pool{impl::task_pool::current()},
         data{std::vector<T>(global_task_pool.get_num_threads(), init)}
     {}
 
@@ -208,7 +302,7 @@ private:
 
 public:
     task_group():
-        global_task_pool{impl::task_pool::get_global_task_pool()}
+        global_task_pool{impl::task_pool::current()}
     {}
 
     task_group(const task_group&) = delete;
@@ -255,9 +349,12 @@ public:
 struct parallel_for {
     template <typename F>
     static void apply(int left, int right, F f) {
+        // The tasks refer to f by pointer, so that each task closure is small
+        // enough to be stored in the task without a heap allocation.
+        F* fp = &f;
         task_group g;
         for(int i = left; i < right; ++i) {
-          g.run([=] {f(i);});
+          g.run([fp, i] {(*fp)(i);});
         }
         g.wait();
     }
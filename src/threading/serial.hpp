@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstddef>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -20,6 +22,35 @@ using arb::threading::impl::timer;
 ///////////////////////////////////////////////////////////////////////
 // types
 ///////////////////////////////////////////////////////////////////////
+
+// The serial back end runs all tasks on the calling thread: pools have a
+// single thread, and need no threads of their own.
+class task_pool {
+public:
+    explicit task_pool(std::size_t, std::function<void()> = {}) {}
+
+    task_pool(const task_pool&) = delete;
+    task_pool& operator=(const task_pool&) = delete;
+
+    int get_num_threads() const { return 1; }
+
+    static task_pool& get_global_task_pool() {
+        static task_pool pool(num_threads());
+        return pool;
+    }
+};
+
+class pool_scope {
+public:
+    explicit pool_scope(task_pool&) {}
+
+    pool_scope(const pool_scope&) = delete;
+    pool_scope& operator=(const pool_scope&) = delete;
+};
+
+inline std::size_t current_num_threads() { return 1; }
+inline std::size_t current_thread_index() { return 0; }
+
 template <typename T>
 class enumerable_thread_specific {
     std::array<T, 1> data;
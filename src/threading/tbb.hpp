@@ -4,6 +4,8 @@
     #error this header can only be loaded if ARB_HAVE_TBB is set
 #endif
 
+#include <cstddef>
+#include <functional>
 #include <string>
 
 #include <tbb/tbb.h>
@@ -17,6 +19,46 @@ namespace threading {
 template <typename T>
 using enumerable_thread_specific = tbb::enumerable_thread_specific<T>;
 
+// TBB schedules the tasks of all pools over its own threads: a pool records
+// the number of threads over which its work is divided, and the thread_init
+// function is not used.
+class task_pool {
+public:
+    explicit task_pool(std::size_t nthreads, std::function<void()> = {}):
+        num_threads_(nthreads)
+    {}
+
+    task_pool(const task_pool&) = delete;
+    task_pool& operator=(const task_pool&) = delete;
+
+    int get_num_threads() const { return num_threads_; }
+
+    static task_pool& get_global_task_pool() {
+        static task_pool pool(num_threads());
+        return pool;
+    }
+
+private:
+    int num_threads_;
+};
+
+class pool_scope {
+public:
+    explicit pool_scope(task_pool&) {}
+
+    pool_scope(const pool_scope&) = delete;
+    pool_scope& operator=(const pool_scope&) = delete;
+};
+
+inline std::size_t current_num_threads() {
+    return num_threads();
+}
+
+inline std::size_t current_thread_index() {
+    auto i = tbb::this_task_arena::current_thread_index();
+    return i<0? 0: i;
+}
+
 struct parallel_for {
     template <typename F>
     static void apply(int left, int right, F f) {
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <util/allocation_counter.hpp>
+
+#ifdef ARB_HAVE_ALLOCATION_COUNTER
+
+namespace {
+    std::atomic<std::size_t> num_allocations(0);
+
+    void* counted_malloc(std::size_t n) {
+        num_allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(n? n: 1);
+    }
+}
+
+void* operator new(std::size_t n) {
+    if (void* p = counted_malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t n) {
+    return operator new(n);
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    return counted_malloc(n);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    return counted_malloc(n);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+namespace arb {
+namespace util {
+
+std::size_t allocation_count() {
+    return num_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace util
+} // namespace arb
+
+#else
+
+namespace arb {
+namespace util {
+
+std::size_t allocation_count() {
+    return 0;
+}
+
+} // namespace util
+} // namespace arb
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+namespace arb {
+namespace util {
+
+// Debug counter of heap allocations.
+//
+// When built with ARB_WITH_ALLOCATION_COUNTER, the global operator new is
+// replaced by one that counts every allocation made by any thread, so that
+// code paths that are expected not to allocate can be checked.
+
+// The total number of heap allocations made so far.
+// Always returns 0 if allocations are not counted (see config.hpp).
+std::size_t allocation_count();
+
+} // namespace util
+} // namespace arb
@@ -16,6 +16,11 @@ namespace config {
 //
 // has_cuda
 //     Has been compiled with CUDA back end support
+//
+// has_allocation_counter
+//     Heap allocations are counted, for debugging and testing.
+//     * true:  calls to util::allocation_count() will return valid results
+//     * false: calls to util::allocation_count() will return 0
 
 #ifdef __linux__
 constexpr bool has_memory_measurement = true;
@@ -35,5 +40,11 @@ constexpr bool has_cuda = true;
 constexpr bool has_cuda = false;
 #endif
 
+#ifdef ARB_HAVE_ALLOCATION_COUNTER
+constexpr bool has_allocation_counter = true;
+#else
+constexpr bool has_allocation_counter = false;
+#endif
+
 } // namespace config
 } // namespace arb
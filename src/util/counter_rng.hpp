@@ -0,0 +1,35 @@
+#pragma once
+
+// Counter-based random number generation: each value is a pure function of
+// a key and a counter, so that any stream can be regenerated on demand, in
+// any order, on any thread or domain, without storing generator state.
+
+#include <cstdint>
+
+namespace arb {
+namespace util {
+
+// The SplitMix64 finalizer: a bijective mixing of the bits of x.
+inline std::uint64_t mix64(std::uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// The value of the counter-th element of the stream identified by key.
+inline std::uint64_t counter_random(std::uint64_t key, std::uint64_t counter) {
+    return mix64(mix64(key) + (counter+1)*0x9e3779b97f4a7c15ull);
+}
+
+// A key for the stream identified by a pair of values, e.g. a seed and a gid.
+inline std::uint64_t counter_key(std::uint64_t a, std::uint64_t b) {
+    return mix64(a ^ mix64(b + 0x632be59bd9b4e019ull));
+}
+
+// A uniformly distributed value in (0, 1], from the 53 high bits of x.
+inline double counter_uniform(std::uint64_t x) {
+    return ((x >> 11) + 1) * (1.0/9007199254740992.0);
+}
+
+} // namespace util
+} // namespace arb
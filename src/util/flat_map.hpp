@@ -0,0 +1,105 @@
+#pragma once
+
+/*
+ * An associative container that stores its entries in a vector sorted by key.
+ *
+ * Lookup is a binary search over contiguous memory, which is faster than a
+ * hash table for the small maps that are built once and then only read, such
+ * as the probes of a cell group. Insertion in increasing key order appends;
+ * otherwise it shifts the following entries, and is linear in the size.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace arb {
+namespace util {
+
+template <typename Key, typename Value>
+class flat_map {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using size_type = std::size_t;
+
+    flat_map() = default;
+
+    // The entries are only iterated in order of key, and can not be
+    // modified, so that the keys stay sorted.
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+
+    size_type size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    void reserve(size_type n) { entries_.reserve(n); }
+    void clear() { entries_.clear(); }
+
+    // As for std::map: if key is already present, its value is left as it
+    // is, and the iterator to it is returned with false.
+    std::pair<const_iterator, bool> insert(value_type entry) {
+        if (entries_.empty() || entries_.back().first<entry.first) {
+            entries_.push_back(std::move(entry));
+            return {entries_.end()-1, true};
+        }
+
+        auto it = lower_bound(entry.first);
+        if (it!=entries_.end() && !(entry.first<it->first)) {
+            return {it, false};
+        }
+        return {entries_.insert(it, std::move(entry)), true};
+    }
+
+    const_iterator find(const Key& key) const {
+        auto it = lower_bound(key);
+        return it!=entries_.end() && !(key<it->first)? it: entries_.end();
+    }
+
+    size_type count(const Key& key) const {
+        return find(key)!=end();
+    }
+
+    Value& at(const Key& key) {
+        auto it = lower_bound(key);
+        if (it==entries_.end() || key<it->first) {
+            throw std::out_of_range("flat_map::at: no such key");
+        }
+        return it->second;
+    }
+
+    const Value& at(const Key& key) const {
+        auto it = find(key);
+        if (it==end()) {
+            throw std::out_of_range("flat_map::at: no such key");
+        }
+        return it->second;
+    }
+
+    Value& operator[](const Key& key) {
+        auto it = lower_bound(key);
+        if (it==entries_.end() || key<it->first) {
+            it = entries_.insert(it, value_type(key, Value()));
+        }
+        return it->second;
+    }
+
+private:
+    std::vector<value_type> entries_;
+
+    iterator lower_bound(const Key& key) {
+        return std::lower_bound(entries_.begin(), entries_.end(), key,
+            [](const value_type& e, const Key& k) { return e.first<k; });
+    }
+
+    const_iterator lower_bound(const Key& key) const {
+        return std::lower_bound(entries_.begin(), entries_.end(), key,
+            [](const value_type& e, const Key& k) { return e.first<k; });
+    }
+};
+
+} // namespace util
+} // namespace arb
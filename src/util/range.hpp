@@ -63,6 +63,20 @@ struct range {
         left(std::forward<U1>(l)), right(std::forward<U2>(r))
     {}
 
+    // Conversion from a range with convertible iterator and sentinel types,
+    // e.g. from a range over T* to a range over const T*.
+    template <
+        typename U1,
+        typename S1,
+        typename = enable_if_t<
+            !std::is_same<range<U1, S1>, range>::value &&
+            std::is_convertible<U1, iterator>::value &&
+            std::is_convertible<S1, sentinel>::value>
+    >
+    range(const range<U1, S1>& r):
+        left(r.left), right(r.right)
+    {}
+
     range& operator=(const range&) = default;
     range& operator=(range&&) = default;
 
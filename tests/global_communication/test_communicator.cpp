@@ -1,16 +1,25 @@
 #include "../gtest.h"
 
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
 #include <communication/communicator.hpp>
 #include <communication/global_policy.hpp>
+#include <execution_context.hpp>
 #include <hardware/node_info.hpp>
 #include <load_balance.hpp>
+#include <model.hpp>
+#include <profiling/meter_manager.hpp>
 #include <util/filter.hpp>
 #include <util/rangeutil.hpp>
 #include <util/span.hpp>
 
+#include "../common_cells.hpp"
+#include "../simple_recipes.hpp"
+
 using namespace arb;
 
 using communicator_type = communication::communicator<communication::global_policy>;
@@ -175,6 +184,78 @@ TEST(communicator, gather_spikes_variant) {
     }
 }
 
+// Gathering spikes in the compressed wire format gives the same partition and
+// spikes as gathering them verbatim, with times rounded to the quantum.
+TEST(communicator, gather_compressed_spikes) {
+    // This test does not apply if in dry run mode, for which the number of
+    // spikes per domain must be equal.
+    if (is_dry_run()) return;
+
+    using policy = communication::global_policy;
+    const auto rank = policy::id();
+
+    // Rank r has 3*r spikes, from sources spread over the gids.
+    std::vector<spike> local_spikes;
+    for (auto i=0; i<3*rank; ++i) {
+        local_spikes.push_back(spike({cell_gid_type(1000*rank+7*i), cell_lid_type(i%2)}, 10+0.1234567*i));
+    }
+
+    const auto expected = policy::gather_spikes(local_spikes);
+
+    for (double quantum: {0., 1e-3}) {
+        gathered_vector<spike> global_spikes;
+        policy::gather_compressed_spikes(local_spikes, global_spikes, quantum);
+
+        EXPECT_EQ(expected.partition(), global_spikes.partition());
+        ASSERT_EQ(expected.size(), global_spikes.size());
+        for (auto i=0u; i<expected.size(); ++i) {
+            const auto& e = expected.values()[i];
+            const auto& s = global_spikes.values()[i];
+            EXPECT_EQ(e.source, s.source);
+            if (quantum==0) {
+                EXPECT_EQ(e.time, s.time);
+            }
+            else {
+                EXPECT_NEAR(e.time, s.time, 0.51*quantum);
+            }
+        }
+    }
+}
+
+#ifdef ARB_HAVE_DRYRUN
+// The dry run policy accumulates the time predicted by its network model for
+// each exchange of spikes: the counts, then the spikes of every rank.
+TEST(communicator, dry_run_network_model) {
+    using policy = communication::global_policy;
+    using communication::loggp_model;
+
+    auto model = std::make_shared<loggp_model>();
+    policy::set_network_model(model);
+
+    std::vector<spike> local_spikes(7);
+    const auto t0 = policy::predicted_network_time();
+    policy::gather_spikes(local_spikes);
+    const auto t1 = policy::predicted_network_time();
+    policy::gather_spikes(local_spikes);
+    const auto t2 = policy::predicted_network_time();
+
+    const auto expected =
+        model->allgather(policy::size(), sizeof(int))+
+        model->allgather(policy::size(), 7*sizeof(spike));
+    EXPECT_DOUBLE_EQ(expected, t1-t0);
+    EXPECT_DOUBLE_EQ(expected, t2-t1);
+
+    policy::min(1);
+    EXPECT_DOUBLE_EQ(model->allreduce(policy::size(), sizeof(int)), policy::predicted_network_time()-t2);
+
+    // No predictions without a model.
+    policy::set_network_model(nullptr);
+    const auto t3 = policy::predicted_network_time();
+    policy::gather_spikes(local_spikes);
+    EXPECT_EQ(t3, policy::predicted_network_time());
+}
+#endif
+
 namespace {
     // Population of cable and rss cells with ring connection topology.
     // Even gid are rss, and odd gid are cable cells.
@@ -355,7 +436,8 @@ test_ring(const domain_decomposition& D, comm_type& C, F&& f) {
     }
 
     // generate the events
-    auto queues = C.make_event_queues(global_spikes);
+    event_lanes queues;
+    C.make_event_queues(global_spikes, queues);
     if (queues.size() != D.groups.size()) { // one queue for each cell group
         return ::testing::AssertionFailure()
             << "expect one event queue for each cell group";
@@ -371,7 +453,7 @@ test_ring(const domain_decomposition& D, comm_type& C, F&& f) {
         if (f(src)) {
             auto expected = expected_event_ring(gid, D.num_global_cells);
             auto grp = group_map[gid];
-            auto& q = queues[grp];
+            auto q = queues[grp];
             if (std::find(q.begin(), q.end(), expected)==q.end()) {
                 return ::testing::AssertionFailure()
                     << "expected event " << expected << " was not found";
@@ -383,8 +465,7 @@ test_ring(const domain_decomposition& D, comm_type& C, F&& f) {
     // Assert that only the expected events were produced. The preceding test
     // showed that all expected events were generated, so this only requires
     // that the number of generated events is as expected.
-    int num_events = std::accumulate(queues.begin(), queues.end(), 0,
-            [](int l, decltype(queues.front())& r){return l + r.size();});
+    int num_events = queues.num_events();
 
     if (expected_count!=num_events) {
         return ::testing::AssertionFailure() <<
@@ -421,6 +502,102 @@ TEST(communicator, ring)
     EXPECT_TRUE(test_ring(D, C, [n_local](cell_gid_type g){return g%2==1;}));
 }
 
+// The source filter of each domain holds the sources of the ring connections
+// onto its cells, and rejects the spikes of the other sources.
+TEST(communicator, source_filter)
+{
+    // This test does not apply in dry run mode, in which the spikes of the
+    // other domains are copies of the spikes of this domain.
+    if (is_dry_run()) return;
+
+    unsigned N = policy::size();
+    unsigned n_local = 10u;
+    unsigned n_global = n_local*N;
+
+    auto R = ring_recipe(n_global);
+    const auto D = partition_load_balance(R, hw::node_info());
+    auto C = communication::communicator<policy>(R, D);
+
+    std::vector<bool> is_source(n_global);
+    for (const auto& c: C.connections()) {
+        is_source[c.source().gid] = true;
+    }
+    for (cell_gid_type gid = 0; gid<n_global; ++gid) {
+        EXPECT_EQ(is_source[gid], C.filter().may_contain(gid));
+    }
+    EXPECT_FALSE(C.filter().may_contain(n_global));
+
+    // When only the last cell in each domain fires, the one spike from each
+    // domain is tested against the filter if there are connections from that
+    // domain: the spike from the previous domain is a hit, while the spike
+    // from this domain, which has no local targets on more than one domain,
+    // is a miss.
+    EXPECT_TRUE(test_ring(D, C, [n_local](cell_gid_type g){return (g+1)%n_local == 0u;}));
+    EXPECT_EQ(1u, C.filter_stats().hits);
+    EXPECT_EQ(N>1? 1u: 0u, C.filter_stats().misses);
+
+    C.reset();
+    EXPECT_EQ(0u, C.filter_stats().hits);
+    EXPECT_EQ(0u, C.filter_stats().misses);
+}
+
+// With local delivery, the events of the ring connections within a domain
+// are made by make_local_events, and those of the connections from other
+// domains by make_event_queues.
+TEST(communicator, local_delivery)
+{
+    // This test does not apply in dry run mode, in which the spikes of the
+    // other domains are copies of the spikes of this domain.
+    if (is_dry_run()) return;
+
+    unsigned N = policy::size();
+    unsigned n_local = 10u;
+    unsigned n_global = n_local*N;
+
+    auto R = ring_recipe(n_global);
+    const auto D = partition_load_balance(R, hw::node_info());
+    auto C = communication::communicator<policy>(R, D);
+
+    // All connections have a delay of 1 ms; there are none between domains
+    // on a single domain.
+    EXPECT_EQ(1.f, C.min_local_delay());
+    EXPECT_EQ(N>1? 1.f: std::numeric_limits<time_type>::max(), C.min_remote_delay());
+
+    auto gids = get_gids(D);
+    std::vector<spike> local_spikes = util::assign_from(util::transform_view(gids, make_spike));
+    auto global_spikes = C.exchange(local_spikes);
+
+    C.set_local_delivery(true);
+    event_lanes queues;
+    C.make_event_queues(global_spikes, queues);
+
+    std::vector<event_lanes::staged_event> local_events;
+    C.make_local_events(local_spikes, local_events);
+
+    // Every local cell receives one event from its source in the ring,
+    // from one of the two.
+    auto local_index = [&](cell_gid_type gid) {
+        return std::find(gids.begin(), gids.end(), gid)-gids.begin();
+    };
+    std::vector<unsigned> count(gids.size());
+    for (auto i: util::make_span(0, queues.size())) {
+        for (auto& e: queues[i]) {
+            EXPECT_EQ(expected_event_ring(gids[i], n_global), e);
+            EXPECT_FALSE(std::count(gids.begin(), gids.end(), source_of(gids[i], n_global)));
+            ++count[i];
+        }
+    }
+    for (auto& s: local_events) {
+        EXPECT_EQ(expected_event_ring(gids[s.first], n_global), s.second);
+        EXPECT_EQ(std::ptrdiff_t(s.first), local_index(s.second.target.gid));
+        ++count[s.first];
+    }
+    for (auto c: count) {
+        EXPECT_EQ(1u, c);
+    }
+    EXPECT_EQ(N>1? n_local-1: n_local, local_events.size());
+}
+
 template <typename F>
 ::testing::AssertionResult
 test_all2all(const domain_decomposition& D, comm_type& C, F&& f) {
@@ -449,7 +626,8 @@ test_all2all(const domain_decomposition& D, comm_type& C, F&& f) {
     }
 
     // generate the events
-    auto queues = C.make_event_queues(global_spikes);
+    event_lanes queues;
+    C.make_event_queues(global_spikes, queues);
     if (queues.size() != D.groups.size()) { // one queue for each cell group
         return ::testing::AssertionFailure()
             << "expect one event queue for each cell group";
@@ -462,7 +640,7 @@ test_all2all(const domain_decomposition& D, comm_type& C, F&& f) {
     int expected_count = 0;
     for (auto gid: gids) {
         // get the event queue that this gid belongs to
-        auto& q = queues[group_map[gid]];
+        auto q = queues[group_map[gid]];
         for (auto src: spike_gids) {
             auto expected = expected_event_all2all(gid, src);
             if (std::find(q.begin(), q.end(), expected)==q.end()) {
@@ -477,8 +655,7 @@ test_all2all(const domain_decomposition& D, comm_type& C, F&& f) {
     // Assert that only the expected events were produced. The preceding test
     // showed that all expected events were generated, so this only requires
     // that the number of generated events is as expected.
-    int num_events = std::accumulate(queues.begin(), queues.end(), 0,
-            [](int l, decltype(queues.front())& r){return l + r.size();});
+    int num_events = queues.num_events();
 
     if (expected_count!=num_events) {
         return ::testing::AssertionFailure() <<
@@ -514,3 +691,50 @@ TEST(communicator, all2all)
     // odd-numbered cells fire
     EXPECT_TRUE(test_all2all(D, C, [n_local](cell_gid_type g){return g%2==1;}));
 }
+
+// The connections are gathered in parallel: the communicator must be the
+// same whatever the number of threads.
+TEST(communicator, parallel_setup)
+{
+    unsigned n_global = 10u*policy::size();
+
+    auto R = all2all_recipe(n_global);
+    const auto D = partition_load_balance(R, hw::node_info());
+
+    auto make = [&](unsigned num_threads) {
+        auto ctx = make_local_context(num_threads);
+        execution_scope scope(ctx);
+        return communication::communicator<policy>(R, D);
+    };
+
+    auto C1 = make(1);
+    auto C4 = make(4);
+
+    ASSERT_EQ(C1.num_local_cells(), C4.num_local_cells());
+    const auto& c1 = C1.connections();
+    const auto& c4 = C4.connections();
+    ASSERT_EQ(c1.size(), c4.size());
+    for (auto i: util::make_span(0, c1.size())) {
+        EXPECT_EQ(c1[i].source(), c4[i].source());
+        EXPECT_EQ(c1[i].destination(), c4[i].destination());
+        EXPECT_EQ(c1[i].weight(), c4[i].weight());
+        EXPECT_EQ(c1[i].delay(), c4[i].delay());
+        EXPECT_EQ(c1[i].index_on_domain(), c4[i].index_on_domain());
+    }
+}
+
+// The setup of a model on a local context synchronizes only the domain of the
+// model at its meter checkpoints, so that one domain can build a model alone.
+TEST(communicator, local_model_meters)
+{
+    util::meter_manager meters;
+    meters.start();
+
+    if (policy::id()==0) {
+        auto ctx = make_local_context(1);
+        auto R = cable1d_recipe(make_cell_soma_only());
+        model m(R, partition_load_balance(R, hw::node_info(), ctx.distributed), ctx, &meters);
+    }
+
+    EXPECT_EQ(policy::id()==0? 2u: 0u, meters.checkpoint_names().size());
+}
@@ -65,6 +65,46 @@ namespace {
     private:
         cell_size_type size_;
     };
+
+    // Heterogeneous population with a recipe provided cost for each cell,
+    // where the cost grows with gid.
+    class costed_recipe: public hetero_recipe {
+    public:
+        costed_recipe(cell_size_type s): hetero_recipe(s) {}
+
+        util::optional<double> cell_cost(cell_gid_type gid) const override {
+            return 1.+gid%16+gid/8;
+        }
+    };
+
+    // Heterogeneous population of interleaved clusters: cell gid is in
+    // cluster gid%num_clusters, and is the target of connections from the
+    // next few cells in its cluster.
+    class clustered_recipe: public hetero_recipe {
+    public:
+        clustered_recipe(cell_size_type s, unsigned num_clusters):
+            hetero_recipe(s), size_(s), num_clusters_(num_clusters)
+        {}
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            std::vector<cell_connection> conns;
+            for (unsigned k=1; k<=4; ++k) {
+                cell_gid_type src = (gid+k*num_clusters_)%size_;
+                conns.push_back(cell_connection({src, 0}, {gid, 0}, 0.f, 1.f));
+            }
+            return conns;
+        }
+
+        // All cells have the same cost, so that the partition depends only
+        // on the connectivity, whatever the kinds of the cells in a cluster.
+        util::optional<double> cell_cost(cell_gid_type) const override {
+            return 1.;
+        }
+
+    private:
+        cell_size_type size_;
+        unsigned num_clusters_;
+    };
 }
 
 TEST(domain_decomposition, homogeneous_population) {
@@ -194,3 +234,101 @@ TEST(domain_decomposition, heterogeneous_population) {
     }
 }
 
+
+TEST(domain_decomposition, cost_load_balance) {
+    const auto N = communication::global_policy::size();
+    const auto I = communication::global_policy::id();
+
+    hw::node_info nd(1, 0);
+
+    unsigned n_global = 50*N;
+    auto R = costed_recipe(n_global);
+    const auto D = cost_load_balance(R, nd);
+
+    EXPECT_EQ(D.num_global_cells, n_global);
+    EXPECT_EQ(D.num_domains, int(N));
+    EXPECT_EQ(D.domain_id, int(I));
+
+    // The local cells are exactly those for which gid_domain is the local
+    // domain, and the cost of the local cells is within the cost of the
+    // most expensive cell of an even share of the total cost.
+    double local_cost = 0;
+    double total_cost = 0;
+    double max_cost = 0;
+    unsigned n_local = 0;
+    for (auto gid: util::make_span(0, n_global)) {
+        auto c = *R.cell_cost(gid);
+        total_cost += c;
+        max_cost = std::max(max_cost, c);
+        if (D.is_local_gid(gid)) {
+            local_cost += c;
+            ++n_local;
+        }
+    }
+    EXPECT_EQ(D.num_local_cells, n_local);
+    EXPECT_NEAR(total_cost/N, local_cost, max_cost);
+
+    unsigned n_grouped = 0;
+    for (auto& grp: D.groups) {
+        for (auto gid: grp.gids) {
+            EXPECT_TRUE(D.is_local_gid(gid));
+            ++n_grouped;
+        }
+    }
+    EXPECT_EQ(n_local, n_grouped);
+
+    // Dry run domains replicate the cells of the first domain, whose share of
+    // the cells is uneven.
+    if (communication::global_policy::kind()!=communication::global_policy_kind::dryrun) {
+        EXPECT_EQ(int(n_global), communication::global_policy::sum(int(n_local)));
+    }
+}
+
+TEST(domain_decomposition, graph_load_balance) {
+    const auto N = communication::global_policy::size();
+    const auto I = communication::global_policy::id();
+
+    hw::node_info nd(1, 0);
+
+    // One cluster of 20 cells per domain, interleaved by gid, so that
+    // dividing the cells into contiguous ranges of gids cuts almost every
+    // connection, while each cluster can be placed on its own domain.
+    unsigned n_global = 20*N;
+    auto R = clustered_recipe(n_global, N);
+    const auto D = graph_load_balance(R, nd);
+
+    EXPECT_EQ(D.num_global_cells, n_global);
+    EXPECT_EQ(D.num_domains, int(N));
+    EXPECT_EQ(D.domain_id, int(I));
+
+    unsigned n_local = 0;
+    for (auto gid: util::make_span(0, n_global)) {
+        if (D.is_local_gid(gid)) {
+            EXPECT_EQ(int(I), D.gid_domain(gid));
+            ++n_local;
+        }
+        else {
+            EXPECT_NE(int(I), D.gid_domain(gid));
+        }
+    }
+    EXPECT_EQ(D.num_local_cells, n_local);
+    EXPECT_EQ(20u, n_local);
+
+    unsigned n_grouped = 0;
+    for (auto& grp: D.groups) {
+        for (auto gid: grp.gids) {
+            EXPECT_TRUE(D.is_local_gid(gid));
+            ++n_grouped;
+        }
+    }
+    EXPECT_EQ(n_local, n_grouped);
+
+    // Every domain computes the same report.
+    auto report = make_decomposition_report(R, D);
+    EXPECT_EQ(4u*n_global, report.num_connections);
+    EXPECT_EQ(0u, report.cut_connections);
+    EXPECT_EQ(std::size_t(N), report.domain_cells.size());
+
+    auto contiguous = make_decomposition_report(R, partition_load_balance(R, nd));
+    EXPECT_LE(report.cut_connections, contiguous.cut_connections);
+}
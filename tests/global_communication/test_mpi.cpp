@@ -97,6 +97,84 @@ TEST(mpi, gather_all_with_partition) {
     EXPECT_EQ(expected_divisions, gathered.partition());
 }
 
+// Gathers with node-local aggregation give the same values and partition as
+// the flat gather, for nodes of two ranks, for the ranks that share memory,
+// and when gathers are repeated with different amounts of data.
+TEST(mpi, node_gather_all_with_partition) {
+    int id = mpi::rank();
+    int size = mpi::size();
+
+    for (int ranks_per_node: {2, 0}) {
+        mpi::set_ranks_per_node(ranks_per_node);
+        if (ranks_per_node==2) {
+            EXPECT_EQ((size+1)/2, mpi::num_nodes());
+            EXPECT_EQ(size>1, mpi::node_aggregation());
+        }
+
+        gathered_vector<big_thing> expected;
+        gathered_vector<big_thing> gathered;
+        for (int round: {0, 1, 2}) {
+            std::vector<big_thing> data;
+            for (int i=0; i<(id+round)%4; ++i) {
+                data.push_back(100*id+10*round+i);
+            }
+
+            mpi::gather_all_with_partition(data, expected);
+            mpi::node_gather_all_with_partition(data, gathered);
+
+            EXPECT_EQ(expected.values(), gathered.values());
+            EXPECT_EQ(expected.partition(), gathered.partition());
+        }
+    }
+
+    mpi::set_ranks_per_node(0);
+}
+
+// A persistent exchange context gives the same values and partition as the
+// flat gather, whether the data is carried in the slots beside the counts,
+// overflows the slots, or is too large for slots.
+TEST(mpi, exchange_context) {
+    int id = mpi::rank();
+
+    mpi::exchange_context ctx;
+    EXPECT_EQ(0, ctx.slot_bytes());
+
+    // The number of values of each rank in each round.
+    auto num_values = [](int round, int rank) {
+        switch (round) {
+            case 0: return 2+rank%3;        // small: slots for the next round
+            case 1: return 3;
+            case 2: return rank==0? 100: 1; // rank 0 overflows its slot
+            case 3: return 1000;            // too large for slots
+            default: return rank%2;
+        }
+    };
+
+    for (int round=0; round<6; ++round) {
+        std::vector<big_thing> data;
+        for (int i=0; i<num_values(round, id); ++i) {
+            data.push_back(1000*round+10*id+i);
+        }
+
+        const bool used_slots = ctx.slot_bytes()>0;
+
+        gathered_vector<big_thing> expected;
+        gathered_vector<big_thing> gathered;
+        mpi::gather_all_with_partition(data, expected);
+        ctx.gather_all_with_partition(data, gathered);
+
+        EXPECT_EQ(expected.values(), gathered.values());
+        EXPECT_EQ(expected.partition(), gathered.partition());
+
+        if (round==1 || round==2) {
+            EXPECT_TRUE(used_slots);
+        }
+        if (round==4) {
+            EXPECT_FALSE(used_slots);
+        }
+    }
+}
+
 TEST(mpi, gather_string) {
     using policy = mpi_global_policy;
 
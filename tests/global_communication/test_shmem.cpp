@@ -0,0 +1,80 @@
+#ifdef ARB_HAVE_SHMEM
+
+#include "../gtest.h"
+
+#include <vector>
+
+#include <communication/global_policy.hpp>
+#include <communication/shmem.hpp>
+#include <util/rangeutil.hpp>
+
+using namespace arb;
+using namespace arb::communication;
+
+TEST(shmem, gather_all) {
+    using policy = shmem_global_policy;
+
+    int id = policy::id();
+
+    auto gathered = shmem::gather_all(2*id+1);
+    ASSERT_EQ(policy::size(), (int)gathered.size());
+    for (int i=0; i<policy::size(); ++i) {
+        EXPECT_EQ(2*i+1, gathered[i]);
+    }
+}
+
+// Successive gathers alternate between the two buffers of the shared segment:
+// the values of each gather must not be overwritten by a process that has
+// moved on to the next.
+TEST(shmem, gather_all_with_partition) {
+    using policy = shmem_global_policy;
+
+    int id = policy::id();
+
+    gathered_vector<double> gathered;
+    for (int round=0; round<20; ++round) {
+        std::vector<double> data;
+        for (int i=0; i<(id+round)%5; ++i) {
+            data.push_back(1000*round+10*id+i);
+        }
+
+        shmem::gather_all_with_partition(data, gathered);
+
+        std::vector<double> expected_values;
+        std::vector<unsigned> expected_divisions = {0};
+        for (int r=0; r<policy::size(); ++r) {
+            for (int i=0; i<(r+round)%5; ++i) {
+                expected_values.push_back(1000*round+10*r+i);
+            }
+            expected_divisions.push_back(expected_values.size());
+        }
+
+        EXPECT_EQ(expected_values, gathered.values());
+        EXPECT_EQ(expected_divisions, gathered.partition());
+    }
+}
+
+TEST(shmem, reduce) {
+    using policy = shmem_global_policy;
+
+    int id = policy::id();
+    int n = policy::size();
+
+    EXPECT_EQ(0, policy::min(id));
+    EXPECT_EQ(n-1, policy::max(id));
+    EXPECT_EQ(n*(n-1)/2, policy::sum(id));
+    EXPECT_EQ(double(n), policy::sum(1.0));
+
+    auto gathered = policy::gather(id, 0);
+    if (id==0) {
+        ASSERT_EQ(n, (int)gathered.size());
+        for (int i=0; i<n; ++i) {
+            EXPECT_EQ(i, gathered[i]);
+        }
+    }
+    else {
+        EXPECT_TRUE(gathered.empty());
+    }
+}
+
+#endif // ARB_HAVE_SHMEM
@@ -6,9 +6,12 @@
 #include <vector>
 
 #include <cell.hpp>
+#include <common_types.hpp>
 #include <event_generator.hpp>
 #include <recipe.hpp>
 
+#include "common_cells.hpp"
+
 namespace arb {
 
 // Common functionality: maintain an unordered map of probe data
@@ -126,6 +129,48 @@ protected:
     std::vector<cell> cells_;
 };
 
+// Recipe for a ring of `n` soma-only cells (see `make_cell_soma_only()`),
+// each with a spike detector and an expsyn synapse, where each cell is
+// connected to the next cell in the ring, and only the first cell has a
+// stimulus. Each cell is also driven by a regular event generator with
+// weight `gen_weight`, and a period of `gen_period` lengthened by
+// `gen_period_step` per gid.
+
+class cable1d_ring_recipe: public cable1d_recipe {
+public:
+    cable1d_ring_recipe(unsigned n, float gen_weight, time_type gen_period, time_type gen_period_step = 0):
+        cable1d_recipe(make_cells(n)),
+        gen_weight_(gen_weight), gen_period_(gen_period), gen_period_step_(gen_period_step)
+    {}
+
+    std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+        cell_gid_type src = gid? gid-1: num_cells()-1;
+        return {cell_connection({src, 0}, {gid, 0}, 0.05f, 5.f)};
+    }
+
+    std::vector<event_generator_ptr> event_generators(cell_gid_type gid) const override {
+        std::vector<event_generator_ptr> gens;
+        gens.push_back(make_event_generator<regular_generator>(
+            cell_member_type{gid, 0}, gen_weight_, 0., gen_period_+gen_period_step_*gid));
+        return gens;
+    }
+
+private:
+    float gen_weight_;
+    time_type gen_period_;
+    time_type gen_period_step_;
+
+    static std::vector<cell> make_cells(unsigned n) {
+        std::vector<cell> cells;
+        for (unsigned i=0; i<n; ++i) {
+            cells.push_back(make_cell_soma_only(i==0));
+            cells.back().add_detector({0, 0}, 0);
+            cells.back().add_synapse({0, 0.5}, "expsyn");
+        }
+        return cells;
+    }
+};
+
 
 } // namespace arb
 
@@ -0,0 +1,60 @@
+#include "../gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#include <cell.hpp>
+#include <common_types.hpp>
+#include <event_generator.hpp>
+#include <hardware/node_info.hpp>
+#include <load_balance.hpp>
+#include <model.hpp>
+#include <recipe.hpp>
+#include <sampling.hpp>
+#include <schedule.hpp>
+#include <util/allocation_counter.hpp>
+#include <util/config.hpp>
+
+#include "../common_cells.hpp"
+#include "../simple_recipes.hpp"
+
+using namespace arb;
+
+namespace {
+    // A ring driven by regular input, with a voltage probe on each cell.
+    // The activity is periodic, so that the buffers reach their high water
+    // marks during the warm-up.
+    cable1d_ring_recipe make_ring(unsigned n) {
+        cable1d_ring_recipe rec(n, 0.02f, 2.);
+        for (unsigned i=0; i<n; ++i) {
+            rec.add_probe(i, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+        }
+        return rec;
+    }
+}
+
+// After the first epochs, in which the buffers used in the time stepping
+// loop grow to their high water marks, epochs should not allocate.
+TEST(allocation_counter, steady_state_epochs) {
+    ASSERT_TRUE(config::has_allocation_counter);
+
+    auto count = util::allocation_count();
+    auto rec = make_ring(10);
+    EXPECT_LT(count, util::allocation_count());
+
+    model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}));
+
+    std::atomic<std::size_t> n_samples(0);
+    m.add_sampler(all_probes, regular_schedule(0.5),
+        [&](cell_member_type, probe_tag, std::size_t n, const sample_record*) { n_samples += n; });
+
+    const time_type dt = 0.025;
+    m.run(100, dt);
+    EXPECT_LT(0u, m.num_spikes());
+    EXPECT_LT(0u, n_samples.load());
+
+    for (auto t: {200., 300., 400.}) {
+        m.run(t, dt);
+        EXPECT_EQ(0u, m.num_epoch_allocations());
+    }
+}
@@ -0,0 +1,173 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <cell.hpp>
+#include <common_types.hpp>
+#include <connection_rule.hpp>
+#include <hardware/node_info.hpp>
+#include <load_balance.hpp>
+#include <model.hpp>
+#include <recipe.hpp>
+#include <spike.hpp>
+
+#include "../common_cells.hpp"
+#include "../simple_recipes.hpp"
+
+using namespace arb;
+
+namespace {
+    std::vector<cell_gid_type> targets(const std::vector<cell_connection>& conns) {
+        std::vector<cell_gid_type> gids;
+        for (const auto& c: conns) gids.push_back(c.dest.gid);
+        return gids;
+    }
+
+    // A network of soma-only cells with procedural random connections, or
+    // with the same connections listed by connections_on.
+    class random_recipe: public cable1d_recipe {
+    public:
+        random_recipe(const std::vector<cell>& cells, bool procedural):
+            cable1d_recipe(cells),
+            rule_(std::make_shared<random_connection_rule>(42, num_cells(), 0.2, 0, 0.05f, 2.f)),
+            procedural_(procedural)
+        {}
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            std::vector<cell_connection> conns;
+            if (!procedural_) {
+                for (cell_gid_type src = 0; src<num_cells(); ++src) {
+                    rule_->connections_from({src, 0}, gid, gid+1, conns);
+                }
+            }
+            return conns;
+        }
+
+        connection_rule_ptr procedural_connections() const override {
+            return procedural_? rule_: nullptr;
+        }
+
+    private:
+        connection_rule_ptr rule_;
+        bool procedural_;
+    };
+
+    std::vector<cell> make_cells(unsigned n) {
+        std::vector<cell> cells;
+        for (unsigned i=0; i<n; ++i) {
+            cells.push_back(make_cell_soma_only(i==0));
+            cells.back().add_detector({0, 0}, 0);
+            cells.back().add_synapse({0, 0.5}, "expsyn");
+        }
+        return cells;
+    }
+
+    void sort_spikes(std::vector<spike>& spikes) {
+        std::sort(spikes.begin(), spikes.end(),
+            [](const spike& a, const spike& b) {
+                return a.source<b.source || (a.source==b.source && a.time<b.time);
+            });
+    }
+
+    std::vector<spike> run(const recipe& rec) {
+        model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}));
+        std::vector<spike> spikes;
+        m.set_global_spike_callback(
+            [&](const std::vector<spike>& s) {
+                spikes.insert(spikes.end(), s.begin(), s.end());
+            });
+        m.run(50, 0.025);
+        sort_spikes(spikes);
+        return spikes;
+    }
+}
+
+TEST(connection_rule, random) {
+    const cell_size_type n = 3000;
+    const double p = 0.05;
+    random_connection_rule rule(7, n, p, 1, 0.5f, 3.f);
+    EXPECT_EQ(3., rule.min_delay());
+
+    std::size_t total = 0;
+    for (cell_gid_type src: {0u, 5u, 1023u, 1024u, 2999u}) {
+        std::vector<cell_connection> all;
+        rule.connections_from({src, 0}, 0, n, all);
+        total += all.size();
+
+        auto gids = targets(all);
+        EXPECT_TRUE(std::is_sorted(gids.begin(), gids.end()));
+        EXPECT_EQ(gids.end(), std::adjacent_find(gids.begin(), gids.end()));
+        EXPECT_EQ(gids.end(), std::find(gids.begin(), gids.end(), src));
+        for (const auto& c: all) {
+            EXPECT_EQ(src, c.source.gid);
+            EXPECT_EQ(1u, c.dest.index);
+            EXPECT_EQ(0.5f, c.weight);
+            EXPECT_EQ(3.f, c.delay);
+        }
+
+        // The connections onto a range do not depend on how the gids are
+        // divided into ranges.
+        std::vector<cell_connection> parts;
+        rule.connections_from({src, 0}, 0, 700, parts);
+        rule.connections_from({src, 0}, 700, 1500, parts);
+        rule.connections_from({src, 0}, 1500, 1501, parts);
+        rule.connections_from({src, 0}, 1501, n+10, parts);
+        EXPECT_EQ(gids, targets(parts));
+
+        // Only the first source of a cell has connections.
+        std::vector<cell_connection> none;
+        rule.connections_from({src, 1}, 0, n, none);
+        EXPECT_TRUE(none.empty());
+    }
+
+    // The number of connections is binomial: allow five standard deviations.
+    const double trials = 5*(n-1);
+    EXPECT_LT(std::abs(total-trials*p), 5*std::sqrt(trials*p*(1-p)));
+
+    // Different seeds give different networks.
+    random_connection_rule other(8, n, p, 1, 0.5f, 3.f);
+    std::vector<cell_connection> a, b;
+    rule.connections_from({0, 0}, 0, n, a);
+    other.connections_from({0, 0}, 0, n, b);
+    EXPECT_NE(targets(a), targets(b));
+}
+
+// A model with procedural connections gives the same spikes as a model in
+// which the same connections are stored.
+TEST(connection_rule, model) {
+    auto cells = make_cells(20);
+
+    auto expected = run(random_recipe(cells, false));
+    auto spikes = run(random_recipe(cells, true));
+
+    EXPECT_LT(1u, expected.size());
+    ASSERT_EQ(expected.size(), spikes.size());
+    for (auto i=0u; i<spikes.size(); ++i) {
+        EXPECT_EQ(expected[i].source, spikes[i].source);
+        EXPECT_EQ(expected[i].time, spikes[i].time);
+    }
+}
+
+// Procedural connections are not stored, so their weights can not be
+// changed in place, unlike those of the same connections given by
+// connections_on.
+TEST(connection_rule, set_connection_weight) {
+    auto cells = make_cells(20);
+    random_recipe stored(cells, false);
+    random_recipe procedural(cells, true);
+
+    std::vector<cell_connection> conns;
+    for (cell_gid_type gid=0; conns.empty(); ++gid) {
+        conns = stored.connections_on(gid);
+    }
+    const auto& c = conns.front();
+
+    model m(stored, partition_load_balance(stored, hw::node_info{1u, 0u}));
+    m.set_connection_weight(c.source, c.dest, 0.1f);
+
+    model p(procedural, partition_load_balance(procedural, hw::node_info{1u, 0u}));
+    EXPECT_THROW(p.set_connection_weight(c.source, c.dest, 0.1f), std::invalid_argument);
+}
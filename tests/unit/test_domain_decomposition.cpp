@@ -1,12 +1,14 @@
 #include "../gtest.h"
 
 #include <stdexcept>
+#include <vector>
 
 #include <backends.hpp>
 #include <domain_decomposition.hpp>
 #include <hardware/node_info.hpp>
 #include <load_balance.hpp>
 
+#include "../common_cells.hpp"
 #include "../simple_recipes.hpp"
 
 using namespace arb;
@@ -57,6 +59,39 @@ namespace {
     private:
         cell_size_type size_;
     };
+
+    // Heterogeneous population with a recipe provided cost for each cell.
+    class costed_recipe: public hetero_recipe {
+    public:
+        costed_recipe(cell_size_type s): hetero_recipe(s) {}
+
+        util::optional<double> cell_cost(cell_gid_type gid) const override {
+            return 1.+(gid*7)%10;
+        }
+    };
+
+    // Heterogeneous population of interleaved clusters: cell gid is in
+    // cluster gid%num_clusters, and is the target of connections from the
+    // next few cells in its cluster.
+    class clustered_recipe: public hetero_recipe {
+    public:
+        clustered_recipe(cell_size_type s, unsigned num_clusters):
+            hetero_recipe(s), size_(s), num_clusters_(num_clusters)
+        {}
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            std::vector<cell_connection> conns;
+            for (unsigned k=1; k<=4; ++k) {
+                cell_gid_type src = (gid+k*num_clusters_)%size_;
+                conns.push_back(cell_connection({src, 0}, {gid, 0}, 0.f, 1.f));
+            }
+            return conns;
+        }
+
+    private:
+        cell_size_type size_;
+        unsigned num_clusters_;
+    };
 }
 
 TEST(domain_decomposition, homogenous_population)
@@ -203,3 +238,89 @@ TEST(domain_decomposition, heterogenous_population)
         EXPECT_EQ(num_cells, ncells);
     }
 }
+
+TEST(domain_decomposition, cell_cost)
+{
+    // Cells without a cost from the recipe have a cost by kind, which is
+    // higher for cable cells than for spike sources.
+    auto R = hetero_recipe(2);
+    EXPECT_EQ(1., estimate_cell_cost(R, 1));
+    EXPECT_LT(1., estimate_cell_cost(R, 0));
+
+    std::vector<cell> cells;
+    cells.push_back(make_cell_soma_only());
+    cells.push_back(make_cell_ball_and_stick());
+    cable1d_recipe cables(cells);
+    EXPECT_EQ(estimate_cell_cost(R, 0), estimate_cell_cost(cables, 0));
+    EXPECT_EQ(estimate_cell_cost(R, 0), estimate_cell_cost(cables, 1));
+
+    // The cost of a cable cell description grows with its compartments.
+    EXPECT_LT(1., estimate_cell_cost(cells[0]));
+    EXPECT_LT(estimate_cell_cost(cells[0]), estimate_cell_cost(cells[1]));
+
+    auto C = costed_recipe(2);
+    EXPECT_EQ(1., estimate_cell_cost(C, 0));
+    EXPECT_EQ(8., estimate_cell_cost(C, 1));
+}
+
+TEST(domain_decomposition, cost_load_balance)
+{
+    // Test on a node with 1 cpu core and no gpus: all cells are local, in
+    // cell groups of size 1, ordered by decreasing cost.
+    hw::node_info nd(1, 0);
+
+    unsigned num_cells = 20;
+    auto R = costed_recipe(num_cells);
+    const auto D = cost_load_balance(R, nd);
+
+    EXPECT_EQ(D.num_global_cells, num_cells);
+    EXPECT_EQ(D.num_local_cells, num_cells);
+    ASSERT_EQ(D.groups.size(), num_cells);
+
+    std::set<cell_gid_type> gids;
+    for (auto i: util::make_span(0, num_cells)) {
+        auto& grp = D.groups[i];
+        ASSERT_EQ(grp.gids.size(), 1u);
+        auto gid = grp.gids.front();
+        gids.insert(gid);
+        EXPECT_EQ(R.get_cell_kind(gid), grp.kind);
+        EXPECT_EQ(grp.backend, backend_kind::multicore);
+        EXPECT_TRUE(D.is_local_gid(gid));
+        if (i) {
+            EXPECT_GE(*R.cell_cost(D.groups[i-1].gids.front()), *R.cell_cost(gid));
+        }
+    }
+    EXPECT_EQ(num_cells, gids.size());
+}
+
+TEST(domain_decomposition, graph_load_balance)
+{
+    // Test on a node with 1 cpu core and no gpus: all cells are local, in
+    // cell groups of size 1, and no connections are cut.
+    hw::node_info nd(1, 0);
+
+    unsigned num_cells = 40;
+    auto R = clustered_recipe(num_cells, 4);
+    const auto D = graph_load_balance(R, nd);
+
+    EXPECT_EQ(D.num_global_cells, num_cells);
+    EXPECT_EQ(D.num_local_cells, num_cells);
+    ASSERT_EQ(D.groups.size(), num_cells);
+
+    std::set<cell_gid_type> gids;
+    for (auto& grp: D.groups) {
+        ASSERT_EQ(grp.gids.size(), 1u);
+        auto gid = grp.gids.front();
+        gids.insert(gid);
+        EXPECT_EQ(R.get_cell_kind(gid), grp.kind);
+        EXPECT_EQ(0, D.gid_domain(gid));
+        EXPECT_TRUE(D.is_local_gid(gid));
+    }
+    EXPECT_EQ(num_cells, gids.size());
+
+    auto report = make_decomposition_report(R, D);
+    EXPECT_EQ(4u*num_cells, report.num_connections);
+    EXPECT_EQ(0u, report.cut_connections);
+    EXPECT_EQ(std::vector<std::size_t>{num_cells}, report.domain_cells);
+    EXPECT_EQ(std::vector<std::size_t>{0}, report.domain_fan_out);
+}
@@ -18,6 +18,31 @@ namespace{
         }
         return v;
     }
+
+    // Draw the events in [t0, t1) with the batched interface, appending them
+    // to a buffer that already holds an event that must be left in place.
+    pse_vector draw_batch(event_generator& gen, time_type t0, time_type t1) {
+        pse_vector v = {terminal_pse()};
+        gen.events(t0, t1, v);
+        EXPECT_EQ(terminal_pse(), v.front());
+        return pse_vector(v.begin()+1, v.end());
+    }
+
+    // Check that drawing the events in successive intervals with the batched
+    // interface gives the same events as drawing them one at a time.
+    void check_batches(event_generator& gen, const std::vector<time_type>& times) {
+        for (auto i=1u; i<times.size(); ++i) {
+            auto expected = draw(gen, times[i-1], times[i]);
+            gen.reset();
+            for (auto j=1u; j<i; ++j) {
+                draw_batch(gen, times[j-1], times[j]);
+            }
+            auto batch = draw_batch(gen, times[i-1], times[i]);
+            EXPECT_EQ(expected, batch);
+            EXPECT_TRUE(std::is_sorted(batch.begin(), batch.end()));
+            EXPECT_TRUE(gen.next().time>=times[i]);
+        }
+    }
 }
 
 TEST(event_generators, vector_backed) {
@@ -262,3 +287,36 @@ TEST(event_generators, poisson_terminates) {
     // the last event should be less than the end time
     EXPECT_TRUE(events.back().time<t1);
 }
+
+TEST(event_generators, batched) {
+    std::vector<time_type> times = {0, 0.5, 0.5, 2.1, 3.0, 7.3, 20};
+
+    std::vector<pse> in = {
+        {{0, 0}, 0.1, 1.0},
+        {{0, 0}, 1.0, 2.0},
+        {{0, 0}, 1.0, 3.0},
+        {{0, 0}, 1.5, 4.0},
+        {{0, 0}, 2.3, 5.0},
+        {{0, 0}, 3.0, 6.0},
+        {{0, 0}, 3.5, 7.0},
+    };
+    vector_backed_generator vgen(in);
+    check_batches(vgen, times);
+
+    seq_generator<pse_vector> sgen(in);
+    check_batches(sgen, times);
+
+    regular_generator rgen({42, 3}, 3.14f, 0.2, 0.25, 5.);
+    check_batches(rgen, times);
+
+    std::mt19937_64 G;
+    poisson_generator<std::mt19937_64> pgen({4, 2}, 42.f, G, 0.5, 10., 6.);
+    check_batches(pgen, times);
+
+    // Events before the current state of a generator are not drawn again.
+    regular_generator gen({42, 3}, 3.14f, 0, 1);
+    EXPECT_EQ(3u, draw_batch(gen, 0, 3).size());
+    EXPECT_EQ(2u, draw_batch(gen, 0, 5).size());
+    EXPECT_EQ(0u, draw_batch(gen, 10, 10).size());
+    EXPECT_EQ(time_type(10), gen.next().time);
+}
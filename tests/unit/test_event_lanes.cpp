@@ -0,0 +1,103 @@
+#include "../gtest.h"
+
+#include <vector>
+
+#include <event_lanes.hpp>
+#include <event_queue.hpp>
+
+using namespace arb;
+
+namespace {
+    template <typename Lane>
+    pse_vector as_vector(const Lane& lane) {
+        return pse_vector(lane.begin(), lane.end());
+    }
+}
+
+TEST(event_lanes, clear)
+{
+    event_lanes lanes(4);
+
+    EXPECT_EQ(4u, lanes.size());
+    EXPECT_EQ(0u, lanes.num_events());
+    for (auto i=0u; i<lanes.size(); ++i) {
+        EXPECT_TRUE(lanes[i].empty());
+    }
+
+    lanes.clear(2);
+    EXPECT_EQ(2u, lanes.size());
+
+    event_lanes empty;
+    EXPECT_EQ(0u, empty.size());
+}
+
+TEST(event_lanes, assign)
+{
+    using staged = event_lanes::staged_event;
+
+    std::vector<staged> events = {
+        {2, {{5, 0}, 1.f, 1.f}},
+        {0, {{3, 1}, 2.f, 2.f}},
+        {2, {{5, 1}, 0.5f, 3.f}},
+        {0, {{3, 0}, 1.f, 4.f}},
+    };
+
+    event_lanes lanes;
+    lanes.assign(3, events);
+
+    EXPECT_EQ(3u, lanes.size());
+    EXPECT_EQ(4u, lanes.num_events());
+
+    // Relative order of events in each lane is preserved.
+    pse_vector lane0 = {{{3, 1}, 2.f, 2.f}, {{3, 0}, 1.f, 4.f}};
+    pse_vector lane2 = {{{5, 0}, 1.f, 1.f}, {{5, 1}, 0.5f, 3.f}};
+
+    EXPECT_EQ(lane0, as_vector(lanes[0]));
+    EXPECT_TRUE(lanes[1].empty());
+    EXPECT_EQ(lane2, as_vector(lanes[2]));
+
+    // Reassignment replaces the contents of all lanes.
+    lanes.assign(2, {{1, {{0, 0}, 3.f, 1.f}}});
+    EXPECT_EQ(2u, lanes.size());
+    EXPECT_EQ(1u, lanes.num_events());
+    EXPECT_TRUE(lanes[0].empty());
+    EXPECT_EQ(1u, lanes[1].size());
+}
+
+TEST(event_lanes, resize_lanes)
+{
+    event_lanes lanes;
+    lanes.resize_lanes(std::vector<std::size_t>{2, 0, 1});
+
+    EXPECT_EQ(3u, lanes.size());
+    EXPECT_EQ(3u, lanes.num_events());
+    EXPECT_EQ(2u, lanes[0].size());
+    EXPECT_EQ(0u, lanes[1].size());
+    EXPECT_EQ(1u, lanes[2].size());
+
+    std::vector<std::size_t> expected_divs = {0, 2, 2, 3};
+    EXPECT_EQ(expected_divs, lanes.divisions());
+}
+
+TEST(event_lanes, subrange)
+{
+    using staged = event_lanes::staged_event;
+
+    event_lanes lanes;
+    lanes.assign(4, std::vector<staged>{
+        {0, {{0, 0}, 1.f, 1.f}},
+        {1, {{1, 0}, 1.f, 1.f}},
+        {1, {{1, 0}, 2.f, 1.f}},
+        {3, {{3, 0}, 1.f, 1.f}},
+    });
+
+    auto sub = lanes.subrange({1, 3});
+    EXPECT_EQ(2u, sub.size());
+    EXPECT_EQ(2u, sub[0].size());
+    EXPECT_EQ(0u, sub[1].size());
+    EXPECT_EQ(2.f, sub[0][1].time);
+
+    event_lane_subrange none;
+    EXPECT_EQ(0u, none.size());
+    EXPECT_TRUE(none.empty());
+}
@@ -0,0 +1,55 @@
+#include "../gtest.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <util/flat_map.hpp>
+#include <util/rangeutil.hpp>
+
+using namespace arb;
+
+TEST(flat_map, insert_find) {
+    util::flat_map<int, std::string> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.end(), m.find(1));
+
+    // Keys are kept sorted, whatever the order of insertion.
+    for (int k: {3, 5, 1, 4, 9}) {
+        auto r = m.insert({k, std::to_string(k)});
+        EXPECT_TRUE(r.second);
+        EXPECT_EQ(k, r.first->first);
+    }
+    EXPECT_EQ(5u, m.size());
+    std::vector<int> keys = util::assign_from(util::keys(m));
+    EXPECT_EQ((std::vector<int>{1, 3, 4, 5, 9}), keys);
+
+    // Inserting an existing key keeps the existing value.
+    auto r = m.insert({4, "four"});
+    EXPECT_FALSE(r.second);
+    EXPECT_EQ("4", r.first->second);
+    EXPECT_EQ(5u, m.size());
+
+    for (int k: {1, 3, 4, 5, 9}) {
+        ASSERT_NE(m.end(), m.find(k));
+        EXPECT_EQ(std::to_string(k), m.find(k)->second);
+        EXPECT_EQ(std::to_string(k), m.at(k));
+        EXPECT_EQ(1u, m.count(k));
+    }
+    for (int k: {0, 2, 6, 10}) {
+        EXPECT_EQ(m.end(), m.find(k));
+        EXPECT_EQ(0u, m.count(k));
+        EXPECT_THROW(m.at(k), std::out_of_range);
+    }
+
+    // Indexing inserts a default value for a missing key.
+    m.at(3) = "three";
+    EXPECT_EQ("three", m[3]);
+    EXPECT_EQ("", m[2]);
+    EXPECT_EQ(6u, m.size());
+    util::assign(keys, util::keys(m));
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5, 9}), keys);
+
+    m.clear();
+    EXPECT_TRUE(m.empty());
+}
@@ -0,0 +1,101 @@
+#include <vector>
+
+#include "../gtest.h"
+
+#include <backends/multicore/fvm.hpp>
+#include <cell.hpp>
+#include <fvm_discretization.hpp>
+#include <fvm_multicell.hpp>
+#include <util/span.hpp>
+
+#include "../common_cells.hpp"
+#include "../simple_recipes.hpp"
+
+using namespace arb;
+
+TEST(fvm_discretization, discretize) {
+    cell c = make_cell_ball_and_3stick();
+    auto d = fvm::discretize(c);
+
+    auto graph = c.model();
+    ASSERT_EQ(c.num_compartments(), d.size());
+    ASSERT_EQ(c.num_segments(), d.segments.size());
+    EXPECT_EQ(graph.parent_index.size(), d.parent_index.size());
+    for (auto i: util::make_span(0, d.size())) {
+        EXPECT_EQ(graph.parent_index[i], d.parent_index[i]);
+        EXPECT_GT(d.cv_area[i], 0.);
+        EXPECT_GT(d.cv_capacitance[i], 0.);
+    }
+
+    // The soma has no parent CV; the first CV of each dendrite is its parent.
+    EXPECT_FALSE(d.segments[0].has_parent());
+    for (auto j: util::make_span(1, c.num_segments())) {
+        const auto& r = d.segments[j];
+        ASSERT_TRUE(r.has_parent());
+        EXPECT_EQ(d.segment_index[j], r.segment_cvs.first);
+        EXPECT_EQ(d.segment_index[j+1], r.segment_cvs.second);
+        EXPECT_EQ(d.parent_index[d.segment_index[j]], r.parent_cv);
+
+        auto s = r.shifted(10);
+        EXPECT_EQ(r.segment_cvs.first+10, s.segment_cvs.first);
+        EXPECT_EQ(r.segment_cvs.second+10, s.segment_cvs.second);
+        EXPECT_EQ(r.parent_cv+10, s.parent_cv);
+    }
+}
+
+TEST(fvm_discretization, cache) {
+    fvm::discretization_cache cache;
+
+    cell a = make_cell_ball_and_stick();
+    cell b = make_cell_ball_and_stick(false);
+    b.add_synapse({1, 0.5}, "expsyn");
+
+    // Cells that differ only in their stimuli and synapses share a
+    // discretization.
+    auto da = cache.get(a);
+    auto db = cache.get(b);
+    EXPECT_EQ(da, db);
+    EXPECT_EQ(1u, cache.size());
+
+    // A different number of compartments or a different geometry does not.
+    cell c = make_cell_ball_and_stick();
+    c.segment(1)->set_compartments(7);
+    EXPECT_NE(da, cache.get(c));
+    EXPECT_EQ(2u, cache.size());
+
+    cell t = make_cell_ball_and_taper();
+    EXPECT_NE(da, cache.get(t));
+    EXPECT_EQ(3u, cache.size());
+
+    EXPECT_EQ(cache.get(c), cache.get(c));
+    EXPECT_EQ(3u, cache.size());
+}
+
+TEST(fvm_discretization, fvm_multicell) {
+    using fvm_cell = fvm::fvm_multicell<multicore::backend>;
+
+    cell cells[] = {make_cell_ball_and_3stick(), make_cell_ball_and_3stick()};
+    const auto& c = cells[0];
+    const auto n = c.num_compartments();
+
+    std::vector<fvm_cell::target_handle> targets;
+    probe_association_map<fvm_cell::probe_handle> probe_map;
+    fvm::discretization_cache cache;
+
+    // Both cells of the group, and a second group, use one discretization,
+    // which gives the same CVs as discretizing each cell on its own.
+    fvm_cell one, two;
+    one.initialize({0}, cable1d_recipe(c), targets, probe_map);
+    two.initialize({0, 1}, cable1d_recipe(cells), targets, probe_map, &cache);
+
+    fvm_cell other;
+    other.initialize({0}, cable1d_recipe(c), targets, probe_map, &cache);
+    EXPECT_EQ(1u, cache.size());
+
+    ASSERT_EQ(2*n, two.cv_areas().size());
+    for (auto i: util::make_span(0, n)) {
+        EXPECT_EQ(one.cv_areas()[i], two.cv_areas()[i]);
+        EXPECT_EQ(one.cv_areas()[i], two.cv_areas()[n+i]);
+        EXPECT_EQ(one.cv_areas()[i], other.cv_areas()[i]);
+    }
+}
@@ -245,6 +245,58 @@ TEST(fvm_multi, stimulus)
     EXPECT_EQ(I[dend_idx]/(1e3/A[dend_idx]), -0.3);
 }
 
+TEST(fvm_multi, steady_state)
+{
+    using namespace arb;
+
+    std::vector<fvm_cell::target_handle> targets;
+    probe_association_map<fvm_cell::probe_handle> probe_map;
+
+    fvm_cell fvcell;
+    fvcell.initialize({0}, cable1d_recipe(make_cell_ball_and_3stick(false)), targets, probe_map);
+
+    // Integrate the cell without input over [0, t), returning the largest
+    // change in voltage over the last ms.
+    auto drift = [&](time_type t) {
+        const time_type dt = 0.025;
+        fvcell.setup_integration(t-1, dt, {}, {});
+        while (!fvcell.integration_complete()) {
+            fvcell.step_integration();
+        }
+        std::vector<fvm_value_type> v(fvcell.voltage().begin(), fvcell.voltage().end());
+        fvcell.setup_integration(t, dt, {}, {});
+        while (!fvcell.integration_complete()) {
+            fvcell.step_integration();
+        }
+        double d = 0;
+        for (auto i: util::make_span(0, v.size())) {
+            d = std::max(d, std::abs(fvcell.voltage()[i]-v[i]));
+        }
+        return d;
+    };
+
+    // From the resting potential, the cell is not in equilibrium.
+    EXPECT_LT(1e-3, drift(5));
+
+    // The steady state remains unchanged, and is the state the cell settles
+    // to from the resting potential.
+    fvcell.reset();
+    EXPECT_TRUE(fvcell.initialize_steady_state(1e-7, 100000, 0.025, 10));
+    EXPECT_EQ(0., fvcell.time(0));
+    std::vector<fvm_value_type> v0(fvcell.voltage().begin(), fvcell.voltage().end());
+    EXPECT_GT(1e-5, drift(100));
+
+    fvcell.reset();
+    drift(500);
+    for (auto i: util::make_span(0, v0.size())) {
+        EXPECT_NEAR(v0[i], fvcell.voltage()[i], 1e-4);
+    }
+
+    // Too few steps to converge.
+    fvcell.reset();
+    EXPECT_FALSE(fvcell.initialize_steady_state(1e-7, 2, 0.025, 10));
+}
+
 // test that mechanism indexes are computed correctly
 TEST(fvm_multi, mechanism_indexes)
 {
@@ -660,6 +712,66 @@ TEST(fvm_multi, synapse_parameters) {
     EXPECT_EQ(expected, values);
 }
 
+// Parameters set after initialization apply to the CV or target given, and
+// are kept by reset.
+TEST(fvm_multi, set_parameters) {
+    using namespace arb;
+
+    std::vector<cell> cells;
+    for (int i=0; i<2; ++i) {
+        cells.push_back(make_cell_ball_and_stick(false));
+        cells.back().soma()->add_mechanism("test_kin1");
+        cells.back().add_synapse({1, 0.5}, "expsyn");
+    }
+
+    std::vector<fvm_cell::target_handle> targets;
+    probe_association_map<fvm_cell::probe_handle> probe_map;
+
+    fvm_cell fvcell;
+    fvcell.initialize({0, 1}, cable1d_recipe(cells), targets, probe_map);
+
+    auto mech = [&](const char* name) -> fvm_cell::mechanism& {
+        return **fvcell.find_mechanism(name);
+    };
+    auto field = [&](const char* name, const char* param) {
+        auto& m = mech(name);
+        return m.*m.field_view_ptr(param);
+    };
+
+    // The soma of cell 1 is CV 5, and location (1, 0.9) on cell 0 is CV 4.
+    fvcell.set_density_parameter(1, {0, 0.5}, "hh", "gnabar", 0.2);
+    fvcell.set_density_parameter(0, {1, 0.9}, "pas", "g", 0.01);
+    fvcell.set_point_parameter(targets[1], "tau", 5.);
+    fvcell.set_global_parameter("test_kin1", "tau", 20.);
+    fvcell.reset();
+
+    auto hh_index = mech("hh").node_index();
+    auto gnabar = field("hh", "gnabar");
+    ASSERT_EQ(2u, hh_index.size());
+    for (auto i: util::make_span(0, hh_index.size())) {
+        EXPECT_EQ(hh_index[i]==5? 0.2: 0.12, gnabar[i]);
+    }
+
+    auto pas_index = mech("pas").node_index();
+    auto g = field("pas", "g");
+    for (auto i: util::make_span(0, pas_index.size())) {
+        EXPECT_EQ(pas_index[i]==4? 0.01: 0.001, g[i]);
+    }
+
+    auto tau = field("expsyn", "tau");
+    EXPECT_EQ(2., tau[targets[0].mech_index]);
+    EXPECT_EQ(5., tau[targets[1].mech_index]);
+
+    auto& kin1 = mech("test_kin1");
+    EXPECT_EQ(20., kin1.*kin1.field_value_ptr("tau"));
+
+    EXPECT_THROW(fvcell.set_density_parameter(0, {0, 0.5}, "expsyn", "tau", 1.), std::invalid_argument);
+    EXPECT_THROW(fvcell.set_density_parameter(0, {1, 0.9}, "test_kin1", "tau", 1.), std::invalid_argument);
+    EXPECT_THROW(fvcell.set_density_parameter(0, {0, 0.5}, "hh", "tau", 1.), std::invalid_argument);
+    EXPECT_THROW(fvcell.set_point_parameter(targets[0], "gnabar", 1.), std::invalid_argument);
+    EXPECT_THROW(fvcell.set_global_parameter("hh", "tau", 1.), std::invalid_argument);
+}
+
 struct handle_info {
     unsigned cell;
     std::string mech;
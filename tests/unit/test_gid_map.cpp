@@ -0,0 +1,41 @@
+#include "../gtest.h"
+
+#include <vector>
+
+#include <common_types.hpp>
+#include <gid_map.hpp>
+
+using namespace arb;
+
+TEST(gid_map, dense) {
+    gid_map<int> empty;
+    EXPECT_EQ(nullptr, empty.find(0));
+
+    // Contiguous gids, in any order, are looked up by offset.
+    gid_map<int> m({12, 10, 11, 13}, {2, 0, 1, 3});
+    EXPECT_TRUE(m.dense());
+    EXPECT_EQ(4u, m.size());
+    for (cell_gid_type gid: {10, 11, 12, 13}) {
+        ASSERT_NE(nullptr, m.find(gid));
+        EXPECT_EQ(int(gid)-10, *m.find(gid));
+    }
+    for (cell_gid_type gid: {0, 9, 14, 100}) {
+        EXPECT_EQ(nullptr, m.find(gid));
+    }
+}
+
+TEST(gid_map, sparse) {
+    std::vector<cell_gid_type> gids = {7, 100, 3, 42, 8};
+    std::vector<int> values = {0, 1, 2, 3, 4};
+
+    gid_map<int> m(gids, values);
+    EXPECT_FALSE(m.dense());
+    EXPECT_EQ(5u, m.size());
+    for (unsigned i=0; i<gids.size(); ++i) {
+        ASSERT_NE(nullptr, m.find(gids[i]));
+        EXPECT_EQ(values[i], *m.find(gids[i]));
+    }
+    for (cell_gid_type gid: {0, 4, 9, 41, 43, 99, 101}) {
+        EXPECT_EQ(nullptr, m.find(gid));
+    }
+}
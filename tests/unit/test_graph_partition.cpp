@@ -0,0 +1,114 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <graph_partition.hpp>
+
+using namespace arb;
+
+namespace {
+    using edge_list = std::vector<std::pair<unsigned, unsigned>>;
+
+    // A grid of nx by ny vertices of unit weight, with edges between
+    // horizontal and vertical neighbours.
+    weighted_graph make_grid(unsigned nx, unsigned ny) {
+        edge_list edges;
+        for (unsigned j=0; j<ny; ++j) {
+            for (unsigned i=0; i<nx; ++i) {
+                unsigned v = j*nx+i;
+                if (i+1<nx) edges.push_back({v, v+1});
+                if (j+1<ny) edges.push_back({v, v+nx});
+            }
+        }
+        return make_weighted_graph(std::vector<double>(nx*ny, 1.), edges);
+    }
+
+    std::vector<double> part_weights(const weighted_graph& g, const std::vector<unsigned>& part, unsigned n) {
+        std::vector<double> w(n, 0.);
+        for (unsigned v=0; v<g.size(); ++v) {
+            w[part[v]] += g.vertex_weights[v];
+        }
+        return w;
+    }
+}
+
+TEST(graph_partition, make_weighted_graph) {
+    // Duplicate edges in either direction are merged; self edges are dropped.
+    edge_list edges = {{0, 1}, {1, 0}, {1, 2}, {2, 2}, {3, 1}};
+    auto g = make_weighted_graph({1., 2., 3., 4.}, edges);
+
+    EXPECT_EQ(4u, g.size());
+    std::vector<std::size_t> offsets = {0, 1, 4, 5, 6};
+    std::vector<unsigned> adjacency = {1, 0, 2, 3, 1, 1};
+    std::vector<double> weights = {2, 2, 1, 1, 1, 1};
+    EXPECT_EQ(offsets, g.offsets);
+    EXPECT_EQ(adjacency, g.adjacency);
+    EXPECT_EQ(weights, g.edge_weights);
+
+    EXPECT_EQ(0., edge_cut(g, {0, 0, 0, 0}));
+    EXPECT_EQ(2., edge_cut(g, {0, 1, 1, 1}));
+    EXPECT_EQ(4., edge_cut(g, {0, 1, 0, 0}));
+}
+
+TEST(graph_partition, trivial) {
+    auto g = make_grid(4, 4);
+    EXPECT_EQ(std::vector<unsigned>(16, 0u), partition_graph(g, 1));
+
+    weighted_graph empty;
+    EXPECT_TRUE(partition_graph(empty, 4).empty());
+}
+
+TEST(graph_partition, clusters) {
+    // Interleaved clusters of densely connected vertices, with a single edge
+    // between successive clusters: the partition should recover the clusters.
+    const unsigned num_clusters = 8;
+    const unsigned cluster_size = 50;
+    const unsigned n = num_clusters*cluster_size;
+
+    edge_list edges;
+    for (unsigned v=0; v<n; ++v) {
+        for (unsigned k=1; k<=5; ++k) {
+            edges.push_back({v, (v+k*num_clusters)%n});
+        }
+    }
+    for (unsigned c=0; c+1<num_clusters; ++c) {
+        edges.push_back({c, c+1});
+    }
+    auto g = make_weighted_graph(std::vector<double>(n, 1.), edges);
+
+    auto part = partition_graph(g, num_clusters);
+    ASSERT_EQ(n, part.size());
+    EXPECT_EQ(num_clusters-1, edge_cut(g, part));
+
+    for (auto w: part_weights(g, part, num_clusters)) {
+        EXPECT_EQ(cluster_size, w);
+    }
+}
+
+TEST(graph_partition, grid) {
+    const unsigned nx = 64, ny = 64, num_parts = 4;
+    auto g = make_grid(nx, ny);
+
+    auto part = partition_graph(g, num_parts, 0.03);
+    ASSERT_EQ(g.size(), part.size());
+
+    // Parts are balanced to within the imbalance.
+    for (auto w: part_weights(g, part, num_parts)) {
+        EXPECT_LE(w, 1.03*nx*ny/num_parts);
+        EXPECT_GE(w, 0.9*nx*ny/num_parts);
+    }
+
+    // Cutting the grid into quadrants cuts 128 edges; a partition into
+    // contiguous rows of vertices, i.e. by index, cuts 192.
+    std::vector<unsigned> by_index(g.size());
+    for (unsigned v=0; v<g.size(); ++v) {
+        by_index[v] = v*num_parts/g.size();
+    }
+    EXPECT_EQ(192., edge_cut(g, by_index));
+    EXPECT_LT(edge_cut(g, part), 1.5*128);
+
+    // The partition is deterministic.
+    EXPECT_EQ(part, partition_graph(g, num_parts, 0.03));
+}
@@ -15,7 +15,7 @@ TEST(merge_events, empty)
     pse_vector lc;
     pse_vector lf;
 
-    merge_events(0, max_time, lc, events, empty_gens, lf);
+    merge_events(0, max_time, lane_view(lc), lane_view(events), empty_gens, lf);
 
     EXPECT_EQ(lf.size(), 0u);
 }
@@ -47,7 +47,7 @@ TEST(merge_events, no_overlap)
         {{0, 0}, 11, 1},
     };
 
-    merge_events(10, max_time, lc, events, empty_gens, lf);
+    merge_events(10, max_time, lane_view(lc), lane_view(events), empty_gens, lf);
 
     pse_vector expected = {
         {{8, 0}, 10, 4},
@@ -85,7 +85,7 @@ TEST(merge_events, overlap)
         {{7, 0}, 10, 8},
     };
 
-    merge_events(10, max_time, lc, events, empty_gens, lf);
+    merge_events(10, max_time, lane_view(lc), lane_view(events), empty_gens, lf);
 
     pse_vector expected = {
         {{7, 0}, 10, 8}, // from events
@@ -127,12 +127,12 @@ TEST(merge_events, X)
         {{3, 0}, 26, 4},
     };
 
-    std::vector<event_generator_ptr> generators(2);
+    std::vector<event_generator_ptr> generators;
     generators.push_back(
         make_event_generator<regular_generator>
         (cell_member_type{4,2}, 42.f, t0, 5));
 
-    merge_events(t0, t1, lc, events, generators, lf);
+    merge_events(t0, t1, lane_view(lc), lane_view(events), generators, lf);
 
     pse_vector expected = {
         {{4, 2}, 10, 42}, // from generator
@@ -151,51 +151,62 @@ TEST(merge_events, X)
     EXPECT_EQ(expected, lf);
 }
 
-// Test the tournament tree for merging two small sequences 
-TEST(merge_events, tourney_seq)
+// Test that merge_events draws the events from many generators in [t0, t1),
+// and leaves the generators ready to draw the events of the next interval.
+TEST(merge_events, many_generators)
 {
-    pse_vector g1 = {
-        {{0, 0}, 1, 1},
-        {{0, 0}, 2, 2},
-        {{0, 0}, 3, 3},
-        {{0, 0}, 4, 4},
-        {{0, 0}, 5, 5},
+    using rndgen = std::mt19937_64;
+    const time_type t0 = 5;
+    const time_type t1 = 10;
+    const time_type t2 = 15;
+
+    auto make_generators = [&]() {
+        std::vector<event_generator_ptr> gens;
+        for (auto i=0u; i<7u; ++i) {
+            cell_member_type tgt{0, i};
+            if (i%2) {
+                gens.push_back(make_event_generator<regular_generator>(tgt, float(i), 0.5*i, 0.3));
+            }
+            else {
+                gens.push_back(make_event_generator<poisson_generator<rndgen>>(tgt, float(i), rndgen(i), 0, 2.));
+            }
+        }
+        return gens;
     };
 
-    pse_vector g2 = {
-        {{0, 0}, 1.5, 1},
-        {{0, 0}, 2.5, 2},
-        {{0, 0}, 3.5, 3},
-        {{0, 0}, 4.5, 4},
-        {{0, 0}, 5.5, 5},
+    // Expected events drawn one at a time from each generator.
+    auto expected = [&](time_type ta, time_type tb) {
+        pse_vector v;
+        for (auto& g: make_generators()) {
+            g->advance(ta);
+            while (g->next().time<tb) {
+                v.push_back(g->next());
+                g->pop();
+            }
+        }
+        util::sort(v);
+        return v;
     };
 
-    std::vector<event_generator_ptr> generators;
-    generators.push_back(make_event_generator<seq_generator<pse_vector>>(g1));
-    generators.push_back(make_event_generator<seq_generator<pse_vector>>(g2));
-    impl::tourney_tree tree(generators);
-
+    pse_vector lc;
+    pse_vector events;
     pse_vector lf;
-    while (!tree.empty()) {
-        lf.push_back(tree.head());
-        tree.pop();
-    }
+    auto generators = make_generators();
 
-    EXPECT_TRUE(std::is_sorted(lf.begin(), lf.end()));
-    auto expected = g1;
-    util::append(expected, g2);
-    util::sort(expected);
+    merge_events(t0, t1, lane_view(lc), lane_view(events), generators, lf);
+    EXPECT_EQ(expected(t0, t1), lf);
 
-    EXPECT_EQ(expected, lf);
+    merge_events(t1, t2, lane_view(lc), lane_view(events), generators, lf);
+    EXPECT_EQ(expected(t1, t2), lf);
 }
 
-// Test the tournament tree on a large set of Poisson generators.
-TEST(merge_events, tourney_poisson)
+// Test the merge of events from a large set of Poisson generators.
+TEST(merge_events, poisson)
 {
     using rndgen = std::mt19937_64;
     // Number of poisson generators.
-    // Not a power of 2, so that there will be "null" leaf nodes in the
-    // tournament tree.
+    // Not a power of 2, so that the pairwise merge has an odd partition
+    // in some rounds.
     auto ngen = 100u;
     time_type tfinal = 10;
     time_type t0 = 0;
@@ -223,21 +234,19 @@ TEST(merge_events, tourney_poisson)
             gen->pop();
         }
         // Reset the generator so that it is ready to generate the same
-        // events again for the tournament tree test.
+        // events again for the merge.
         gen->reset();
     }
     // Manually sort the expected events.
     util::sort(expected);
 
-    // Generate output using tournament tree in lf.
-    impl::tourney_tree tree(generators);
+    // Merge the events of all generators in [t0, tfinal) in lf.
+    pse_vector lc;
+    pse_vector events;
     pse_vector lf;
-    while (!tree.empty(tfinal)) {
-        lf.push_back(tree.head());
-        tree.pop();
-    }
+    merge_events(t0, tfinal, lane_view(lc), lane_view(events), generators, lf);
 
-    // Test output of tournament tree.
+    // Test output of the merge.
     EXPECT_TRUE(std::is_sorted(lf.begin(), lf.end()));
     EXPECT_EQ(lf, expected);
 }
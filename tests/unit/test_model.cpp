@@ -0,0 +1,456 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cell.hpp>
+#include <checkpoint.hpp>
+#include <common_types.hpp>
+#include <connection_rule.hpp>
+#include <event_generator.hpp>
+#include <execution_context.hpp>
+#include <hardware/node_info.hpp>
+#include <load_balance.hpp>
+#include <model.hpp>
+#include <recipe.hpp>
+#include <spike.hpp>
+#include <util/unique_any.hpp>
+
+#include "../common_cells.hpp"
+#include "../simple_recipes.hpp"
+
+using namespace arb;
+
+namespace {
+    // A ring driven by regular input with a period that depends on the gid,
+    // and optionally by Poisson input. With Poisson input the regular input
+    // is weak, so that the cells keep firing rather than settle in
+    // depolarization block.
+    class ring_recipe: public cable1d_ring_recipe {
+    public:
+        explicit ring_recipe(unsigned n, bool noisy=false):
+            cable1d_ring_recipe(n, noisy? 0.002f: 0.02f, 1., 0.1), noisy_(noisy)
+        {}
+
+        std::vector<event_generator_ptr> event_generators(cell_gid_type gid) const override {
+            auto gens = cable1d_ring_recipe::event_generators(gid);
+            if (noisy_) {
+                gens.push_back(make_event_generator<poisson_generator<std::mt19937_64>>(
+                    cell_member_type{gid, 0}, 0.05f, std::mt19937_64(gid), 0., 0.5));
+            }
+            return gens;
+        }
+
+    private:
+        bool noisy_;
+    };
+
+    // The ring recipe, answering only the bulk queries for connections and
+    // event generators.
+    class bulk_ring_recipe: public ring_recipe {
+    public:
+        bulk_ring_recipe(ring_recipe rec): ring_recipe(std::move(rec)) {}
+
+        std::vector<cell_connection> connections_on(cell_gid_type) const override {
+            throw std::logic_error("per-gid connections_on query");
+        }
+
+        std::vector<event_generator_ptr> event_generators(cell_gid_type) const override {
+            throw std::logic_error("per-gid event_generators query");
+        }
+
+        void connections_on_range(gid_range gids,
+            std::vector<cell_connection>& conns, std::vector<cell_size_type>& divisions) const override
+        {
+            conns.clear();
+            divisions.assign(1, 0);
+            for (auto gid: gids) {
+                conns.push_back(ring_recipe::connections_on(gid).front());
+                divisions.push_back(conns.size());
+            }
+        }
+
+        void event_generators_range(gid_range gids,
+            std::vector<std::vector<event_generator_ptr>>& generators) const override
+        {
+            generators.resize(gids.size());
+            for (auto i: util::make_span(0, gids.size())) {
+                generators[i] = ring_recipe::event_generators(gids[i]);
+            }
+        }
+    };
+
+    void sort_spikes(std::vector<spike>& spikes) {
+        std::sort(spikes.begin(), spikes.end(),
+            [](const spike& a, const spike& b) {
+                return a.source<b.source || (a.source==b.source && a.time<b.time);
+            });
+    }
+
+    // Run the model over [0, 50) and then [50, 100), returning the spikes
+    // in order of source and time.
+    std::vector<spike> run_ring(const recipe& rec, epoch_scheduling policy, unsigned rebalance_interval=0,
+                                execution_context ctx=make_global_context())
+    {
+        model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}, ctx.distributed), ctx);
+        m.set_epoch_scheduling(policy);
+        m.set_rebalance_interval(rebalance_interval);
+
+        std::vector<spike> spikes;
+        m.set_global_spike_callback(
+            [&](const std::vector<spike>& s) {
+                spikes.insert(spikes.end(), s.begin(), s.end());
+            });
+
+        const time_type dt = 0.025;
+        m.run(50, dt);
+        m.run(100, dt);
+
+        sort_spikes(spikes);
+        return spikes;
+    }
+}
+
+// Scheduling the epochs as a task graph must give the same spikes as
+// synchronizing the cell groups every epoch.
+TEST(model, epoch_scheduling) {
+    auto rec = ring_recipe(20);
+
+    auto expected = run_ring(rec, epoch_scheduling::barrier);
+    auto spikes = run_ring(rec, epoch_scheduling::dataflow);
+
+    EXPECT_LT(0u, expected.size());
+    ASSERT_EQ(expected.size(), spikes.size());
+    for (auto i=0u; i<spikes.size(); ++i) {
+        EXPECT_EQ(expected[i].source, spikes[i].source);
+        EXPECT_EQ(expected[i].time, spikes[i].time);
+    }
+}
+
+namespace {
+    // The ring, with additional procedural connections of a longer delay,
+    // which are taken to cross domains.
+    class long_range_ring_recipe: public ring_recipe {
+    public:
+        long_range_ring_recipe(ring_recipe rec):
+            ring_recipe(std::move(rec)),
+            rule_(std::make_shared<random_connection_rule>(7, num_cells(), 0.2, 0, 0.02f, 12.f))
+        {}
+
+        connection_rule_ptr procedural_connections() const override {
+            return rule_;
+        }
+
+    private:
+        connection_rule_ptr rule_;
+    };
+}
+
+// Epochs of the minimum delay of the connections between domains, in which
+// the connections within the domain are delivered in intervals of their
+// minimum delay, must give the same spikes as epochs of half the minimum
+// delay of all connections: here epochs of 6 ms with intervals of 5 and 1 ms,
+// instead of epochs of 2.5 ms. Events are binned to the time step, so that
+// the steps of the cells do not depend on where the epochs end, up to the
+// rounding of the time.
+TEST(model, epoch_length) {
+    auto rec = long_range_ring_recipe(ring_recipe(20, true));
+    const time_type dt = 0.025;
+
+    auto run = [&](epoch_length length, epoch_scheduling policy) {
+        auto ctx = make_local_context(2);
+        model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}, ctx.distributed), ctx);
+        m.set_epoch_length(length);
+        m.set_epoch_scheduling(policy);
+        m.set_binning_policy(binning_kind::regular, dt);
+
+        std::vector<spike> spikes;
+        m.set_global_spike_callback(
+            [&](const std::vector<spike>& s) {
+                spikes.insert(spikes.end(), s.begin(), s.end());
+            });
+        m.run(50, dt);
+        m.run(100, dt);
+
+        sort_spikes(spikes);
+        return spikes;
+    };
+
+    auto expected = run(epoch_length::half_min_delay, epoch_scheduling::barrier);
+    EXPECT_LT(0u, expected.size());
+
+    for (auto length: {epoch_length::min_delay, epoch_length::cross_domain_delay}) {
+        for (auto policy: {epoch_scheduling::barrier, epoch_scheduling::dataflow}) {
+            auto spikes = run(length, policy);
+            ASSERT_EQ(expected.size(), spikes.size());
+            for (auto i=0u; i<spikes.size(); ++i) {
+                EXPECT_EQ(expected[i].source, spikes[i].source);
+                EXPECT_FLOAT_EQ(expected[i].time, spikes[i].time);
+            }
+        }
+    }
+}
+
+// Reordering and batching the advance of the cell groups must not change the
+// spikes.
+TEST(model, rebalance) {
+    auto rec = ring_recipe(20);
+
+    auto expected = run_ring(rec, epoch_scheduling::barrier);
+    EXPECT_LT(0u, expected.size());
+
+    for (auto policy: {epoch_scheduling::barrier, epoch_scheduling::dataflow}) {
+        auto spikes = run_ring(rec, policy, 3);
+        ASSERT_EQ(expected.size(), spikes.size());
+        for (auto i=0u; i<spikes.size(); ++i) {
+            EXPECT_EQ(expected[i].source, spikes[i].source);
+            EXPECT_EQ(expected[i].time, spikes[i].time);
+        }
+    }
+
+    // The advance of every group is timed, until the model is reset.
+    model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}));
+    m.set_rebalance_interval(1);
+    m.run(20, 0.025);
+    ASSERT_EQ(20u, m.group_advance_times().size());
+    for (auto t: m.group_advance_times()) {
+        EXPECT_LT(0., t);
+    }
+
+    m.reset();
+    for (auto t: m.group_advance_times()) {
+        EXPECT_EQ(0., t);
+    }
+}
+
+// A model restored from a checkpoint must continue exactly as the model from
+// which the checkpoint was taken.
+TEST(model, checkpoint) {
+    auto rec = ring_recipe(20, true);
+    const time_type dt = 0.025;
+    const std::string path = "test_model_checkpoint";
+    const std::string file = path+".0";
+
+    std::vector<spike> expected;
+    model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}));
+    m.set_global_spike_callback(
+        [&](const std::vector<spike>& s) {
+            expected.insert(expected.end(), s.begin(), s.end());
+        });
+    m.run(50, dt);
+    // Events injected between runs are part of the saved state.
+    m.inject_events({postsynaptic_spike_event{{3, 0}, 55., 0.1f}});
+    m.checkpoint(path);
+    expected.clear();
+    m.run(100, dt);
+    sort_spikes(expected);
+    EXPECT_LT(0u, expected.size());
+
+    for (auto policy: {epoch_scheduling::barrier, epoch_scheduling::dataflow}) {
+        std::vector<spike> spikes;
+        model r(rec, partition_load_balance(rec, hw::node_info{1u, 0u}));
+        r.set_epoch_scheduling(policy);
+        r.set_global_spike_callback(
+            [&](const std::vector<spike>& s) {
+                spikes.insert(spikes.end(), s.begin(), s.end());
+            });
+        // Advance the model before restoring, to check that all of the state
+        // is replaced.
+        r.run(20, dt);
+        spikes.clear();
+
+        r.restore(path);
+        r.run(100, dt);
+        sort_spikes(spikes);
+
+        ASSERT_EQ(expected.size(), spikes.size());
+        for (auto i=0u; i<spikes.size(); ++i) {
+            EXPECT_EQ(expected[i].source, spikes[i].source);
+            EXPECT_EQ(expected[i].time, spikes[i].time);
+        }
+    }
+
+    // A checkpoint can not be restored into a model of a different network.
+    auto other = ring_recipe(10);
+    model o(other, partition_load_balance(other, hw::node_info{1u, 0u}));
+    EXPECT_THROW(o.restore(path), checkpoint_error);
+    EXPECT_THROW(o.restore(path+"_missing"), checkpoint_error);
+
+    std::remove(file.c_str());
+}
+
+TEST(model, steady_state) {
+    auto rec = ring_recipe(4);
+    model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}));
+    EXPECT_FALSE(m.initialize_steady_state(1e-7, 1));
+    EXPECT_TRUE(m.initialize_steady_state());
+
+    // Once converged, the state is already steady.
+    EXPECT_TRUE(m.initialize_steady_state(1e-7, 1));
+}
+
+// Models with their own execution contexts can run concurrently, and give
+// the same spikes as a model run alone with the global context.
+TEST(model, concurrent_contexts) {
+    auto rec = ring_recipe(20, true);
+
+    auto expected = run_ring(rec, epoch_scheduling::barrier);
+    EXPECT_LT(0u, expected.size());
+
+    std::vector<spike> spikes[2];
+    std::thread t0([&] { spikes[0] = run_ring(rec, epoch_scheduling::barrier, 0, make_local_context(2)); });
+    std::thread t1([&] { spikes[1] = run_ring(rec, epoch_scheduling::dataflow, 0, make_local_context(2)); });
+    t0.join();
+    t1.join();
+
+    for (auto& s: spikes) {
+        ASSERT_EQ(expected.size(), s.size());
+        for (auto i=0u; i<s.size(); ++i) {
+            EXPECT_EQ(expected[i].source, s[i].source);
+            EXPECT_EQ(expected[i].time, s[i].time);
+        }
+    }
+}
+
+// Exact spike compression gives the same spikes as exchanging spikes
+// verbatim; with quantized times the network still fires.
+TEST(model, spike_compression) {
+    auto rec = ring_recipe(20, true);
+    auto decomp = partition_load_balance(rec, hw::node_info{1u, 0u});
+
+    auto run = [&](util::optional<time_type> quantum) {
+        model m(rec, decomp);
+        m.set_spike_compression(quantum);
+        std::vector<spike> spikes;
+        m.set_global_spike_callback(
+            [&](const std::vector<spike>& s) {
+                spikes.insert(spikes.end(), s.begin(), s.end());
+            });
+        m.run(100, 0.025);
+        sort_spikes(spikes);
+        return spikes;
+    };
+
+    auto expected = run(util::nothing);
+    auto exact = run(0.);
+    auto quantized = run(1e-3);
+
+    EXPECT_LT(0u, expected.size());
+    ASSERT_EQ(expected.size(), exact.size());
+    for (auto i=0u; i<exact.size(); ++i) {
+        EXPECT_EQ(expected[i].source, exact[i].source);
+        EXPECT_EQ(expected[i].time, exact[i].time);
+    }
+    EXPECT_LT(0u, quantized.size());
+}
+
+// A model set up with the bulk recipe queries is the same as one set up with
+// the per-gid queries.
+TEST(model, bulk_recipe_queries) {
+    auto rec = ring_recipe(20, true);
+    bulk_ring_recipe bulk(ring_recipe(20, true));
+
+    auto expected = run_ring(rec, epoch_scheduling::barrier);
+    auto spikes = run_ring(bulk, epoch_scheduling::barrier, 0, make_local_context(4));
+
+    EXPECT_LT(0u, expected.size());
+    ASSERT_EQ(expected.size(), spikes.size());
+    for (auto i=0u; i<spikes.size(); ++i) {
+        EXPECT_EQ(expected[i].source, spikes[i].source);
+        EXPECT_EQ(expected[i].time, spikes[i].time);
+    }
+}
+
+namespace {
+    // The ring, with the given weight of the connections and sodium
+    // conductance of the cells.
+    class changed_ring_recipe: public ring_recipe {
+    public:
+        changed_ring_recipe(ring_recipe rec, float weight, double gnabar):
+            ring_recipe(std::move(rec)), weight_(weight), gnabar_(gnabar)
+        {}
+
+        util::unique_any get_cell_description(cell_gid_type gid) const override {
+            auto d = ring_recipe::get_cell_description(gid);
+            util::any_cast<cell&>(d).soma()->mechanism("hh")->set("gnabar", gnabar_);
+            return d;
+        }
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            auto conns = ring_recipe::connections_on(gid);
+            for (auto& c: conns) {
+                c.weight = weight_;
+            }
+            return conns;
+        }
+
+    private:
+        float weight_;
+        double gnabar_;
+    };
+}
+
+// Changing parameters in place and resetting gives the same spikes as a new
+// model of the changed network.
+TEST(model, set_parameters) {
+    auto rec = ring_recipe(10, true);
+    model m(rec, partition_load_balance(rec, hw::node_info{1u, 0u}));
+
+    std::vector<spike> spikes;
+    m.set_global_spike_callback(
+        [&](const std::vector<spike>& s) {
+            spikes.insert(spikes.end(), s.begin(), s.end());
+        });
+    auto run = [&]() {
+        spikes.clear();
+        m.reset();
+        m.run(100, 0.025);
+        sort_spikes(spikes);
+        return spikes;
+    };
+
+    auto same = [](const std::vector<spike>& a, const std::vector<spike>& b) {
+        return a.size()==b.size() && std::equal(a.begin(), a.end(), b.begin(),
+            [](const spike& x, const spike& y) { return x.source==y.source && x.time==y.time; });
+    };
+
+    auto expected = run();
+    EXPECT_LT(0u, expected.size());
+
+    auto set_parameters = [&](float weight, double gnabar, double tau) {
+        for (cell_gid_type gid=0; gid<10; ++gid) {
+            m.set_connection_weight({gid? gid-1: 9, 0}, {gid, 0}, weight);
+            m.set_mechanism_parameter(gid, {0, 0.5}, "hh", "gnabar", gnabar);
+            m.set_synapse_parameter({gid, 0}, "tau", tau);
+        }
+    };
+
+    // A network with stronger connections and weaker sodium channels.
+    auto changed_spikes = run_ring(changed_ring_recipe(ring_recipe(10, true), 0.1f, 0.1), epoch_scheduling::barrier, 0);
+
+    EXPECT_FALSE(same(expected, changed_spikes));
+
+    set_parameters(0.1f, 0.1, 2.);
+    EXPECT_TRUE(same(changed_spikes, run()));
+
+    // A change to the synapses changes the spikes; restoring the original
+    // parameters restores the original spikes.
+    set_parameters(0.05f, 0.12, 5.);
+    EXPECT_FALSE(same(expected, run()));
+
+    set_parameters(0.05f, 0.12, 2.);
+    EXPECT_TRUE(same(expected, run()));
+
+    EXPECT_THROW(m.set_mechanism_parameter(0, {0, 0.5}, "pas", "g", 0.), std::invalid_argument);
+    EXPECT_THROW(m.set_connection_weight({1, 0}, {0, 0}, 0.1f), std::invalid_argument);
+
+    // Cells that are not in the model are ignored.
+    m.set_mechanism_parameter(10, {0, 0.5}, "hh", "gnabar", 0.);
+    m.set_connection_weight({9, 0}, {10, 0}, 0.1f);
+}
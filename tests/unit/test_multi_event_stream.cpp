@@ -59,6 +59,38 @@ TEST(multi_event_stream, init) {
     EXPECT_TRUE(m.empty());
 }
 
+// Events need only be sorted by time within each stream, as they are when
+// the events of each cell are staged in turn.
+TEST(multi_event_stream, init_by_stream) {
+    using multi_event_stream = multicore::multi_event_stream<deliverable_event>;
+    using namespace common_events;
+
+    auto events = common_events::events;
+    util::stable_sort_by(events, [](deliverable_event e) { return event_index(e); });
+    ASSERT_FALSE(util::is_sorted_by(events, [](deliverable_event e) { return event_time(e); }));
+
+    multi_event_stream m(n_cell);
+    m.init(events);
+
+    std::vector<time_type> t_until(n_cell, 3.f);
+    m.mark_until_after(t_until);
+
+    EXPECT_EQ(1u, marked_range(m, cell_1).size());
+    EXPECT_EQ(1u, marked_range(m, cell_3).size());
+    ASSERT_EQ(1u, marked_range(m, cell_2).size());
+    EXPECT_EQ(handle[1].mech_index, marked_range(m, cell_2).front().mech_index);
+
+    m.drop_marked_events();
+    t_until.assign(n_cell, 5.f);
+    m.mark_until_after(t_until);
+
+    ASSERT_EQ(1u, marked_range(m, cell_2).size());
+    EXPECT_EQ(handle[2].mech_index, marked_range(m, cell_2).front().mech_index);
+
+    m.drop_marked_events();
+    EXPECT_TRUE(m.empty());
+}
+
 TEST(multi_event_stream, mark) {
     using multi_event_stream = multicore::multi_event_stream<deliverable_event>;
     using namespace common_events;
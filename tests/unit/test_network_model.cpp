@@ -0,0 +1,48 @@
+#include "../gtest.h"
+
+#include <cmath>
+
+#include <communication/network_model.hpp>
+
+using namespace arb::communication;
+
+TEST(network_model, loggp_message) {
+    loggp_parameters p{2e-6, 1e-6, 3e-6, 1e-9};
+    loggp_model m(p);
+
+    // Short messages are limited by the gap between messages.
+    EXPECT_DOUBLE_EQ(4e-6, m.message(1));
+    EXPECT_DOUBLE_EQ(4e-6, m.message(0));
+
+    // Long messages are limited by the bandwidth.
+    EXPECT_DOUBLE_EQ(4e-6+999*1e-9, m.message(1000));
+
+    p.g = 1e-5;
+    EXPECT_DOUBLE_EQ(1e-5, loggp_model(p).message(1000));
+}
+
+TEST(network_model, loggp_collectives) {
+    loggp_model m(loggp_parameters{2e-6, 1e-6, 0, 1e-9});
+
+    // No communication on one rank.
+    EXPECT_EQ(0., m.allgather(1, 100));
+    EXPECT_EQ(0., m.allreduce(1, 8));
+
+    // Recursive doubling: messages of 1, 2, 4 ranks' data on 8 ranks; of
+    // 1, 2, 1 ranks' data on 5 ranks.
+    const std::size_t k = 100;
+    EXPECT_DOUBLE_EQ(m.message(k)+m.message(2*k)+m.message(4*k), m.allgather(8, k));
+    EXPECT_DOUBLE_EQ(2*m.message(k)+m.message(2*k), m.allgather(5, k));
+    EXPECT_DOUBLE_EQ(3*m.message(8), m.allreduce(8, 8));
+    EXPECT_DOUBLE_EQ(3*m.message(8), m.allreduce(5, 8));
+
+    // Once latency is negligible, the allgather is bandwidth bound: every rank
+    // receives the data of all other ranks.
+    const int p = 10000;
+    const std::size_t big = 1<<20;
+    EXPECT_NEAR((p-1)*big*1e-9, m.allgather(p, big), 1e-3*(p-1)*big*1e-9);
+
+    // More ranks take longer.
+    EXPECT_LT(m.allgather(100, k), m.allgather(1000, k));
+    EXPECT_LT(m.allreduce(100, 8), m.allreduce(1000, 8));
+}
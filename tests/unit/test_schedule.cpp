@@ -74,6 +74,37 @@ void run_reset_check(schedule S, time_type t0, time_type t1, unsigned n, int see
     EXPECT_EQ(first, second);
 }
 
+// Check that the buffer variant of events() appends the same times as are
+// returned by the vector-returning variant.
+
+void run_buffer_check(schedule S, time_type t0, time_type t1, unsigned n) {
+    std::vector<time_type> expected;
+    std::vector<time_type> buffer = {-1};
+
+    time_type dt = (t1-t0)/n;
+    for (unsigned i=0; i<n; ++i) {
+        util::append(expected, S.events(t0+i*dt, t0+(i+1)*dt));
+    }
+
+    S.reset();
+    for (unsigned i=0; i<n; ++i) {
+        S.events(t0+i*dt, t0+(i+1)*dt, buffer);
+    }
+
+    ASSERT_FALSE(buffer.empty());
+    EXPECT_EQ(-1, buffer.front());
+    EXPECT_EQ(expected, std::vector<time_type>(buffer.begin()+1, buffer.end()));
+}
+
+TEST(schedule, events_buffer) {
+    time_type times[] = {0.1, 0.3, 0.4, 0.42, 2.1, 2.3, 6.01, 9, 9.1, 9.8, 10, 11.2, 13};
+    std::mt19937_64 G;
+
+    run_buffer_check(regular_schedule(0.3), 0, 12, 7);
+    run_buffer_check(explicit_schedule(times), 0, 12, 7);
+    run_buffer_check(poisson_schedule(0.3, G), 0, 12, 7);
+}
+
 TEST(schedule, regular) {
     // Use exact fp representations for strict equality testing.
     std::vector<time_type> expected = {0, 0.25, 0.5, 0.75, 1.0};
@@ -0,0 +1,62 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <common_types.hpp>
+#include <communication/source_filter.hpp>
+
+using namespace arb;
+using communication::source_filter;
+
+TEST(source_filter, empty) {
+    source_filter f;
+    EXPECT_FALSE(f.may_contain(0));
+    EXPECT_FALSE(f.may_contain(42));
+
+    source_filter g(std::vector<cell_gid_type>{});
+    EXPECT_FALSE(g.may_contain(0));
+    EXPECT_EQ(0u, g.memory());
+}
+
+// Dense gids are stored in a bitset, which answers exactly.
+TEST(source_filter, bitset) {
+    std::vector<cell_gid_type> gids;
+    for (cell_gid_type gid = 1000; gid<3000; gid += 3) {
+        gids.push_back(gid);
+    }
+
+    source_filter f(gids);
+    EXPECT_FALSE(f.is_bloom());
+    EXPECT_EQ((2000u+63)/64*8, f.memory());
+    for (cell_gid_type gid = 0; gid<4000; ++gid) {
+        bool in = gid>=1000 && gid<3000 && (gid-1000)%3==0;
+        EXPECT_EQ(in, f.may_contain(gid));
+    }
+    EXPECT_FALSE(f.may_contain(cell_gid_type(-1)));
+}
+
+// Sparse gids are stored in a Bloom filter, which has no false negatives,
+// and few false positives.
+TEST(source_filter, bloom) {
+    std::vector<cell_gid_type> gids;
+    for (cell_gid_type i = 0; i<10000; ++i) {
+        gids.push_back(i*1000+i%7);
+    }
+
+    source_filter f(gids);
+    EXPECT_TRUE(f.is_bloom());
+    EXPECT_EQ((10000u*source_filter::bits_per_gid+511)/512*64, f.memory());
+    for (auto gid: gids) {
+        EXPECT_TRUE(f.may_contain(gid));
+    }
+
+    unsigned false_positives = 0;
+    const unsigned n = 1000000;
+    for (cell_gid_type gid = 0; gid<n; ++gid) {
+        if (!std::binary_search(gids.begin(), gids.end(), gid)) {
+            false_positives += f.may_contain(gid);
+        }
+    }
+    EXPECT_LT(false_positives, n/200);
+}
@@ -0,0 +1,90 @@
+#include "../gtest.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <common_types.hpp>
+#include <communication/spike_codec.hpp>
+#include <spike.hpp>
+
+using namespace arb;
+using namespace arb::communication;
+
+namespace {
+    std::vector<spike> decode(const std::vector<char>& buffer) {
+        std::vector<spike> spikes;
+        decode_spikes(buffer.data(), buffer.data()+buffer.size(), spikes);
+        return spikes;
+    }
+}
+
+TEST(spike_codec, exact) {
+    std::vector<char> buffer;
+
+    encode_spikes({}, 0, buffer);
+    EXPECT_TRUE(decode(buffer).empty());
+
+    // Sorted and unsorted sources, large gids and arbitrary times.
+    const auto max_gid = std::numeric_limits<cell_gid_type>::max();
+    std::vector<spike> spikes = {
+        {{0, 0}, 0.1},
+        {{3, 2}, 12.345678901234},
+        {{3, 300}, -1.5},
+        {{1000000, 0}, 1e6},
+        {{7, 1}, 0.1/3},
+        {{max_gid, 5}, 2.},
+    };
+    encode_spikes(spikes, 0, buffer);
+    auto decoded = decode(buffer);
+    ASSERT_EQ(spikes.size(), decoded.size());
+    for (auto i=0u; i<spikes.size(); ++i) {
+        EXPECT_EQ(spikes[i].source, decoded[i].source);
+        EXPECT_EQ(spikes[i].time, decoded[i].time);
+    }
+
+    // Decoding appends to the spikes.
+    std::vector<spike> twice;
+    decode_spikes(buffer.data(), buffer.data()+buffer.size(), twice);
+    decode_spikes(buffer.data(), buffer.data()+buffer.size(), twice);
+    EXPECT_EQ(2*spikes.size(), twice.size());
+
+    EXPECT_THROW(decode_spikes(buffer.data(), buffer.data()+buffer.size()-1, twice), std::runtime_error);
+}
+
+TEST(spike_codec, quantized) {
+    // Consecutive sources over an epoch of 5 ms.
+    std::vector<spike> spikes;
+    for (cell_gid_type gid=100; gid<1100; ++gid) {
+        spikes.push_back({{gid, 0}, time_type(20+5.*std::sin(gid)*std::sin(gid))});
+    }
+
+    std::vector<char> exact, q16, q32;
+    encode_spikes(spikes, 0, exact);
+    encode_spikes(spikes, 1e-4, q16);
+    encode_spikes(spikes, 1e-5, q32);
+
+    // Deltas of one gid take a byte, as does the source index.
+    EXPECT_LT(q16.size(), 4*spikes.size()+32);
+    EXPECT_LT(q32.size(), 6*spikes.size()+32);
+    EXPECT_LT(exact.size(), (2+sizeof(time_type))*spikes.size()+32);
+    EXPECT_LT(q16.size(), q32.size());
+    EXPECT_LE(q32.size(), exact.size());
+
+    // Times are rounded to the quantum, then to time_type.
+    const double ulp = 25*std::numeric_limits<time_type>::epsilon();
+    for (double quantum: {1e-4, 1e-5}) {
+        auto decoded = quantize_spikes(spikes, quantum);
+        ASSERT_EQ(spikes.size(), decoded.size());
+        for (auto i=0u; i<spikes.size(); ++i) {
+            EXPECT_EQ(spikes[i].source, decoded[i].source);
+            EXPECT_NEAR(spikes[i].time, decoded[i].time, 0.5*quantum+ulp);
+        }
+    }
+
+    // Times that do not fit in 32 bits of the quantum are written exactly.
+    std::vector<spike> wide = {{{0, 0}, 0.}, {{1, 0}, 1e3}};
+    auto decoded = quantize_spikes(wide, 1e-9);
+    EXPECT_EQ(1e3, decoded[1].time);
+}
@@ -1,5 +1,7 @@
 #include "../gtest.h"
 
+#include <vector>
+
 #include <spike.hpp>
 #include <threading/threading.hpp>
 #include <thread_private_spike_store.hpp>
@@ -85,3 +87,68 @@ TEST(spike_store, gather)
         EXPECT_EQ(spikes[i].time, gathered_spikes[i].time);
     }
 }
+
+TEST(spike_store, gather_time_order)
+{
+    using store_type = arb::thread_private_spike_store;
+
+    store_type store;
+
+    // Spikes of the same source in one buffer are gathered in time order,
+    // whatever the order in which they were inserted.
+    store.insert({
+        {{1,0}, 3.0f}, {{0,0}, 1.0f}, {{1,0}, 2.0f}, {{1,1}, 0.5f},
+        {{1,0}, 1.0f}, {{0,0}, 0.5f}
+    });
+    auto gathered = store.gather();
+
+    std::vector<spike> expected =
+        { {{0,0}, 0.5f}, {{0,0}, 1.0f}, {{1,0}, 1.0f}, {{1,0}, 2.0f},
+          {{1,0}, 3.0f}, {{1,1}, 0.5f} };
+
+    ASSERT_EQ(expected.size(), gathered.size());
+    for (auto i=0u; i<expected.size(); ++i) {
+        EXPECT_EQ(expected[i].source, gathered[i].source);
+        EXPECT_EQ(expected[i].time, gathered[i].time);
+    }
+}
+
+TEST(spike_store, gather_sorted)
+{
+    using store_type = arb::thread_private_spike_store;
+
+    store_type store;
+
+    // Insert spikes in descending order of source, from many tasks, so that
+    // they are spread over the thread private buffers.
+    const unsigned n = 1000;
+    arb::threading::parallel_for::apply(0, n,
+        [&](unsigned i) {
+            store.insert({{{n-i, i%3}, float(i)}, {{(7*i)%n, 0}, float(i)}});
+        });
+
+    std::vector<spike> gathered;
+    store.gather(gathered);
+
+    EXPECT_EQ(2*n, gathered.size());
+    for (auto i=1u; i<gathered.size(); ++i) {
+        const auto& a = gathered[i-1];
+        const auto& b = gathered[i];
+        EXPECT_FALSE(b.source<a.source);
+        if (a.source==b.source) {
+            EXPECT_LE(a.time, b.time);
+        }
+    }
+
+    // Every spike that was inserted is gathered exactly once.
+    unsigned long sum_times = 0;
+    for (auto& s: gathered) {
+        sum_times += (unsigned long)s.time;
+    }
+    EXPECT_EQ((unsigned long)n*(n-1), sum_times);
+
+    // Gathering an empty store gives no spikes.
+    store.clear();
+    store.gather(gathered);
+    EXPECT_TRUE(gathered.empty());
+}